@@ -0,0 +1,1051 @@
+/* This file benchmarks the hot SV_Str_view functions against the libc
+   functions that do the same work. Every case runs the str_view function and
+   its libc equivalent over the same haystack, checks that both find the same
+   matches, and reports the time of each as one JSON object. Cases sweep the
+   haystack size from one that fits in L1 to one that only fits in DRAM, the
+   needle or set length, and how often a match is planted in the haystack.
+
+   The haystack is random lowercase text. Byte and set searches look for a
+   newline, which only appears where planted. Needles are random lowercase
+   text as well, so short needles also match by chance. Matches are counted
+   with overlap by advancing one byte past each match, except tokens, which
+   are the non empty runs between delimiters found without overlap.
+
+   The tier field of the output is the vector tier the runtime dispatched
+   kernels select on this machine and compiled_tier is the one the build
+   flags select for the rest.
+
+   With --perf each case also reports hardware counters read around the
+   timing rounds: cycles per byte, instructions per cycle, and per call
+   totals of each counter. Counters the machine does not offer are null, and
+   if none are offered the run reports timing alone.
+
+   The dedup operation has no libc equivalent. It inserts a stream of words
+   into one SV_Dedup_set from a pool of 1, 2, 4, and so on up to --threads
+   threads and reports the throughput of each, so the scaling of the set
+   under contention can be read off directly. Counters are not read for it
+   because they only count the calling thread.
+
+   Usage: sv_bench [--max-bytes N] [--min-ms N] [--op NAME] [--output FILE]
+                   [--threads N] [--perf] */
+#include "counters.h"
+#include "str_view.h"
+#ifdef SV_BENCH_DEDUP
+#    include "str_view_parallel.h"
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#ifdef SV_BENCH_DEDUP
+#    include <stdatomic.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The byte planted in the haystack for byte and set searches. */
+#define PLANT '\n'
+
+/* Timing rounds per implementation. The fastest round is reported. */
+#define ROUNDS 3
+
+/* The bytes of the largest haystack unless --max-bytes says otherwise. */
+#define DEFAULT_MAX_BYTES ((size_t)64 << 20)
+
+/* The longest needle swept. */
+#define MAX_NEEDLE_LEN 1024
+
+/* The milliseconds of one timing round unless --min-ms says otherwise. */
+#define DEFAULT_MIN_MS 10
+
+/* The most threads the dedup sweep reaches unless --threads says otherwise. */
+#define DEFAULT_MAX_THREADS 32
+
+/* The distinct words of the dedup streams and the words of the stream with
+   repeats. Words are 4 to 12 letters long. */
+#define DEDUP_WORD_BITS 18
+#define DEDUP_WORDS ((size_t)1 << DEDUP_WORD_BITS)
+#define DEDUP_STREAM ((size_t)1 << 21)
+#define DEDUP_WORD_MIN 4
+#define DEDUP_WORD_MAX 12
+
+/* The slices of a dedup stream handed to each thread of the pool, so threads
+   that finish early steal from slower ones. */
+#define DEDUP_SLICES_PER_THREAD 8
+
+#ifndef SV_BENCH_BUILD_TYPE
+#    define SV_BENCH_BUILD_TYPE ""
+#endif
+
+/* The vector tier str_view selects at compile time. The library and the
+   benchmarks are built with the same flags so they agree. Compare tiers by
+   building once per set of flags. runtime_tier() reports the tier the
+   kernels that dispatch at run time select on this processor. */
+#if defined(__AVX2__)
+#    define SV_BENCH_TIER "avx2"
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define SV_BENCH_TIER "sse2"
+#else
+#    define SV_BENCH_TIER "portable"
+#endif
+
+/* The shape of the pattern an operation searches for. */
+enum Pattern {
+    PATTERN_BYTE,
+    PATTERN_NEEDLE,
+    PATTERN_SET,
+    PATTERN_LETTERS,
+    PATTERN_NONE,
+};
+
+/* One haystack and the pattern searched in it. The haystack is followed by a
+   null terminator for the libc functions that need one. */
+struct Case {
+    SV_Str_view hay;
+    SV_Str_view pattern;
+    SV_Needle needle;
+    char const *rhs;
+};
+
+/* Runs one implementation over a case and returns the matches found. */
+typedef size_t Run(struct Case const *);
+
+struct Op {
+    char const *name;
+    char const *sv;
+    char const *libc;
+    enum Pattern pattern;
+    Run *sv_run;
+    Run *libc_run;
+};
+
+struct Level {
+    char const *name;
+    size_t bytes;
+};
+
+struct Options {
+    size_t max_bytes;
+    uint64_t min_ns;
+    char const *op;
+    FILE *out;
+    size_t max_threads;
+    bool perf;
+    /* Open counters, or NULL to report timing alone. */
+    struct Counters const *counters;
+};
+
+#ifdef SV_BENCH_DEDUP
+/* One stream of words inserted into a fresh set by every thread count. */
+struct Dedup_case {
+    char const *name;
+    SV_Str_view const *words;
+    size_t n;
+    size_t bytes;
+};
+
+/* The set a timed dedup run fills and the arena of each slice. */
+struct Dedup_run {
+    struct Dedup_case const *c;
+    SV_Dedup_arena **arenas;
+    size_t slices;
+    /* Set if any insert returned a view with a NULL pointer. */
+    atomic_bool failed;
+};
+#endif
+
+/* The fastest time of one run and the counters over every run timed. */
+struct Timing {
+    uint64_t ns;
+    uint64_t runs;
+    bool counted;
+    struct Counts counts;
+};
+
+/* Planting intervals. Zero plants nothing. */
+static size_t const densities[] = {0, 4096, 64};
+
+static size_t const needle_lens[] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, MAX_NEEDLE_LEN,
+};
+
+static size_t const set_lens[] = {1, 4, 16};
+
+static size_t const byte_len = 1;
+
+static struct Level const levels[] = {
+    {"L1", (size_t)16 << 10},
+    {"L2", (size_t)256 << 10},
+    {"L3", (size_t)4 << 20},
+    {"DRAM", (size_t)64 << 20},
+    {"DRAM", (size_t)256 << 20},
+};
+
+/* Set bytes that never appear in the haystack unless planted. */
+static char const absent_set[] = "\n#$%&*+,-./:;<=>?@";
+
+static char const letters[] = "abcdefghijklmnopqrstuvwxyz";
+
+static size_t const letters_len = sizeof(letters) - 1;
+
+/* Keeps the compiler from discarding the work being timed. */
+static size_t volatile sink;
+
+/* ============================   Prototypes   ============================== */
+
+static size_t sv_find_byte(struct Case const *);
+static size_t libc_find_byte(struct Case const *);
+#ifdef SV_BENCH_MEMRCHR
+static size_t sv_reverse_find_byte(struct Case const *);
+static size_t libc_reverse_find_byte(struct Case const *);
+#endif
+static size_t sv_line_count(struct Case const *);
+static size_t libc_line_count(struct Case const *);
+static size_t sv_find(struct Case const *);
+static size_t sv_needle_find(struct Case const *);
+static size_t sv_count(struct Case const *);
+static size_t sv_reverse_find(struct Case const *);
+static size_t libc_find(struct Case const *);
+static size_t sv_token_next(struct Case const *);
+static size_t libc_token_next(struct Case const *);
+static size_t sv_find_first_of(struct Case const *);
+static size_t sv_find_last_of(struct Case const *);
+static size_t libc_find_first_of(struct Case const *);
+static size_t sv_find_first_not_of(struct Case const *);
+static size_t libc_find_first_not_of(struct Case const *);
+static size_t sv_compare(struct Case const *);
+static size_t libc_compare(struct Case const *);
+static char const *runtime_tier(void);
+static bool parse_options(int argc, char **argv, struct Options *);
+static bool run_op(struct Op const *, struct Options const *, char *base,
+                   char *work, char *rhs, bool *first);
+static size_t const *pattern_lens(enum Pattern, size_t *n);
+static void make_pattern(enum Pattern, char *pattern, size_t len);
+static bool run_case(struct Op const *, struct Options const *,
+                     struct Case const *, struct Level const *,
+                     size_t density, bool *first);
+static struct Timing time_run(Run *, struct Case const *,
+                              struct Options const *);
+static void print_counters(FILE *, char const *impl, struct Timing const *,
+                           size_t bytes);
+#ifdef SV_BENCH_DEDUP
+static bool run_dedup(struct Options const *, bool *first);
+static bool run_dedup_case(struct Dedup_case const *, struct Options const *,
+                           bool *first);
+static bool time_dedup(struct Dedup_case const *, SV_Pool *, size_t slices,
+                       uint64_t *ns, size_t *distinct);
+static void dedup_slice(void *, size_t);
+static SV_Str_view *make_words(char *buf, size_t n, uint64_t *seed);
+#endif
+static uint64_t now_ns(void);
+static void fill_letters(char *buf, size_t n, uint64_t *seed);
+static void plant(char *buf, size_t n, size_t density, char const *pattern,
+                  size_t len);
+static uint64_t next_random(uint64_t *seed);
+static double gbps(size_t bytes, uint64_t ns);
+
+/* ===========================   Operations   ============================== */
+
+static struct Op const ops[] = {
+    {"find_byte", "SV_find", "memchr", PATTERN_BYTE, sv_find_byte,
+     libc_find_byte},
+#ifdef SV_BENCH_MEMRCHR
+    {"reverse_find_byte", "SV_reverse_find", "memrchr", PATTERN_BYTE,
+     sv_reverse_find_byte, libc_reverse_find_byte},
+#endif
+    {"line_count", "SV_line_count", "memchr", PATTERN_BYTE, sv_line_count,
+     libc_line_count},
+    {"find", "SV_find", "memmem", PATTERN_NEEDLE, sv_find, libc_find},
+    {"needle_find", "SV_needle_find", "memmem", PATTERN_NEEDLE,
+     sv_needle_find, libc_find},
+    {"count", "SV_count", "memmem", PATTERN_NEEDLE, sv_count, libc_find},
+    {"reverse_find", "SV_reverse_find", "memmem", PATTERN_NEEDLE,
+     sv_reverse_find, libc_find},
+    {"token_next", "SV_token_next", "memmem", PATTERN_NEEDLE, sv_token_next,
+     libc_token_next},
+    {"find_first_of", "SV_find_first_of", "strcspn", PATTERN_SET,
+     sv_find_first_of, libc_find_first_of},
+    {"find_last_of", "SV_find_last_of", "strcspn", PATTERN_SET,
+     sv_find_last_of, libc_find_first_of},
+    {"find_first_not_of", "SV_find_first_not_of", "strspn", PATTERN_LETTERS,
+     sv_find_first_not_of, libc_find_first_not_of},
+    {"compare", "SV_compare", "memcmp", PATTERN_NONE, sv_compare,
+     libc_compare},
+};
+
+int
+main(int argc, char **argv) {
+    struct Options opt = {
+        .max_bytes = DEFAULT_MAX_BYTES,
+        .min_ns = (uint64_t)DEFAULT_MIN_MS * 1000000,
+        .op = NULL,
+        .out = stdout,
+        .max_threads = DEFAULT_MAX_THREADS,
+        .perf = false,
+        .counters = NULL,
+    };
+    if (!parse_options(argc, argv, &opt)) {
+        fprintf(stderr, "usage: %s [--max-bytes N] [--min-ms N] [--op NAME] "
+                        "[--output FILE] [--threads N] [--perf]\n",
+                argv[0]);
+        return 2;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        if (levels[i].bytes <= opt.max_bytes) {
+            bytes = levels[i].bytes;
+        }
+    }
+    char *const base = malloc(bytes + 1);
+    char *const work = malloc(bytes + 1);
+    char *const rhs = malloc(bytes + 1);
+    if (!base || !work || !rhs) {
+        fprintf(stderr, "cannot allocate %zu byte haystacks\n", bytes);
+        return 1;
+    }
+    struct Counters counters;
+    if (opt.perf) {
+        if (counters_open(&counters)) {
+            opt.counters = &counters;
+        } else {
+            fprintf(stderr, "hardware counters are unavailable, reporting "
+                            "timing alone\n");
+        }
+    }
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    fill_letters(base, bytes, &seed);
+    base[bytes] = '\0';
+    fprintf(opt.out, "{\"bench\":\"str_view\",\"build_type\":\"%s\","
+                     "\"tier\":\"%s\",\"compiled_tier\":\"%s\","
+                     "\"min_ms\":%llu,\"perf\":%s,\"results\":[\n",
+            SV_BENCH_BUILD_TYPE, runtime_tier(), SV_BENCH_TIER,
+            (unsigned long long)(opt.min_ns / 1000000),
+            opt.counters ? "true" : "false");
+    bool ok = true;
+    bool first = true;
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+        if (!opt.op || !strcmp(opt.op, ops[i].name)) {
+            ok = run_op(&ops[i], &opt, base, work, rhs, &first) && ok;
+        }
+    }
+#ifdef SV_BENCH_DEDUP
+    if (!opt.op || !strcmp(opt.op, "dedup")) {
+        ok = run_dedup(&opt, &first) && ok;
+    }
+#endif
+    fprintf(opt.out, "\n]}\n");
+    free(base);
+    free(work);
+    free(rhs);
+    if (opt.counters) {
+        counters_close(&counters);
+    }
+    if (opt.out != stdout) {
+        fclose(opt.out);
+    }
+    return ok ? 0 : 1;
+}
+
+/* ==========================   Implementations   ========================== */
+
+static size_t
+sv_find_byte(struct Case const *const c) {
+    size_t found = 0;
+    for (size_t pos = SV_find(c->hay, 0, c->pattern); pos < c->hay.len;
+         pos = SV_find(c->hay, pos + 1, c->pattern)) {
+        ++found;
+    }
+    return found;
+}
+
+static size_t
+libc_find_byte(struct Case const *const c) {
+    size_t found = 0;
+    char const *const end = c->hay.str + c->hay.len;
+    for (char const *p = memchr(c->hay.str, c->pattern.str[0], c->hay.len); p;
+         p = memchr(p + 1, c->pattern.str[0], (size_t)(end - p - 1))) {
+        ++found;
+    }
+    return found;
+}
+
+#ifdef SV_BENCH_MEMRCHR
+
+static size_t
+sv_reverse_find_byte(struct Case const *const c) {
+    size_t found = 0;
+    for (size_t pos = SV_reverse_find(c->hay, c->hay.len, c->pattern);
+         pos < c->hay.len; pos = SV_reverse_find(c->hay, pos - 1, c->pattern)) {
+        ++found;
+        if (!pos) {
+            break;
+        }
+    }
+    return found;
+}
+
+static size_t
+libc_reverse_find_byte(struct Case const *const c) {
+    size_t found = 0;
+    for (char const *p = memrchr(c->hay.str, c->pattern.str[0], c->hay.len); p;
+         p = memrchr(c->hay.str, c->pattern.str[0],
+                     (size_t)(p - c->hay.str))) {
+        ++found;
+    }
+    return found;
+}
+
+#endif /* SV_BENCH_MEMRCHR */
+
+static size_t
+sv_line_count(struct Case const *const c) {
+    return SV_line_count(c->hay);
+}
+
+/* Counts lines the way SV_line_count does: one more than the newlines unless
+   the last byte is a newline. */
+static size_t
+libc_line_count(struct Case const *const c) {
+    if (!c->hay.len) {
+        return 0;
+    }
+    size_t const newlines = libc_find_byte(c);
+    return newlines + (c->hay.str[c->hay.len - 1] != c->pattern.str[0]);
+}
+
+static size_t
+sv_find(struct Case const *const c) {
+    size_t found = 0;
+    for (size_t pos = SV_find(c->hay, 0, c->pattern); pos < c->hay.len;
+         pos = SV_find(c->hay, pos + 1, c->pattern)) {
+        ++found;
+    }
+    return found;
+}
+
+static size_t
+sv_needle_find(struct Case const *const c) {
+    size_t found = 0;
+    for (size_t pos = SV_needle_find(c->hay, 0, &c->needle); pos < c->hay.len;
+         pos = SV_needle_find(c->hay, pos + 1, &c->needle)) {
+        ++found;
+    }
+    return found;
+}
+
+static size_t
+sv_count(struct Case const *const c) {
+    return SV_count(c->hay, c->pattern);
+}
+
+/* Walks back from the end one byte before each match, so it counts the same
+   overlapping matches as the forward searches. */
+static size_t
+sv_reverse_find(struct Case const *const c) {
+    size_t found = 0;
+    for (size_t pos = SV_reverse_find(c->hay, c->hay.len, c->pattern);
+         pos < c->hay.len; pos = SV_reverse_find(c->hay, pos - 1, c->pattern)) {
+        ++found;
+        if (!pos) {
+            break;
+        }
+    }
+    return found;
+}
+
+static size_t
+libc_find(struct Case const *const c) {
+    size_t found = 0;
+    char const *const end = c->hay.str + c->hay.len;
+    for (char const *p
+         = memmem(c->hay.str, c->hay.len, c->pattern.str, c->pattern.len);
+         p; p = memmem(p + 1, (size_t)(end - p - 1), c->pattern.str,
+                       c->pattern.len)) {
+        ++found;
+    }
+    return found;
+}
+
+static size_t
+sv_token_next(struct Case const *const c) {
+    size_t found = 0;
+    for (SV_Str_view tok = SV_token_begin(c->hay, c->pattern);
+         !SV_token_end(c->hay, tok);
+         tok = SV_token_next(c->hay, tok, c->pattern)) {
+        ++found;
+    }
+    return found;
+}
+
+/* Counts the tokens SV_token_next yields: the non empty runs between
+   delimiters found without overlap. */
+static size_t
+libc_token_next(struct Case const *const c) {
+    size_t found = 0;
+    char const *start = c->hay.str;
+    char const *const end = c->hay.str + c->hay.len;
+    for (;;) {
+        char const *const p = memmem(start, (size_t)(end - start),
+                                     c->pattern.str, c->pattern.len);
+        char const *const stop = p ? p : end;
+        found += stop != start;
+        if (!p) {
+            return found;
+        }
+        start = p + c->pattern.len;
+    }
+}
+
+static size_t
+sv_find_first_of(struct Case const *const c) {
+    size_t found = 0;
+    SV_Str_view rest = c->hay;
+    for (;;) {
+        size_t const pos = SV_find_first_of(rest, c->pattern);
+        if (pos >= rest.len) {
+            return found;
+        }
+        ++found;
+        rest = (SV_Str_view){.str = rest.str + pos + 1,
+                             .len = rest.len - pos - 1};
+    }
+}
+
+static size_t
+sv_find_last_of(struct Case const *const c) {
+    size_t found = 0;
+    SV_Str_view rest = c->hay;
+    for (;;) {
+        size_t const pos = SV_find_last_of(rest, c->pattern);
+        if (pos >= rest.len) {
+            return found;
+        }
+        ++found;
+        rest.len = pos;
+    }
+}
+
+/* The set string of a case is null terminated for strcspn and strspn. Both
+   directions of the set searches find every planted byte, so this counts
+   the matches of SV_find_last_of as well. */
+static size_t
+libc_find_first_of(struct Case const *const c) {
+    size_t found = 0;
+    char const *const end = c->hay.str + c->hay.len;
+    for (char const *p = c->hay.str + strcspn(c->hay.str, c->pattern.str);
+         p < end; p += 1 + strcspn(p + 1, c->pattern.str)) {
+        ++found;
+    }
+    return found;
+}
+
+static size_t
+sv_find_first_not_of(struct Case const *const c) {
+    size_t found = 0;
+    SV_Str_view rest = c->hay;
+    for (;;) {
+        size_t const pos = SV_find_first_not_of(rest, c->pattern);
+        if (pos >= rest.len) {
+            return found;
+        }
+        ++found;
+        rest = (SV_Str_view){.str = rest.str + pos + 1,
+                             .len = rest.len - pos - 1};
+    }
+}
+
+static size_t
+libc_find_first_not_of(struct Case const *const c) {
+    size_t found = 0;
+    char const *const end = c->hay.str + c->hay.len;
+    for (char const *p = c->hay.str + strspn(c->hay.str, c->pattern.str);
+         p < end; p += 1 + strspn(p + 1, c->pattern.str)) {
+        ++found;
+    }
+    return found;
+}
+
+static size_t
+sv_compare(struct Case const *const c) {
+    SV_Str_view const rhs = {.str = c->rhs, .len = c->hay.len};
+    return SV_compare(c->hay, rhs) == SV_ORDER_LESSER;
+}
+
+static size_t
+libc_compare(struct Case const *const c) {
+    return memcmp(c->hay.str, c->rhs, c->hay.len) < 0;
+}
+
+/* ============================   Driver   ================================= */
+
+/* str_view.c compiles its AVX2 kernels with a target attribute on x86-64
+   GCC and Clang builds without AVX2 and runs them when the processor reports
+   AVX2. This follows the same test. */
+static char const *
+runtime_tier(void) {
+#if !defined(__AVX2__) && defined(__x86_64__)                                  \
+    && (defined(__GNUC__) || defined(__clang__))
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+#endif
+    return SV_BENCH_TIER;
+}
+
+static bool
+parse_options(int const argc, char **const argv, struct Options *const opt) {
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--perf")) {
+            opt->perf = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            return false;
+        }
+        char *const value = argv[++i];
+        char *end = NULL;
+        if (!strcmp(argv[i - 1], "--max-bytes")) {
+            opt->max_bytes = strtoull(value, &end, 10);
+        } else if (!strcmp(argv[i - 1], "--min-ms")) {
+            opt->min_ns = strtoull(value, &end, 10) * 1000000;
+        } else if (!strcmp(argv[i - 1], "--op")) {
+            opt->op = value;
+        } else if (!strcmp(argv[i - 1], "--threads")) {
+            opt->max_threads = strtoull(value, &end, 10);
+        } else if (!strcmp(argv[i - 1], "--output")) {
+            opt->out = fopen(value, "w");
+            if (!opt->out) {
+                perror(value);
+                return false;
+            }
+        } else {
+            return false;
+        }
+        if (end && (*end || end == value)) {
+            return false;
+        }
+    }
+    return opt->max_bytes >= levels[0].bytes && opt->max_threads;
+}
+
+/* Sweeps every density, pattern length, and level of one operation. The
+   haystacks of all levels are prefixes of one buffer planted once per density
+   and pattern. */
+static bool
+run_op(struct Op const *const op, struct Options const *const opt,
+       char *const base, char *const work, char *const rhs, bool *const first) {
+    size_t bytes = 0;
+    size_t nlevels = 0;
+    for (; nlevels < sizeof(levels) / sizeof(levels[0])
+           && levels[nlevels].bytes <= opt->max_bytes;
+         ++nlevels) {
+        bytes = levels[nlevels].bytes;
+    }
+    size_t nlens = 0;
+    size_t const *const lens = pattern_lens(op->pattern, &nlens);
+    char pattern[MAX_NEEDLE_LEN + 1];
+    bool ok = true;
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d) {
+        size_t const density = densities[d];
+        if (op->pattern == PATTERN_NONE && density) {
+            continue;
+        }
+        for (size_t i = 0; i < nlens; ++i) {
+            size_t const len = lens[i];
+            if (op->pattern == PATTERN_NEEDLE && density && len >= density) {
+                break;
+            }
+            make_pattern(op->pattern, pattern, len);
+            memcpy(work, base, bytes + 1);
+            plant(work, bytes, density, pattern,
+                  op->pattern == PATTERN_NEEDLE ? len : 1);
+            memcpy(rhs, work, bytes + 1);
+            struct Case c = {
+                .pattern = {.str = pattern, .len = len},
+                .rhs = rhs,
+            };
+            c.needle = SV_needle(c.pattern);
+            for (size_t l = 0; l < nlevels; ++l) {
+                size_t const n = levels[l].bytes;
+                char const saved = work[n];
+                work[n] = '\0';
+                /* Compared views differ only in their last byte. */
+                ++rhs[n - 1];
+                c.hay = (SV_Str_view){.str = work, .len = n};
+                ok = run_case(op, opt, &c, &levels[l], density, first) && ok;
+                --rhs[n - 1];
+                work[n] = saved;
+            }
+        }
+    }
+    return ok;
+}
+
+/* Returns the pattern lengths swept for a pattern shape. */
+static size_t const *
+pattern_lens(enum Pattern const shape, size_t *const n) {
+    switch (shape) {
+        case PATTERN_NEEDLE:
+            *n = sizeof(needle_lens) / sizeof(needle_lens[0]);
+            return needle_lens;
+        case PATTERN_SET:
+            *n = sizeof(set_lens) / sizeof(set_lens[0]);
+            return set_lens;
+        case PATTERN_LETTERS:
+            *n = 1;
+            return &letters_len;
+        case PATTERN_BYTE:
+        case PATTERN_NONE:
+            break;
+    }
+    *n = 1;
+    return &byte_len;
+}
+
+/* Writes a null terminated pattern of len bytes. Needles are seeded by their
+   length so every run searches for the same needles. */
+static void
+make_pattern(enum Pattern const shape, char *const pattern, size_t const len) {
+    switch (shape) {
+        case PATTERN_NEEDLE: {
+            uint64_t seed = len;
+            fill_letters(pattern, len, &seed);
+        } break;
+        case PATTERN_SET:
+            memcpy(pattern, absent_set, len);
+            break;
+        case PATTERN_LETTERS:
+            memcpy(pattern, letters, len);
+            break;
+        case PATTERN_BYTE:
+        case PATTERN_NONE:
+            pattern[0] = PLANT;
+            break;
+    }
+    pattern[len] = '\0';
+}
+
+/* Times both implementations of one case and prints their result. A case
+   whose implementations disagree is still printed so the mismatch is
+   recorded, but fails the run. */
+static bool
+run_case(struct Op const *const op, struct Options const *const opt,
+         struct Case const *const c, struct Level const *const level,
+         size_t const density, bool *const first) {
+    size_t const sv_matches = op->sv_run(c);
+    size_t const libc_matches = op->libc_run(c);
+    struct Timing const sv = time_run(op->sv_run, c, opt);
+    struct Timing const libc = time_run(op->libc_run, c, opt);
+    fprintf(opt->out,
+            "%s{\"op\":\"%s\",\"sv\":\"%s\",\"libc\":\"%s\","
+            "\"level\":\"%s\",\"bytes\":%zu,\"pattern_len\":%zu,"
+            "\"planted_every\":%zu,\"matches\":%zu,\"libc_matches\":%zu,"
+            "\"sv_ns\":%llu,\"libc_ns\":%llu,\"sv_gbps\":%.3f,"
+            "\"libc_gbps\":%.3f",
+            *first ? "" : ",\n", op->name, op->sv, op->libc, level->name,
+            c->hay.len, c->pattern.len, density, sv_matches, libc_matches,
+            (unsigned long long)sv.ns, (unsigned long long)libc.ns,
+            gbps(c->hay.len, sv.ns), gbps(c->hay.len, libc.ns));
+    if (opt->counters) {
+        print_counters(opt->out, "sv", &sv, c->hay.len);
+        print_counters(opt->out, "libc", &libc, c->hay.len);
+    }
+    fputc('}', opt->out);
+    fflush(opt->out);
+    *first = false;
+    if (sv_matches != libc_matches) {
+        fprintf(stderr, "%s: %s found %zu matches but %s found %zu\n",
+                op->name, op->sv, sv_matches, op->libc, libc_matches);
+        return false;
+    }
+    return true;
+}
+
+/* Returns the fastest time of one run over ROUNDS rounds that each repeat
+   the run for at least the minimum time. Counters, if open, run across all
+   rounds and are averaged over every run. */
+static struct Timing
+time_run(Run *const run, struct Case const *const c,
+         struct Options const *const opt) {
+    struct Timing t = {.ns = UINT64_MAX};
+    if (opt->counters) {
+        counters_start(opt->counters);
+    }
+    for (int r = 0; r < ROUNDS; ++r) {
+        uint64_t const start = now_ns();
+        uint64_t elapsed = 0;
+        uint64_t runs = 0;
+        do {
+            sink = run(c);
+            ++runs;
+            elapsed = now_ns() - start;
+        } while (elapsed < opt->min_ns);
+        if (elapsed / runs < t.ns) {
+            t.ns = elapsed / runs;
+        }
+        t.runs += runs;
+    }
+    if (opt->counters) {
+        t.counted = counters_stop(opt->counters, &t.counts);
+    }
+    return t;
+}
+
+/* Prints the counters of one implementation as a JSON object member. Per
+   call totals include the clock reads between runs, which are small next to
+   the smallest haystack. */
+static void
+print_counters(FILE *const out, char const *const impl,
+               struct Timing const *const t, size_t const bytes) {
+    fprintf(out, ",\"%s_perf\":{", impl);
+    bool const cycles = t->counted && t->counts.valid[COUNTER_CYCLES];
+    bool const ins = t->counted && t->counts.valid[COUNTER_INSTRUCTIONS];
+    double const calls = (double)t->runs;
+    if (cycles) {
+        fprintf(out, "\"cycles_per_byte\":%.4f",
+                (double)t->counts.values[COUNTER_CYCLES]
+                    / (calls * (double)bytes));
+    } else {
+        fprintf(out, "\"cycles_per_byte\":null");
+    }
+    if (cycles && ins && t->counts.values[COUNTER_CYCLES]) {
+        fprintf(out, ",\"ipc\":%.3f",
+                (double)t->counts.values[COUNTER_INSTRUCTIONS]
+                    / (double)t->counts.values[COUNTER_CYCLES]);
+    } else {
+        fprintf(out, ",\"ipc\":null");
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (t->counted && t->counts.valid[i]) {
+            fprintf(out, ",\"%s\":%.1f", counter_names[i],
+                    (double)t->counts.values[i] / calls);
+        } else {
+            fprintf(out, ",\"%s\":null", counter_names[i]);
+        }
+    }
+    fputc('}', out);
+}
+
+#ifdef SV_BENCH_DEDUP
+
+/* ==========================   Deduplication   ============================ */
+
+/* Builds the two dedup streams from one list of distinct words: every word
+   once, so each insert copies, and a stream where word k of the list is
+   drawn about as often as 1 / k, so most inserts find a repeat as in real
+   text. */
+static bool
+run_dedup(struct Options const *const opt, bool *const first) {
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    char *const buf = malloc(DEDUP_WORDS * (DEDUP_WORD_MAX + 1));
+    SV_Str_view *const words = buf ? make_words(buf, DEDUP_WORDS, &seed) : NULL;
+    SV_Str_view *const stream = malloc(DEDUP_STREAM * sizeof(*stream));
+    if (!words || !stream) {
+        fprintf(stderr, "cannot allocate the dedup streams\n");
+        free(buf);
+        free(words);
+        free(stream);
+        return false;
+    }
+    size_t word_bytes = 0;
+    for (size_t i = 0; i < DEDUP_WORDS; ++i) {
+        word_bytes += words[i].len;
+    }
+    size_t stream_bytes = 0;
+    for (size_t i = 0; i < DEDUP_STREAM; ++i) {
+        size_t const bound = (size_t)1
+                          << (next_random(&seed) % (DEDUP_WORD_BITS + 1));
+        stream[i] = words[next_random(&seed) % bound];
+        stream_bytes += stream[i].len;
+    }
+    struct Dedup_case const cases[] = {
+        {"distinct", words, DEDUP_WORDS, word_bytes},
+        {"repeats", stream, DEDUP_STREAM, stream_bytes},
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        ok = run_dedup_case(&cases[i], opt, first) && ok;
+    }
+    free(buf);
+    free(words);
+    free(stream);
+    return ok;
+}
+
+/* Times one stream at each thread count of the sweep. Every thread count
+   must leave the same number of distinct words in the set. */
+static bool
+run_dedup_case(struct Dedup_case const *const c,
+               struct Options const *const opt, bool *const first) {
+    bool ok = true;
+    uint64_t single_ns = 0;
+    size_t single_distinct = 0;
+    for (size_t threads = 1;; threads *= 2) {
+        if (threads > opt->max_threads) {
+            threads = opt->max_threads;
+        }
+        SV_Pool *const pool = threads > 1 ? SV_pool_create(threads) : NULL;
+        size_t const started = pool ? SV_pool_threads(pool) : 1;
+        uint64_t ns = 0;
+        size_t distinct = 0;
+        bool const inserted
+            = time_dedup(c, pool, started * DEDUP_SLICES_PER_THREAD, &ns,
+                         &distinct);
+        SV_pool_destroy(pool);
+        if (threads == 1) {
+            single_ns = ns;
+            single_distinct = distinct;
+        }
+        fprintf(opt->out,
+                "%s{\"op\":\"dedup\",\"sv\":\"SV_dedup_insert\","
+                "\"stream\":\"%s\",\"threads\":%zu,\"words\":%zu,"
+                "\"bytes\":%zu,\"distinct\":%zu,\"sv_ns\":%llu,"
+                "\"sv_gbps\":%.3f,\"words_per_us\":%.2f,\"speedup\":%.2f}",
+                *first ? "" : ",\n", c->name, started, c->n, c->bytes,
+                distinct, (unsigned long long)ns, gbps(c->bytes, ns),
+                ns ? (double)c->n * 1000.0 / (double)ns : 0.0,
+                ns ? (double)single_ns / (double)ns : 0.0);
+        fflush(opt->out);
+        *first = false;
+        if (!inserted) {
+            fprintf(stderr, "dedup: an insert of the %s stream failed with "
+                            "%zu threads\n",
+                    c->name, started);
+            ok = false;
+        } else if (distinct != single_distinct) {
+            fprintf(stderr, "dedup: %zu threads kept %zu distinct words of "
+                            "the %s stream but one thread kept %zu\n",
+                    started, distinct, c->name, single_distinct);
+            ok = false;
+        }
+        if (threads == opt->max_threads) {
+            break;
+        }
+    }
+    return ok;
+}
+
+/* Returns the fastest of ROUNDS runs that each insert the whole stream into
+   a new set. Creating the set and its arenas is not timed. */
+static bool
+time_dedup(struct Dedup_case const *const c, SV_Pool *const pool,
+           size_t const slices, uint64_t *const ns, size_t *const distinct) {
+    SV_Dedup_arena **const arenas = malloc(slices * sizeof(*arenas));
+    if (!arenas) {
+        return false;
+    }
+    bool ok = true;
+    *ns = UINT64_MAX;
+    for (int r = 0; r < ROUNDS && ok; ++r) {
+        SV_Dedup_set *const set = SV_dedup_create(DEDUP_WORDS);
+        ok = set != NULL;
+        for (size_t i = 0; ok && i < slices; ++i) {
+            arenas[i] = SV_dedup_arena(set);
+            ok = arenas[i] != NULL;
+        }
+        if (ok) {
+            struct Dedup_run run = {
+                .c = c,
+                .arenas = arenas,
+                .slices = slices,
+            };
+            atomic_init(&run.failed, false);
+            uint64_t const start = now_ns();
+            SV_pool_for(pool, slices, dedup_slice, &run);
+            uint64_t const elapsed = now_ns() - start;
+            if (elapsed < *ns) {
+                *ns = elapsed;
+            }
+            ok = !atomic_load(&run.failed);
+            *distinct = SV_dedup_size(set);
+        }
+        SV_dedup_destroy(set);
+    }
+    free(arenas);
+    return ok;
+}
+
+/* Inserts one slice of the stream with the slice's own arena. */
+static void
+dedup_slice(void *const arg, size_t const i) {
+    struct Dedup_run *const run = arg;
+    size_t const n = run->c->n;
+    size_t const begin = n * i / run->slices;
+    size_t const end = n * (i + 1) / run->slices;
+    bool failed = false;
+    for (size_t w = begin; w < end; ++w) {
+        failed |= !SV_dedup_insert(run->arenas[i], run->c->words[w]).str;
+    }
+    if (failed) {
+        atomic_store(&run->failed, true);
+    }
+}
+
+/* Writes n random lowercase words into buf, each followed by a null
+   terminator, and returns their views or NULL if they could not be
+   allocated. Words may repeat by chance, which the sweep checks for by
+   comparing distinct counts rather than expecting n. */
+static SV_Str_view *
+make_words(char *const buf, size_t const n, uint64_t *const seed) {
+    SV_Str_view *const words = malloc(n * sizeof(*words));
+    if (!words) {
+        return NULL;
+    }
+    char *w = buf;
+    for (size_t i = 0; i < n; ++i) {
+        size_t const len
+            = DEDUP_WORD_MIN
+            + (next_random(seed) % (DEDUP_WORD_MAX - DEDUP_WORD_MIN + 1));
+        fill_letters(w, len, seed);
+        w[len] = '\0';
+        words[i] = (SV_Str_view){.str = w, .len = len};
+        w += len + 1;
+    }
+    return words;
+}
+
+#endif /* SV_BENCH_DEDUP */
+
+static uint64_t
+now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void
+fill_letters(char *const buf, size_t const n, uint64_t *const seed) {
+    for (size_t i = 0; i < n; ++i) {
+        buf[i] = letters[next_random(seed) % (sizeof(letters) - 1)];
+    }
+}
+
+/* Copies the pattern into the buffer every density bytes, starting one
+   interval in so the first match is not at the start. */
+static void
+plant(char *const buf, size_t const n, size_t const density,
+      char const *const pattern, size_t const len) {
+    if (!density) {
+        return;
+    }
+    for (size_t i = density - 1; i + len <= n; i += density) {
+        memcpy(buf + i, pattern, len);
+    }
+}
+
+/* A splitmix64 step. */
+static uint64_t
+next_random(uint64_t *const seed) {
+    uint64_t z = (*seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double
+gbps(size_t const bytes, uint64_t const ns) {
+    return ns ? (double)bytes / (double)ns : 0.0;
+}
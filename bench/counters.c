@@ -0,0 +1,172 @@
+/* This file reads hardware counters with the Linux perf_event_open system
+   call. Counters are opened as one group so a single read returns all of them
+   for the same interval. Elsewhere, or where the headers are missing, opening
+   always fails and the benchmarks report timing alone. */
+#include "counters.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SV_BENCH_PERF
+#    include <linux/perf_event.h>
+#    include <stddef.h>
+#    include <string.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+char const *const counter_names[COUNTER_COUNT] = {
+    [COUNTER_CYCLES] = "cycles",
+    [COUNTER_INSTRUCTIONS] = "instructions",
+    [COUNTER_BRANCH_MISSES] = "branch_misses",
+    [COUNTER_L1D_MISSES] = "l1d_misses",
+    [COUNTER_LLC_MISSES] = "llc_misses",
+};
+
+#ifdef SV_BENCH_PERF
+
+/* The layout of a group read with both running times. */
+struct Group_read {
+    uint64_t nr;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[COUNTER_COUNT];
+};
+
+static int open_event(enum Counter, int group_fd);
+
+bool
+counters_open(struct Counters *const counters) {
+    counters->leader = -1;
+    counters->open = 0;
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        counters->fds[c] = open_event((enum Counter)c, counters->leader);
+        counters->slot[c] = -1;
+        if (counters->fds[c] < 0) {
+            continue;
+        }
+        if (counters->leader < 0) {
+            counters->leader = counters->fds[c];
+        }
+        counters->slot[c] = counters->open++;
+    }
+    return counters->open > 0;
+}
+
+void
+counters_start(struct Counters const *const counters) {
+    ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+bool
+counters_stop(struct Counters const *const counters,
+              struct Counts *const counts) {
+    ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    struct Group_read read_buf;
+    ssize_t const got = read(counters->leader, &read_buf, sizeof(read_buf));
+    if (got < (ssize_t)offsetof(struct Group_read, values)
+        || read_buf.nr != (uint64_t)counters->open) {
+        return false;
+    }
+    /* The kernel runs a group only part of the time when it has more groups
+       than hardware counters. Scaling estimates the full interval. */
+    double const scale
+        = read_buf.time_running
+            ? (double)read_buf.time_enabled / (double)read_buf.time_running
+            : 0.0;
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        counts->valid[c] = counters->slot[c] >= 0 && scale > 0.0;
+        counts->values[c]
+            = counts->valid[c]
+                ? (uint64_t)((double)read_buf.values[counters->slot[c]] * scale)
+                : 0;
+    }
+    return true;
+}
+
+void
+counters_close(struct Counters *const counters) {
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        if (counters->fds[c] >= 0) {
+            close(counters->fds[c]);
+            counters->fds[c] = -1;
+        }
+    }
+    counters->leader = -1;
+    counters->open = 0;
+}
+
+/* Opens one counter of the calling thread on any CPU, counting user space
+   only so the benchmarks run without elevated permissions. Only the leader
+   starts disabled; the others follow it. */
+static int
+open_event(enum Counter const counter, int const group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+        case COUNTER_CYCLES:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case COUNTER_INSTRUCTIONS:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case COUNTER_BRANCH_MISSES:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case COUNTER_L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D
+                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case COUNTER_LLC_MISSES:
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case COUNTER_COUNT:
+            return -1;
+    }
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+                     | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+#else /* !SV_BENCH_PERF */
+
+bool
+counters_open(struct Counters *const counters) {
+    counters->leader = -1;
+    counters->open = 0;
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        counters->fds[c] = -1;
+        counters->slot[c] = -1;
+    }
+    return false;
+}
+
+void
+counters_start(struct Counters const *const counters) {
+    (void)counters;
+}
+
+bool
+counters_stop(struct Counters const *const counters,
+              struct Counts *const counts) {
+    (void)counters;
+    (void)counts;
+    return false;
+}
+
+void
+counters_close(struct Counters *const counters) {
+    counters->leader = -1;
+    counters->open = 0;
+}
+
+#endif /* SV_BENCH_PERF */
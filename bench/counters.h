@@ -0,0 +1,53 @@
+/* Hardware performance counters for the benchmarks. On Linux the counters are
+   read with perf_event_open for the calling thread in user space only. Any
+   event the kernel or hardware refuses is left out and reported as missing,
+   and on other platforms or without permission no counter opens at all. */
+#ifndef SV_BENCH_COUNTERS_H
+#define SV_BENCH_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum Counter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_COUNT,
+};
+
+/* A group of open counters read together. The first counter opened leads the
+   group so all of them count over exactly the same instructions. */
+struct Counters {
+    int leader;
+    int fds[COUNTER_COUNT];
+    /* The position of each open counter in a group read. */
+    int slot[COUNTER_COUNT];
+    int open;
+};
+
+/* The totals of one measured interval, scaled up if the kernel multiplexed
+   the counters. */
+struct Counts {
+    uint64_t values[COUNTER_COUNT];
+    bool valid[COUNTER_COUNT];
+};
+
+/* The JSON key of each counter. */
+extern char const *const counter_names[COUNTER_COUNT];
+
+/* Opens every counter available. Returns false if none could be opened, in
+   which case the counters need not be closed. */
+bool counters_open(struct Counters *counters);
+
+/* Resets and starts the counters. */
+void counters_start(struct Counters const *counters);
+
+/* Stops the counters and reads their totals since the last start. Returns
+   false if the read failed. */
+bool counters_stop(struct Counters const *counters, struct Counts *counts);
+
+void counters_close(struct Counters *counters);
+
+#endif /* SV_BENCH_COUNTERS_H */
@@ -0,0 +1,473 @@
+/* This file is the training workload of a profile guided build. It runs the
+   search, tokenization, and comparison paths of str_view over corpora shaped
+   like the text the library sees in practice so the recorded profile weighs
+   each branch the way real programs do. Byte and set searches walk every
+   match in both directions, including bytes and sets that never match, so
+   the long scans between matches are trained as well as the matches. Files named on the command line are
+   used as corpora. Without any, three are generated: English prose, CSV
+   records, and server log lines.
+
+   The workload is deterministic and prints a checksum of its results so the
+   work cannot be optimized away and two runs can be compared.
+
+   Usage: sv_train [--rounds N] [FILE...] */
+#include "str_view.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The bytes of each generated corpus. */
+#define CORPUS_BYTES ((size_t)4 << 20)
+
+/* Passes over every corpus unless --rounds says otherwise. */
+#define DEFAULT_ROUNDS 1
+
+/* The most words collected from a corpus for sorting and comparison. */
+#define MAX_WORDS ((size_t)1 << 16)
+
+/* Needles searched per needle length and round. */
+#define NEEDLES_PER_LEN 2
+
+struct Corpus {
+    char const *name;
+    char *text;
+    size_t len;
+};
+
+/* Words weighted toward the front by the generator, roughly as English word
+   frequencies fall off. */
+static char const *const words[] = {
+    "the",     "of",       "and",      "to",        "a",         "in",
+    "is",      "that",     "for",      "it",        "as",        "was",
+    "with",    "be",       "by",       "on",        "not",       "he",
+    "this",    "are",      "or",       "his",       "from",      "at",
+    "which",   "but",      "have",     "an",        "had",       "they",
+    "you",     "were",     "their",    "one",       "all",       "we",
+    "can",     "her",      "has",      "there",     "been",      "if",
+    "more",    "when",     "will",     "would",     "who",       "so",
+    "string",  "view",     "search",   "token",     "buffer",    "memory",
+    "library", "function", "pointer",  "character", "delimiter", "haystack",
+    "needle",  "position", "length",   "compare",   "sequence",  "algorithm",
+    "request", "response", "document", "network",   "process",   "thread",
+};
+
+static char const *const cities[] = {
+    "Amsterdam", "Berlin", "Chicago", "Denver", "Edinburgh",
+    "Florence",  "Geneva", "Houston", "Istanbul", "Jakarta",
+};
+
+static char const *const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN",
+                                     "ERROR"};
+
+static char const *const routes[] = {
+    "/api/v1/users",  "/api/v1/orders", "/static/app.js",
+    "/health",        "/api/v2/search", "/login",
+};
+
+/* ============================   Prototypes   ============================== */
+
+static uint64_t train(struct Corpus const *, uint64_t *seed);
+static uint64_t train_search(SV_Str_view, uint64_t *seed);
+static uint64_t train_tokens(SV_Str_view);
+static uint64_t train_compare(SV_Str_view, SV_Str_view *words_buf);
+static uint64_t train_long_compare(SV_Str_view);
+static uint64_t train_scan(SV_Str_view);
+static uint64_t train_bytes(SV_Str_view);
+static uint64_t train_sets(SV_Str_view);
+static bool load(struct Corpus *, char const *path);
+static void generate_prose(struct Corpus *, uint64_t *seed);
+static void generate_csv(struct Corpus *, uint64_t *seed);
+static void generate_log(struct Corpus *, uint64_t *seed);
+static size_t append(char *buf, size_t len, size_t cap, char const *str);
+static char const *pick(char const *const *list, size_t n, uint64_t *seed);
+static uint64_t next_random(uint64_t *seed);
+
+int
+main(int argc, char **argv) {
+    int rounds = DEFAULT_ROUNDS;
+    int first_file = 1;
+    if (argc > 2 && !strcmp(argv[1], "--rounds")) {
+        rounds = atoi(argv[2]);
+        first_file = 3;
+    }
+    size_t const ncorpora = argc > first_file ? (size_t)(argc - first_file) : 3;
+    struct Corpus *const corpora = calloc(ncorpora, sizeof(*corpora));
+    SV_Str_view *const words_buf = malloc(MAX_WORDS * sizeof(*words_buf));
+    if (!corpora || !words_buf || rounds < 1) {
+        fprintf(stderr, "usage: %s [--rounds N] [FILE...]\n", argv[0]);
+        return 2;
+    }
+    uint64_t seed = 0x5EED5EED5EED5EEDULL;
+    if (argc > first_file) {
+        for (size_t i = 0; i < ncorpora; ++i) {
+            if (!load(&corpora[i], argv[first_file + (int)i])) {
+                return 1;
+            }
+        }
+    } else {
+        generate_prose(&corpora[0], &seed);
+        generate_csv(&corpora[1], &seed);
+        generate_log(&corpora[2], &seed);
+    }
+    uint64_t checksum = 0;
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < ncorpora; ++i) {
+            checksum += train(&corpora[i], &seed);
+            SV_Str_view const text = {corpora[i].text, corpora[i].len};
+            checksum += train_compare(text, words_buf);
+        }
+    }
+    for (size_t i = 0; i < ncorpora; ++i) {
+        printf("%s: %zu bytes\n", corpora[i].name, corpora[i].len);
+        free(corpora[i].text);
+    }
+    printf("checksum %llu\n", (unsigned long long)checksum);
+    free(corpora);
+    free(words_buf);
+    return 0;
+}
+
+/* ============================   Workload   =============================== */
+
+static uint64_t
+train(struct Corpus const *const corpus, uint64_t *const seed) {
+    SV_Str_view const text = {corpus->text, corpus->len};
+    return train_search(text, seed) + train_tokens(text) + train_scan(text)
+         + train_bytes(text) + train_sets(text) + train_long_compare(text);
+}
+
+/* Searches for needles cut from the text itself, so most are found, and for
+   the same needles with a changed last byte, so some are not. Short needles
+   take the direct paths and longer ones the two-way paths. */
+static uint64_t
+train_search(SV_Str_view const text, uint64_t *const seed) {
+    static size_t const lens[] = {1, 2, 3, 4, 5, 8, 12, 16, 32, 64};
+    uint64_t sum = 0;
+    char miss[64];
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l) {
+        size_t const len = lens[l];
+        for (size_t k = 0; k < NEEDLES_PER_LEN && text.len > len; ++k) {
+            size_t const at = next_random(seed) % (text.len - len);
+            SV_Str_view const needle = {text.str + at, len};
+            sum += SV_count(text, needle);
+            sum += SV_find(text, 0, needle);
+            sum += SV_reverse_find(text, text.len, needle);
+            SV_Needle const pre = SV_needle(needle);
+            for (size_t pos = SV_needle_find(text, 0, &pre), n = 0;
+                 pos < text.len && n < 1024;
+                 pos = SV_needle_find(text, pos + 1, &pre), ++n) {
+                sum += pos;
+            }
+            memcpy(miss, needle.str, len);
+            miss[len - 1] = (char)~miss[len - 1];
+            SV_Str_view const absent = {miss, len};
+            sum += SV_contains(text, absent);
+            sum += SV_match(text, absent).len;
+            sum += SV_reverse_match(text, needle).len;
+        }
+    }
+    return sum;
+}
+
+/* Splits the text into lines, each line into fields or words, and walks the
+   lines backwards as well. */
+static uint64_t
+train_tokens(SV_Str_view const text) {
+    SV_Str_view const newline = SV_from("\n");
+    SV_Str_view const space = SV_from(" ");
+    SV_Str_view const comma = SV_from(",");
+    SV_Str_view const comma_space = SV_from(", ");
+    uint64_t sum = 0;
+    for (SV_Str_view line = SV_token_begin(text, newline);
+         !SV_token_end(text, line); line = SV_token_next(text, line, newline)) {
+        SV_Str_view const delim
+            = SV_contains(line, comma_space)
+                ? comma_space
+                : (SV_find(line, 0, comma) < line.len ? comma : space);
+        for (SV_Str_view tok = SV_token_begin(line, delim);
+             !SV_token_end(line, tok); tok = SV_token_next(line, tok, delim)) {
+            sum += tok.len;
+        }
+    }
+    for (SV_Str_view line = SV_token_reverse_begin(text, newline);
+         !SV_token_reverse_end(text, line);
+         line = SV_token_reverse_next(text, line, newline)) {
+        sum += line.len;
+    }
+    return sum;
+}
+
+/* Collects words, sorts them, and compares neighbors and prefixes. */
+static uint64_t
+train_compare(SV_Str_view const text, SV_Str_view *const words_buf) {
+    SV_Str_view const delims = SV_from(" \n,.:;=\"/");
+    size_t n = 0;
+    SV_Str_view rest = text;
+    while (n < MAX_WORDS && rest.len) {
+        rest = SV_remove_prefix(rest, SV_find_first_not_of(rest, delims));
+        size_t const end = SV_find_first_of(rest, delims);
+        if (end) {
+            words_buf[n++] = SV_substr(rest, 0, end);
+        }
+        rest = SV_remove_prefix(rest, end);
+    }
+    SV_sort(words_buf, n);
+    uint64_t sum = n;
+    for (size_t i = 1; i < n; ++i) {
+        sum += (uint64_t)SV_compare(words_buf[i - 1], words_buf[i]);
+        sum += SV_starts_with(words_buf[i], words_buf[i - 1]);
+        sum += SV_ends_with(words_buf[i], SV_substr(words_buf[i - 1], 0, 2));
+        sum += (uint64_t)SV_terminated_compare(words_buf[i], "the");
+    }
+    return sum;
+}
+
+/* Compares prefixes of the text, from a line to all of it, with a copy that
+   differs in its last byte, as when checking large records or files for
+   equality. */
+static uint64_t
+train_long_compare(SV_Str_view const text) {
+    char *const copy = malloc(text.len + 1);
+    if (!copy || !text.len) {
+        free(copy);
+        return 0;
+    }
+    memcpy(copy, text.str, text.len);
+    uint64_t sum = 0;
+    for (size_t len = 64; len <= text.len; len *= 2) {
+        ++copy[len - 1];
+        for (size_t k = 0; k < 8; ++k) {
+            sum += (uint64_t)SV_compare(text, (SV_Str_view){copy, len});
+            sum += (uint64_t)SV_compare(SV_substr(text, 0, len),
+                                        (SV_Str_view){copy, len});
+        }
+        --copy[len - 1];
+    }
+    free(copy);
+    return sum;
+}
+
+/* Scans for sets of bytes the way parsers skip whitespace and find field
+   ends, and indexes lines. */
+static uint64_t
+train_scan(SV_Str_view const text) {
+    SV_Str_view const ends = SV_from(",;\n\"");
+    SV_Str_view const blank = SV_from(" \t");
+    uint64_t sum = SV_line_count(text);
+    for (SV_Str_view rest = text; rest.len;) {
+        size_t const at = SV_find_first_of(rest, ends);
+        SV_Str_view const field = SV_trim(SV_substr(rest, 0, at), blank);
+        sum += field.len;
+        rest = SV_remove_prefix(rest, at + 1);
+    }
+    sum += SV_find_last_of(text, ends);
+    sum += SV_find_last_not_of(text, blank);
+    sum += SV_utf8_valid(text);
+    return sum;
+}
+
+/* Walks every occurrence of common and absent bytes forward and backward,
+   as line splitters and parsers searching from the end do. */
+static uint64_t
+train_bytes(SV_Str_view const text) {
+    static char const bytes[] = {'\n', ',', ' ', '"', '\x01'};
+    uint64_t sum = 0;
+    for (size_t b = 0; b < sizeof(bytes); ++b) {
+        SV_Str_view const byte = {bytes + b, 1};
+        for (size_t pos = SV_find(text, 0, byte); pos < text.len;
+             pos = SV_find(text, pos + 1, byte)) {
+            sum += pos;
+        }
+        for (size_t pos = SV_reverse_find(text, text.len, byte);
+             pos < text.len; pos = SV_reverse_find(text, pos - 1, byte)) {
+            sum += pos;
+            if (!pos) {
+                break;
+            }
+        }
+    }
+    return sum;
+}
+
+/* Walks every match of sets of one to sixteen bytes, some present and some
+   absent, from the front and the back, and skips runs of the bytes of a
+   set the way tokenizers skip letters or whitespace. */
+static uint64_t
+train_sets(SV_Str_view const text) {
+    static SV_Str_view const sets[] = {
+        {"\n", 1},
+        {",\n", 2},
+        {",;\n\"", 4},
+        {"#$%&*+-<", 8},
+        {"\n#$%&*+,-./:;<=>?", 16},
+    };
+    static SV_Str_view const runs[] = {
+        {" ", 1},
+        {"abcdefghijklmnopqrstuvwxyz", 26},
+        {"abcdefghijklmnopqrstuvwxyz ", 27},
+    };
+    uint64_t sum = 0;
+    for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s) {
+        for (SV_Str_view rest = text; rest.len;) {
+            size_t const at = SV_find_first_of(rest, sets[s]);
+            sum += at;
+            rest = SV_remove_prefix(rest, at + 1);
+        }
+        for (SV_Str_view rest = text; rest.len;) {
+            size_t const at = SV_find_last_of(rest, sets[s]);
+            if (at >= rest.len) {
+                break;
+            }
+            sum += at;
+            rest = SV_substr(rest, 0, at);
+        }
+    }
+    for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); ++r) {
+        for (SV_Str_view rest = text; rest.len;) {
+            size_t const at = SV_find_first_not_of(rest, runs[r]);
+            sum += at;
+            rest = SV_remove_prefix(rest, at + 1);
+        }
+        for (SV_Str_view rest = text; rest.len;) {
+            size_t const at = SV_find_last_not_of(rest, runs[r]);
+            if (at >= rest.len) {
+                break;
+            }
+            sum += at;
+            rest = SV_substr(rest, 0, at);
+        }
+    }
+    return sum;
+}
+
+/* ============================   Corpora   ================================ */
+
+static bool
+load(struct Corpus *const corpus, char const *const path) {
+    FILE *const f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    size_t cap = 1 << 16;
+    size_t len = 0;
+    char *text = malloc(cap);
+    size_t got = 0;
+    while (text && (got = fread(text + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) {
+            char *const grown = realloc(text, cap *= 2);
+            if (!grown) {
+                free(text);
+            }
+            text = grown;
+        }
+    }
+    fclose(f);
+    if (!text) {
+        fprintf(stderr, "cannot load %s\n", path);
+        return false;
+    }
+    *corpus = (struct Corpus){.name = path, .text = text, .len = len};
+    return true;
+}
+
+static void
+generate_prose(struct Corpus *const corpus, uint64_t *const seed) {
+    char *const text = malloc(CORPUS_BYTES);
+    size_t len = 0;
+    size_t line = 0;
+    size_t const nwords = sizeof(words) / sizeof(words[0]);
+    while (text && len + 32 < CORPUS_BYTES) {
+        /* Squaring a uniform pick favors the front of the list. */
+        uint64_t const r = next_random(seed) % nwords;
+        char const *const word = words[r * r / nwords];
+        size_t const before = len;
+        len = append(text, len, CORPUS_BYTES, word);
+        uint64_t const p = next_random(seed) % 16;
+        len = append(text, len, CORPUS_BYTES,
+                     p == 0 ? ". " : (p == 1 ? ", " : " "));
+        line += len - before;
+        if (line > 72) {
+            text[len - 1] = '\n';
+            line = 0;
+        }
+    }
+    *corpus = (struct Corpus){.name = "prose", .text = text, .len = len};
+}
+
+static void
+generate_csv(struct Corpus *const corpus, uint64_t *const seed) {
+    char *const text = malloc(CORPUS_BYTES);
+    size_t len = 0;
+    char num[32];
+    for (uint64_t id = 1; text && len + 128 < CORPUS_BYTES; ++id) {
+        snprintf(num, sizeof(num), "%llu,", (unsigned long long)id);
+        len = append(text, len, CORPUS_BYTES, num);
+        len = append(text, len, CORPUS_BYTES,
+                     pick(words, sizeof(words) / sizeof(words[0]), seed));
+        len = append(text, len, CORPUS_BYTES, ",");
+        len = append(text, len, CORPUS_BYTES,
+                     pick(cities, sizeof(cities) / sizeof(cities[0]), seed));
+        snprintf(num, sizeof(num), ",%llu.%02llu,",
+                 (unsigned long long)(next_random(seed) % 10000),
+                 (unsigned long long)(next_random(seed) % 100));
+        len = append(text, len, CORPUS_BYTES, num);
+        if (next_random(seed) % 4 == 0) {
+            len = append(text, len, CORPUS_BYTES, "\"quoted, with comma\"");
+        }
+        len = append(text, len, CORPUS_BYTES, "\n");
+    }
+    *corpus = (struct Corpus){.name = "csv", .text = text, .len = len};
+}
+
+static void
+generate_log(struct Corpus *const corpus, uint64_t *const seed) {
+    char *const text = malloc(CORPUS_BYTES);
+    size_t len = 0;
+    char buf[160];
+    for (uint64_t s = 0; text && len + sizeof(buf) < CORPUS_BYTES; ++s) {
+        int const n = snprintf(
+            buf, sizeof(buf),
+            "2024-05-01T12:%02llu:%02lluZ %s server request path=%s/%llu "
+            "status=%d ms=%llu\n",
+            (unsigned long long)(s / 60 % 60), (unsigned long long)(s % 60),
+            pick(levels, sizeof(levels) / sizeof(levels[0]), seed),
+            pick(routes, sizeof(routes) / sizeof(routes[0]), seed),
+            (unsigned long long)(next_random(seed) % 100000),
+            next_random(seed) % 10 ? 200 : 404,
+            (unsigned long long)(next_random(seed) % 250));
+        memcpy(text + len, buf, (size_t)n);
+        len += (size_t)n;
+    }
+    *corpus = (struct Corpus){.name = "log", .text = text, .len = len};
+}
+
+static size_t
+append(char *const buf, size_t const len, size_t const cap,
+       char const *const str) {
+    size_t const n = strlen(str);
+    if (len + n > cap) {
+        return len;
+    }
+    memcpy(buf + len, str, n);
+    return len + n;
+}
+
+static char const *
+pick(char const *const *const list, size_t const n, uint64_t *const seed) {
+    return list[next_random(seed) % n];
+}
+
+/* A splitmix64 step. */
+static uint64_t
+next_random(uint64_t *const seed) {
+    uint64_t z = (*seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
@@ -0,0 +1,115 @@
+#!/bin/sh
+# Lists, checks, and traces the USDT probes of a str_view build configured
+# with -DSV_USDT=ON. BINARY is whatever holds the library code: the shared
+# library or a program linked with the static one.
+#
+#   etc/usdt.sh list BINARY           print the str_view probes in BINARY
+#   etc/usdt.sh check BINARY [CMD..]  fail unless every probe is present and,
+#                                     given a command, fail unless running it
+#                                     under bpftrace fires the find probes
+#   etc/usdt.sh trace BINARY [PID]    trace until interrupted with bpftrace
+#
+# A trace prints latency histograms in nanoseconds and the haystack bytes of
+# every probed function, and how often each search path was taken. The path
+# is an SV_Stats_path: 0 to 3 for needles of one to four bytes, 4 for
+# two-way, and 5 for memoized two-way.
+#
+# Entry probes pass the haystack length, start position, and pattern length.
+# Return probes pass the haystack length, pattern length, and position found,
+# plus the length of the view for functions that return one.
+set -eu
+
+functions="find reverse_find needle_find contains match reverse_match
+find_first_of find_last_of find_first_not_of find_last_not_of
+token_begin token_next token_reverse_begin token_reverse_next"
+paths="find_path reverse_find_path"
+
+usage() {
+    sed -n '2,20s/^# \{0,1\}//p' "$0" >&2
+    exit 2
+}
+
+# The names of the str_view probes in the ELF notes of a binary.
+probes() {
+    readelf -n "$1" | awk '/Provider: str_view$/ {
+        getline
+        sub(/^.*Name: /, "")
+        print
+    }' | sort -u
+}
+
+expected() {
+    for f in $functions; do
+        echo "${f}_entry"
+        echo "${f}_return"
+    done
+    for p in $paths; do
+        echo "$p"
+    done
+}
+
+# A bpftrace program attached to every probe of the binary.
+program() {
+    for f in $functions; do
+        cat <<EOF
+usdt:$1:str_view:${f}_entry {
+    @${f}_start[tid] = nsecs;
+    @${f}_bytes = hist(arg0);
+    @hits = count();
+}
+usdt:$1:str_view:${f}_return /@${f}_start[tid]/ {
+    @${f}_ns = hist(nsecs - @${f}_start[tid]);
+    delete(@${f}_start[tid]);
+}
+EOF
+    done
+    for p in $paths; do
+        cat <<EOF
+usdt:$1:str_view:$p { @${p}s[arg2] = count(); @${p}_bytes = hist(arg0); }
+EOF
+    done
+    for f in $functions; do
+        echo "END { clear(@${f}_start); }"
+    done
+}
+
+[ $# -ge 2 ] || usage
+command=$1
+binary=$2
+shift 2
+[ -r "$binary" ] || { echo "cannot read $binary" >&2; exit 1; }
+
+case $command in
+    list)
+        probes "$binary"
+        ;;
+    check)
+        found=$(probes "$binary")
+        missing=""
+        for name in $(expected); do
+            echo "$found" | grep -qx "$name" || missing="$missing $name"
+        done
+        if [ -n "$missing" ]; then
+            echo "missing probes:$missing" >&2
+            exit 1
+        fi
+        echo "all $(expected | wc -l) probes present"
+        [ $# -ge 1 ] || exit 0
+        out=$(bpftrace -e "$(program "$binary")" -c "$*")
+        echo "$out"
+        hits=$(echo "$out" | awk '/^@hits:/ { print $2 }')
+        if [ "${hits:-0}" -eq 0 ]; then
+            echo "no probe fired while running: $*" >&2
+            exit 1
+        fi
+        ;;
+    trace)
+        if [ $# -ge 1 ]; then
+            exec bpftrace -p "$1" -e "$(program "$binary")"
+        fi
+        exec bpftrace -e "$(program "$binary")"
+        ;;
+    *)
+        usage
+        ;;
+esac
@@ -4,6 +4,10 @@
    string_view type. There are some minor differences and C flavor thrown
    in. Additionally, there is a provided reimplementation of the Two-Way
    String-Searching algorithm, similar to glibc. */
+/* The library compiles the accessors of the header out of line so programs
+   built either way link against it. */
+#undef SV_HEADER_ONLY
+#define SV_INLINE_DEFINITIONS
 #include "str_view.h"
 
 #include <stdbool.h>
@@ -38,8 +42,142 @@
 #    define ARR_CONST_GEQ(str, size) *const str
 #endif
 
+/* Vector instructions are selected at compile time by the flags the library
+   is built with. SSE2 is part of every x86-64 target so most builds get a
+   vector path without asking. Build with `-mavx2` or `-march=native`, or
+   configure with SV_NATIVE, to select wider tiers. Every tier has a portable
+   fallback that produces the same results one byte at a time. */
+#if defined(__AVX2__)
+#    define SIMD_AVX2 1
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define SIMD_SSE2 1
+#    include <emmintrin.h>
+#endif
+#if defined(__PCLMUL__)
+#    include <wmmintrin.h>
+#endif
+/* The UTF-8 validator and the hex and base64 decoders are the kernels that
+   gain the most from AVX2. x86-64 builds that leave AVX2 off, as default and
+   SSSE3 builds do, still compile those kernels for AVX2 with a target
+   attribute and run them when the processor reports AVX2 support. */
+#if defined(SIMD_AVX2)
+#    define SIMD_AVX2_KERNELS 1
+#    define TARGET_AVX2
+#    define HAVE_AVX2() true
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#    define SIMD_AVX2_KERNELS 1
+#    define TARGET_AVX2 __attribute__((target("avx2")))
+#    define HAVE_AVX2() __builtin_cpu_supports("avx2")
+#    include <immintrin.h>
+#endif
+/* Byte shuffles for table lookups arrive with SSSE3 and AVX2. SSSE3 builds
+   validate UTF-8 16 bytes at a time on processors without AVX2. Builds
+   limited to SSE2 elsewhere validate UTF-8 with the portable code. */
+#if defined(SIMD_AVX2_KERNELS)
+#    define SIMD_UTF8_AVX2 1
+#endif
+#if defined(__SSSE3__) && !defined(SIMD_AVX2)
+#    define SIMD_UTF8_SSSE3 1
+#    include <tmmintrin.h>
+#endif
+#if defined(SIMD_UTF8_AVX2) || defined(SIMD_UTF8_SSSE3)
+#    define SIMD_UTF8 1
+#endif
+
+/* Hints that memory will be read soon so it is in cache when it is. */
+#if defined(__GNUC__) || defined(__clang__) || defined(__INTEL_LLVM_COMPILER)
+#    define PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#    define PREFETCH(addr) (void)(addr)
+#endif
+
+/* How many views ahead of the current one a batch search prefetches. Far
+   enough to hide a miss to memory behind the search of short views. */
+#define BATCH_PREFETCH_DISTANCE 4
+
+/* The number of bytes classified at once into the bits of a uint64_t. */
+#define BLOCK_BYTES 64
+
+/* Ranges of views at most this long are finished by insertion sort, which
+   beats partitioning when every view is likely already near its place. */
+#define SORT_INSERTION_MAX 16
+
+/* Statistics count into thread local storage so threads never share a cache
+   line. Without SV_STATS the counting statements compile to nothing. */
+#ifdef SV_STATS
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        define THREAD_LOCAL __declspec(thread)
+#    else
+#        define THREAD_LOCAL _Thread_local
+#    endif
+#    define STATS_ADD(counter, n) (stats.counter += (uint64_t)(n))
+#else
+#    define STATS_ADD(counter, n) ((void)0)
+#endif
+
+/* USDT probes are compiled in with SV_USDT where sys/sdt.h is available. An
+   unattached probe is a single nop. Tools such as bpftrace and perf find the
+   probes of the str_view provider in the notes of the binary.
+
+   Every probe passes lengths and offsets, never pointers. An entry probe
+   passes the haystack length, the position the search starts from, and the
+   needle, delimiter, or set length. Its return probe passes the haystack
+   length, the same pattern length, and the position found, which is the
+   haystack length if there is none. Functions that return a view report the
+   view's offset in the haystack as that position and its length as a fourth
+   argument. Tokenizers treat the source view as the haystack and start from
+   the offset of the token passed in. The path probes pass the haystack
+   length, the needle length, and the SV_Stats_path taken. */
+#ifdef SV_USDT
+#    include <sys/sdt.h>
+#    define PROBE3(name, a, b, c) STAP_PROBE3(str_view, name, a, b, c)
+#    define PROBE4(name, a, b, c, d) STAP_PROBE4(str_view, name, a, b, c, d)
+#else
+#    define PROBE3(name, a, b, c) ((void)0)
+#    define PROBE4(name, a, b, c, d) ((void)0)
+#endif
+
+/* The offset of view v within src for the probes. The null view, which
+   stands for no result, is at the end of src. */
+#define PROBE_OFFSET(src, v)                                                   \
+    ((src).str && (v).str ? (size_t)((v).str - (src).str) : (src).len)
+
+/* Fires the entry probe of a function returning a view found in src. */
+#define PROBE_VIEW_ENTRY(name, src, start, pattern_len)                        \
+    PROBE3(name##_entry, (src).len, (size_t)(start), (pattern_len))
+
+/* Fires the return probe of a function returning the view v found in src. */
+#define PROBE_VIEW_RETURN(name, src, pattern_len, v)                           \
+    PROBE4(name##_return, (src).len, (pattern_len), PROBE_OFFSET(src, v),      \
+           (v).len)
+
+/* Records the path a search in the given direction takes, find or
+   reverse_find, for both statistics and tracing. */
+#define SEARCH_PATH(search, path, haystack_size, needle_size)                  \
+    do {                                                                       \
+        STATS_ADD(search##_paths[path], 1);                                    \
+        PROBE3(search##_path, (size_t)(haystack_size), (size_t)(needle_size),  \
+               (int)(path));                                                   \
+    } while (0)
+
 /* ========================   Type Definitions   =========================== */
 
+/* The most distinct characters of a set that are compared with a block at
+   once. Larger sets test each byte against a table. */
+#define SET_VECTOR_MAX 8
+
+/* A set of characters prepared once for scanning in either direction. */
+struct Set_class {
+    /* Membership of every byte value. */
+    SV_Charset table;
+    /* The distinct characters of the set if there are few enough. */
+    unsigned char chars[SET_VECTOR_MAX];
+    /* The number of distinct characters, which may exceed SET_VECTOR_MAX. */
+    size_t count;
+};
+
 /* Return the factorization step of two-way search in pre-compute phase. */
 struct Factorization {
     /* Position in the needle at which (local period = period). */
@@ -48,22 +186,73 @@ struct Factorization {
     ptrdiff_t period_distance;
 };
 
+/* The occurrences recorded by a search that continues past each match. */
+struct Occurrences {
+    /* The number of offsets that may be written. */
+    size_t cap;
+    /* Where the first cap occurrences are written. May be NULL. */
+    size_t *offsets;
+    /* The number of occurrences found so far. */
+    size_t found;
+};
+
+char const SV_null_str[1] = "";
+
 /* Avoid giving the user a chance to dereference null as much as possible
    by returning this for various edge cases when it makes sense to communicate
    empty, null, invalid, not found etc. Used on cases by case basis.
    The function interfaces protect us from null pointers but not always. */
 static SV_Str_view const nil = {
-    .str = "",
+    .str = SV_null_str,
     .len = 0,
 };
 
+/* The ASCII whitespace characters trimmed and collapsed by default. */
+static SV_Str_view const whitespace = {
+    .str = " \t\n\v\f\r",
+    .len = 6,
+};
+
+#ifdef SV_STATS
+/* The counters of the calling thread. */
+static THREAD_LOCAL SV_Stats stats;
+#endif
+
+/* A block of BLOCK_BYTES loaded once so that any number of byte classes may
+   be compared against it. Each comparison yields a uint64_t with bit i set
+   if byte i of the block is in the class. */
+struct Block {
+#if defined(SIMD_AVX2)
+    __m256i v[2];
+#elif defined(SIMD_SSE2)
+    __m128i v[4];
+#else
+    unsigned char const *bytes;
+#endif
+};
+
 /* =========================   Prototypes   =============================== */
 
+static SV_Str_view token_begin(SV_Str_view, SV_Str_view);
+static SV_Str_view token_next(SV_Str_view, SV_Str_view, SV_Str_view);
+static SV_Str_view token_reverse_begin(SV_Str_view, SV_Str_view);
+static SV_Str_view token_reverse_next(SV_Str_view, SV_Str_view, SV_Str_view);
+static SV_Str_view match(SV_Str_view, SV_Str_view);
+static SV_Str_view reverse_match(SV_Str_view, SV_Str_view);
+static size_t find_first_of(SV_Str_view, SV_Str_view);
+static size_t find_last_of(SV_Str_view, SV_Str_view);
+static size_t find_first_not_of(SV_Str_view, SV_Str_view);
+static size_t find_last_not_of(SV_Str_view, SV_Str_view);
 static size_t after_find(SV_Str_view, SV_Str_view);
 static size_t before_reverse_find(SV_Str_view, SV_Str_view);
 static size_t min(size_t, size_t);
 static SV_Order char_compare(char, char);
 static ptrdiff_t signed_max(ptrdiff_t, ptrdiff_t);
+static int sort_key(SV_Str_view, size_t);
+static int sort_median(int, int, int);
+static bool sort_suffix_less(SV_Str_view, SV_Str_view, size_t);
+static void sort_insertion(SV_Str_view *, size_t, size_t);
+static void sort_swap(SV_Str_view *, size_t, size_t);
 
 /* Once the user facing API has verified the lengths of strings provided to
    views as inputs, internal code can take advantage of compiler optimizations
@@ -74,12 +263,13 @@ static size_t position_memoized(ptrdiff_t haystack_size,
                                 char const ARR_GEQ(, haystack_size),
                                 ptrdiff_t needle_size,
                                 char const ARR_GEQ(, needle_size), ptrdiff_t,
-                                ptrdiff_t);
+                                ptrdiff_t, struct Occurrences *);
 static size_t position_normal(ptrdiff_t haystack_size,
                               char const ARR_GEQ(, haystack_size),
                               ptrdiff_t needle_size,
                               char const ARR_GEQ(, needle_size), ptrdiff_t,
-                              ptrdiff_t);
+                              ptrdiff_t, struct Occurrences *);
+static void occurrence(struct Occurrences *, ptrdiff_t);
 static size_t reverse_position_memoized(ptrdiff_t haystack_size,
                                         char const ARR_GEQ(, haystack_size),
                                         ptrdiff_t needle_size,
@@ -94,6 +284,14 @@ static size_t two_way_match(ptrdiff_t haystack_size,
                             char const ARR_GEQ(, haystack_size),
                             ptrdiff_t needle_size,
                             char const ARR_GEQ(, needle_size));
+static SV_Needle two_way_factorize(ptrdiff_t needle_size,
+                                   char const ARR_GEQ(, needle_size));
+static size_t two_way_needle_match(ptrdiff_t haystack_size,
+                                   char const ARR_GEQ(, haystack_size),
+                                   SV_Needle const *, struct Occurrences *);
+static size_t view_needle_match(ptrdiff_t haystack_size,
+                                char const ARR_GEQ(, haystack_size),
+                                SV_Needle const *);
 static size_t two_way_reverse_match(ptrdiff_t haystack_size,
                                     char const ARR_GEQ(, haystack_size),
                                     ptrdiff_t needle_size,
@@ -150,6 +348,70 @@ static size_t
 reverse_four_byte_view_match(size_t size, unsigned char const ARR_GEQ(, size),
                              size_t n_size,
                              unsigned char const ARR_GEQ(, n_size));
+static struct Block block_load(unsigned char const ARR_GEQ(, BLOCK_BYTES));
+static struct Block
+block_load_partial(size_t n, unsigned char const ARR_GEQ(, n),
+                   unsigned char ARR_GEQ(, BLOCK_BYTES));
+static uint64_t block_eq(struct Block const *, unsigned char);
+static uint64_t prefix_xor(uint64_t);
+static uint64_t escaped_bits(uint64_t, uint64_t *);
+static unsigned ctz64(uint64_t);
+static unsigned popcount64(uint64_t);
+static unsigned clz64(uint64_t);
+static uint64_t block_in_set(struct Block const *, struct Set_class const *);
+static struct Set_class set_class(SV_Str_view);
+static size_t set_scan(size_t n, char const ARR_GEQ(, n),
+                       struct Set_class const *, bool);
+static size_t set_reverse_scan(size_t n, char const ARR_GEQ(, n),
+                               struct Set_class const *, bool);
+static uint64_t block_utf8_leads(struct Block const *);
+static void csv_classify(SV_Csv_reader *);
+static size_t csv_next_separator(SV_Csv_reader *, bool *);
+static SV_Csv_field csv_field(SV_Csv_reader const *, size_t, size_t, bool);
+static char json_char(SV_Json_cursor const *);
+static size_t json_end(SV_Json_cursor const *);
+static bool json_fail(SV_Json_cursor *);
+static bool is_json_space(char);
+static SV_Str_view charset_trim(SV_Str_view, SV_Charset const *);
+static void url_authority(SV_Url *);
+static SV_Str_view path_raw_next(SV_Str_view, char const *);
+static bool path_is_dot(SV_Str_view);
+static bool path_is_dotdot(SV_Str_view);
+static bool path_removed(SV_Path_iter const *, SV_Str_view);
+static size_t path_trim_separators(SV_Str_view);
+static void kv_pair(SV_Str_view, size_t, size_t, size_t, SV_Charset const *,
+                    size_t, SV_Str_view *, SV_Str_view *, size_t *);
+static size_t utf8_sequence(size_t n, unsigned char const ARR_GEQ(, n), bool *);
+static size_t utf8_scalar_prefix(size_t, size_t n,
+                                 unsigned char const ARR_GEQ(, n), bool *);
+static size_t utf8_prefix(size_t n, unsigned char const ARR_GEQ(, n), bool *);
+static size_t utf8_select(size_t n, unsigned char const ARR_GEQ(, n), size_t,
+                          size_t *);
+static SV_Str_view utf8_codepoint(SV_Str_view, size_t);
+static int hex_value(unsigned char);
+static size_t unescape_sequence(size_t n, char const ARR_GEQ(, n), char,
+                                unsigned char ARR_GEQ(, 4), size_t *);
+static size_t utf8_encode(uint32_t, unsigned char ARR_GEQ(, 4));
+static bool hex_quad(size_t n, char const ARR_GEQ(, n), uint32_t *);
+static int base64_value(unsigned char, SV_Base64_alphabet);
+static size_t base64_padding(SV_Str_view);
+#if defined(SIMD_AVX2_KERNELS)
+static TARGET_AVX2 __m256i range_eq(__m256i, unsigned char, unsigned char);
+static TARGET_AVX2 bool hex_decode_vector(unsigned char const ARR_GEQ(, 32),
+                                          unsigned char ARR_GEQ(, 16));
+static TARGET_AVX2 bool
+base64_decode_vector(unsigned char const ARR_GEQ(, 32), SV_Base64_alphabet,
+                     unsigned char ARR_GEQ(, 32));
+#endif
+#if defined(SIMD_UTF8_AVX2)
+static TARGET_AVX2 bool utf8_vector_valid_avx2(size_t n,
+                                               unsigned char const ARR_GEQ(, n),
+                                               size_t *);
+#endif
+#if defined(SIMD_UTF8_SSSE3)
+static bool utf8_vector_valid_ssse3(size_t n, unsigned char const ARR_GEQ(, n),
+                                    size_t *);
+#endif
 
 /* ===================   Interface Implementation   ====================== */
 
@@ -213,21 +475,6 @@ SV_fill(size_t const dest_bytes, char *const dest_buf, SV_Str_view const src) {
     return bytes;
 }
 
-bool
-SV_is_empty(SV_Str_view const sv) {
-    return !sv.len;
-}
-
-size_t
-SV_len(SV_Str_view const sv) {
-    return sv.len;
-}
-
-size_t
-SV_bytes(SV_Str_view const sv) {
-    return sv.len + 1;
-}
-
 size_t
 SV_str_bytes(char const *const str) {
     if (!str) {
@@ -241,19 +488,6 @@ SV_min_len(char const *const str, size_t n) {
     return strnlen(str, n);
 }
 
-char
-SV_at(SV_Str_view const sv, size_t const i) {
-    if (i >= sv.len) {
-        return *nil.str;
-    }
-    return sv.str[i];
-}
-
-char const *
-SV_null(void) {
-    return nil.str;
-}
-
 SV_Order
 SV_compare(SV_Str_view const lhs, SV_Str_view const rhs) {
     if (!lhs.str || !rhs.str) {
@@ -309,92 +543,83 @@ SV_view_compare(SV_Str_view const lhs, char const *const rhs, size_t const n) {
     return (i < lhs.len) ? SV_ORDER_GREATER : SV_ORDER_LESSER;
 }
 
-char
-SV_front(SV_Str_view const sv) {
-    if (!sv.str || !sv.len) {
-        return *nil.str;
-    }
-    return *sv.str;
-}
-
-char
-SV_back(SV_Str_view const sv) {
-    if (!sv.str || !sv.len) {
-        return *nil.str;
-    }
-    return sv.str[sv.len - 1];
-}
-
-char const *
-SV_begin(SV_Str_view const sv) {
-    if (!sv.str) {
-        return nil.str;
-    }
-    return sv.str;
-}
-
-char const *
-SV_end(SV_Str_view const sv) {
-    if (!sv.str || sv.str == nil.str) {
-        return nil.str;
-    }
-    return sv.str + sv.len;
-}
-
-char const *
-SV_next(char const *c) {
-    if (!c) {
-        return nil.str;
-    }
-    return ++c;
-}
-
-char const *
-SV_reverse_begin(SV_Str_view const sv) {
-    if (!sv.str) {
-        return nil.str;
-    }
-    if (!sv.len) {
-        return sv.str;
-    }
-    return sv.str + sv.len - 1;
+void
+SV_sort(SV_Str_view *const views, size_t const n) {
+    SV_sort_from(views, n, 0);
 }
 
-char const *
-SV_reverse_end(SV_Str_view const sv) {
-    if (!sv.str || sv.str == nil.str) {
-        return nil.str;
+/* Bentley and Sedgewick's multikey quicksort. Each pass splits the views by
+   their byte at depth around a pivot byte into lesser, equal, and greater
+   ranges and only the equal range moves on to the next byte. The two smaller
+   ranges are sorted by recursion and the largest by the loop so the stack
+   never grows beyond log2(n) frames. */
+void
+SV_sort_from(SV_Str_view *views, size_t n, size_t depth) {
+    if (!views) {
+        return;
     }
-    if (!sv.len) {
-        return sv.str;
-    }
-    return sv.str - 1;
-}
-
-char const *
-SV_reverse_next(char const *c) {
-    if (!c) {
-        return nil.str;
+    while (n > SORT_INSERTION_MAX) {
+        int const pivot
+            = sort_median(sort_key(views[0], depth),
+                          sort_key(views[n / 2], depth),
+                          sort_key(views[n - 1], depth));
+        size_t lt = 0;
+        size_t i = 0;
+        size_t gt = n;
+        while (i < gt) {
+            int const k = sort_key(views[i], depth);
+            if (k < pivot) {
+                sort_swap(views, lt++, i++);
+            } else if (k > pivot) {
+                sort_swap(views, i, --gt);
+            } else {
+                ++i;
+            }
+        }
+        struct {
+            SV_Str_view *views;
+            size_t n;
+            size_t depth;
+        } parts[3] = {
+            {views, lt, depth},
+            /* Views that ended at depth are equal and already in place. */
+            {views + lt, pivot < 0 ? 0 : gt - lt, depth + 1},
+            {views + gt, n - gt, depth},
+        };
+        size_t largest = 0;
+        for (size_t p = 1; p < 3; ++p) {
+            if (parts[p].n > parts[largest].n) {
+                largest = p;
+            }
+        }
+        for (size_t p = 0; p < 3; ++p) {
+            if (p != largest) {
+                SV_sort_from(parts[p].views, parts[p].n, parts[p].depth);
+            }
+        }
+        views = parts[largest].views;
+        n = parts[largest].n;
+        depth = parts[largest].depth;
     }
-    return --c;
+    sort_insertion(views, n, depth);
 }
 
-char const *
-SV_pointer(SV_Str_view const sv, size_t const i) {
-    if (!sv.str) {
-        return nil.str;
-    }
-    if (i > sv.len) {
-        return SV_end(sv);
-    }
-    return sv.str + i;
+SV_Str_view
+SV_token_begin(SV_Str_view const src, SV_Str_view const delim) {
+    PROBE_VIEW_ENTRY(token_begin, src, 0, delim.len);
+    SV_Str_view const first = token_begin(src, delim);
+    PROBE_VIEW_RETURN(token_begin, src, delim.len, first);
+    return first;
 }
 
-SV_Str_view
-SV_token_begin(SV_Str_view src, SV_Str_view const delim) {
+/* The first token of src, separate from SV_token_begin so that the probes
+   see every return. */
+static inline SV_Str_view
+token_begin(SV_Str_view src, SV_Str_view const delim) {
     if (!src.str) {
         return nil;
     }
+    STATS_ADD(token_loops, 1);
     if (!delim.str) {
         return (SV_Str_view){.str = src.str + src.len, 0};
     }
@@ -414,17 +639,24 @@ SV_token_begin(SV_Str_view src, SV_Str_view const delim) {
     };
 }
 
-bool
-SV_token_end(SV_Str_view const src, SV_Str_view const token) {
-    return !token.len || token.str >= (src.str + src.len);
-}
-
 SV_Str_view
 SV_token_next(SV_Str_view const src, SV_Str_view const token,
               SV_Str_view const delim) {
+    PROBE_VIEW_ENTRY(token_next, src, PROBE_OFFSET(src, token), delim.len);
+    SV_Str_view const next = token_next(src, token, delim);
+    PROBE_VIEW_RETURN(token_next, src, delim.len, next);
+    return next;
+}
+
+/* The next token after the given one. Separate from SV_token_next so that the
+   probes see every return. */
+static inline SV_Str_view
+token_next(SV_Str_view const src, SV_Str_view const token,
+           SV_Str_view const delim) {
     if (!token.str) {
         return nil;
     }
+    STATS_ADD(token_steps, 1);
     if (!delim.str || !token.str || !token.str[token.len]) {
         return (SV_Str_view){
             .str = &token.str[token.len],
@@ -461,10 +693,20 @@ SV_token_next(SV_Str_view const src, SV_Str_view const token,
 }
 
 SV_Str_view
-SV_token_reverse_begin(SV_Str_view src, SV_Str_view const delim) {
+SV_token_reverse_begin(SV_Str_view const src, SV_Str_view const delim) {
+    PROBE_VIEW_ENTRY(token_reverse_begin, src, src.len, delim.len);
+    SV_Str_view const last = token_reverse_begin(src, delim);
+    PROBE_VIEW_RETURN(token_reverse_begin, src, delim.len, last);
+    return last;
+}
+
+/* The last token of src, separate for the same reason as token_begin. */
+static inline SV_Str_view
+token_reverse_begin(SV_Str_view src, SV_Str_view const delim) {
     if (!src.str) {
         return nil;
     }
+    STATS_ADD(token_loops, 1);
     if (!delim.str) {
         return (SV_Str_view){
             .str = src.str + src.len,
@@ -487,9 +729,22 @@ SV_token_reverse_begin(SV_Str_view src, SV_Str_view const delim) {
 SV_Str_view
 SV_token_reverse_next(SV_Str_view const src, SV_Str_view const token,
                       SV_Str_view const delim) {
+    PROBE_VIEW_ENTRY(token_reverse_next, src, PROBE_OFFSET(src, token),
+                     delim.len);
+    SV_Str_view const next = token_reverse_next(src, token, delim);
+    PROBE_VIEW_RETURN(token_reverse_next, src, delim.len, next);
+    return next;
+}
+
+/* The token before the given one, separate for the same reason as
+   token_next. */
+static inline SV_Str_view
+token_reverse_next(SV_Str_view const src, SV_Str_view const token,
+                   SV_Str_view const delim) {
     if (!token.str) {
         return nil;
     }
+    STATS_ADD(token_steps, 1);
     if (!token.len | !delim.str || token.str == src.str
         || token.str - delim.len <= src.str) {
         return (SV_Str_view){
@@ -523,11 +778,6 @@ SV_token_reverse_next(SV_Str_view const src, SV_Str_view const token,
     };
 }
 
-bool
-SV_token_reverse_end(SV_Str_view const src, SV_Str_view const token) {
-    return !token.len && token.str == src.str;
-}
-
 SV_Str_view
 SV_extend(SV_Str_view sv) {
     if (!sv.str) {
@@ -547,15 +797,6 @@ SV_starts_with(SV_Str_view const sv, SV_Str_view const prefix) {
     return SV_compare(SV_substr(sv, 0, prefix.len), prefix) == SV_ORDER_EQUAL;
 }
 
-SV_Str_view
-SV_remove_prefix(SV_Str_view const sv, size_t const n) {
-    size_t const remove = min(sv.len, n);
-    return (SV_Str_view){
-        .str = sv.str + remove,
-        .len = sv.len - remove,
-    };
-}
-
 bool
 SV_ends_with(SV_Str_view const sv, SV_Str_view const suffix) {
     if (suffix.len > sv.len) {
@@ -565,49 +806,32 @@ SV_ends_with(SV_Str_view const sv, SV_Str_view const suffix) {
         == SV_ORDER_EQUAL;
 }
 
-SV_Str_view
-SV_remove_suffix(SV_Str_view const sv, size_t const n) {
-    if (!sv.str) {
-        return nil;
-    }
-    return (SV_Str_view){
-        .str = sv.str,
-        .len = sv.len - min(sv.len, n),
-    };
-}
-
-SV_Str_view
-SV_substr(SV_Str_view const sv, size_t const pos, size_t const count) {
-    if (pos > sv.len) {
-        return (SV_Str_view){
-            .str = sv.str + sv.len,
-            .len = 0,
-        };
-    }
-    return (SV_Str_view){
-        .str = sv.str + pos,
-        .len = min(count, sv.len - pos),
-    };
-}
-
 bool
 SV_contains(SV_Str_view const haystack, SV_Str_view const needle) {
-    if (needle.len > haystack.len) {
-        return false;
-    }
-    if (SV_is_empty(haystack)) {
-        return false;
+    PROBE3(contains_entry, haystack.len, 0, needle.len);
+    size_t found = haystack.len;
+    if (needle.len <= haystack.len && !SV_is_empty(haystack)) {
+        found = SV_is_empty(needle)
+                  ? 0
+                  : view_match((ptrdiff_t)haystack.len, haystack.str,
+                               (ptrdiff_t)needle.len, needle.str);
     }
-    if (SV_is_empty(needle)) {
-        return true;
-    }
-    return haystack.len
-        != view_match((ptrdiff_t)haystack.len, haystack.str,
-                      (ptrdiff_t)needle.len, needle.str);
+    PROBE3(contains_return, haystack.len, needle.len, found);
+    return found != haystack.len;
 }
 
 SV_Str_view
 SV_match(SV_Str_view const haystack, SV_Str_view const needle) {
+    PROBE_VIEW_ENTRY(match, haystack, 0, needle.len);
+    SV_Str_view const found = match(haystack, needle);
+    PROBE_VIEW_RETURN(match, haystack, needle.len, found);
+    return found;
+}
+
+/* The first occurrence of needle as a view, separate from SV_match so that
+   the probes see every return. */
+static inline SV_Str_view
+match(SV_Str_view const haystack, SV_Str_view const needle) {
     if (!haystack.str || !needle.str) {
         return nil;
     }
@@ -634,6 +858,16 @@ SV_match(SV_Str_view const haystack, SV_Str_view const needle) {
 
 SV_Str_view
 SV_reverse_match(SV_Str_view const haystack, SV_Str_view const needle) {
+    PROBE_VIEW_ENTRY(reverse_match, haystack, haystack.len, needle.len);
+    SV_Str_view const found = reverse_match(haystack, needle);
+    PROBE_VIEW_RETURN(reverse_match, haystack, needle.len, found);
+    return found;
+}
+
+/* The last occurrence of needle as a view, separate for the same reason as
+   match. */
+static inline SV_Str_view
+reverse_match(SV_Str_view const haystack, SV_Str_view const needle) {
     if (!haystack.str) {
         return nil;
     }
@@ -658,29 +892,47 @@ SV_reverse_match(SV_Str_view const haystack, SV_Str_view const needle) {
 size_t
 SV_find(SV_Str_view const haystack, size_t const pos,
         SV_Str_view const needle) {
-    if (needle.len > haystack.len || pos > haystack.len) {
-        return haystack.len;
+    PROBE3(find_entry, haystack.len, pos, needle.len);
+    size_t found = haystack.len;
+    if (needle.len <= haystack.len && pos <= haystack.len) {
+        found = pos
+              + view_match((ptrdiff_t)(haystack.len - pos), haystack.str + pos,
+                           (ptrdiff_t)needle.len, needle.str);
     }
-    return pos
-         + view_match((ptrdiff_t)(haystack.len - pos), haystack.str + pos,
-                      (ptrdiff_t)needle.len, needle.str);
+    PROBE3(find_return, haystack.len, needle.len, found);
+    return found;
 }
 
 size_t
 SV_reverse_find(SV_Str_view const h, size_t pos, SV_Str_view const n) {
-    if (!h.len || n.len > h.len) {
-        return h.len;
-    }
-    if (pos >= h.len) {
-        pos = h.len - 1;
+    PROBE3(reverse_find_entry, h.len, pos, n.len);
+    size_t found = h.len;
+    if (h.len && n.len <= h.len) {
+        if (pos >= h.len) {
+            pos = h.len - 1;
+        }
+        found = reverse_view_match((ptrdiff_t)pos + 1, h.str, (ptrdiff_t)n.len,
+                                   n.str);
+        if (found == pos + 1) {
+            found = h.len;
+        }
     }
-    size_t const found = reverse_view_match((ptrdiff_t)pos + 1, h.str,
-                                            (ptrdiff_t)n.len, n.str);
-    return found == pos + 1 ? h.len : found;
+    PROBE3(reverse_find_return, h.len, n.len, found);
+    return found;
 }
 
 size_t
 SV_find_first_of(SV_Str_view const haystack, SV_Str_view const set) {
+    PROBE3(find_first_of_entry, haystack.len, 0, set.len);
+    size_t const found = find_first_of(haystack, set);
+    PROBE3(find_first_of_return, haystack.len, set.len, found);
+    return found;
+}
+
+/* The position for SV_find_first_of, separate from it so that the probes see
+   every return. */
+static inline size_t
+find_first_of(SV_Str_view const haystack, SV_Str_view const set) {
     if (!haystack.str || !haystack.len) {
         return 0;
     }
@@ -693,30 +945,38 @@ SV_find_first_of(SV_Str_view const haystack, SV_Str_view const set) {
 
 size_t
 SV_find_last_of(SV_Str_view const haystack, SV_Str_view const set) {
+    PROBE3(find_last_of_entry, haystack.len, haystack.len, set.len);
+    size_t const found = find_last_of(haystack, set);
+    PROBE3(find_last_of_return, haystack.len, set.len, found);
+    return found;
+}
+
+/* The position for SV_find_last_of, separate for the same reason as
+   find_first_of. */
+static inline size_t
+find_last_of(SV_Str_view const haystack, SV_Str_view const set) {
     if (!haystack.str || !haystack.len) {
         return 0;
     }
     if (!set.str || !set.len) {
         return haystack.len;
     }
-    /* It may be tempting to go right to left but consider if that really
-       would be reliably faster across every possible string one encounters.
-       The last occurrence of a set char could be anywhere in the string. */
-    size_t last_pos = haystack.len;
-    for (size_t in = 0, prev = 0;
-         (in += view_substring_length(haystack.len - in, haystack.str + in,
-                                      set.len, set.str))
-         != haystack.len;
-         ++in, prev = in) {
-        if (in != prev) {
-            last_pos = in - 1;
-        }
-    }
-    return last_pos;
+    struct Set_class const c = set_class(set);
+    return set_reverse_scan(haystack.len, haystack.str, &c, true);
 }
 
 size_t
 SV_find_first_not_of(SV_Str_view const haystack, SV_Str_view const set) {
+    PROBE3(find_first_not_of_entry, haystack.len, 0, set.len);
+    size_t const found = find_first_not_of(haystack, set);
+    PROBE3(find_first_not_of_return, haystack.len, set.len, found);
+    return found;
+}
+
+/* The position for SV_find_first_not_of, separate for the same reason as
+   find_first_of. */
+static inline size_t
+find_first_not_of(SV_Str_view const haystack, SV_Str_view const set) {
     if (!haystack.str || !haystack.len) {
         return 0;
     }
@@ -728,82 +988,1630 @@ SV_find_first_not_of(SV_Str_view const haystack, SV_Str_view const set) {
 
 size_t
 SV_find_last_not_of(SV_Str_view const haystack, SV_Str_view const set) {
+    PROBE3(find_last_not_of_entry, haystack.len, haystack.len, set.len);
+    size_t const found = find_last_not_of(haystack, set);
+    PROBE3(find_last_not_of_return, haystack.len, set.len, found);
+    return found;
+}
+
+/* The position for SV_find_last_not_of, separate for the same reason as
+   find_first_of. */
+static inline size_t
+find_last_not_of(SV_Str_view const haystack, SV_Str_view const set) {
     if (!haystack.str || !haystack.len) {
         return 0;
     }
     if (!set.str || !set.len) {
         return haystack.len - 1;
     }
-    size_t last_pos = haystack.len;
-    for (size_t in = 0, prev = 0;
-         (in += view_substring_length(haystack.len - in, haystack.str + in,
-                                      set.len, set.str))
-         != haystack.len;
-         ++in, prev = in) {
-        if (in != prev) {
-            last_pos = in;
+    struct Set_class const c = set_class(set);
+    return set_reverse_scan(haystack.len, haystack.str, &c, false);
+}
+
+SV_Str_view
+SV_trim(SV_Str_view const sv, SV_Str_view const set) {
+    return SV_trim_right(SV_trim_left(sv, set), set);
+}
+
+SV_Str_view
+SV_trim_left(SV_Str_view const sv, SV_Str_view const set) {
+    if (!sv.str) {
+        return nil;
+    }
+    struct Set_class const c = set_class(set.str && set.len ? set : whitespace);
+    size_t const first = set_scan(sv.len, sv.str, &c, false);
+    return (SV_Str_view){
+        .str = sv.str + first,
+        .len = sv.len - first,
+    };
+}
+
+SV_Str_view
+SV_trim_right(SV_Str_view const sv, SV_Str_view const set) {
+    if (!sv.str) {
+        return nil;
+    }
+    struct Set_class const c = set_class(set.str && set.len ? set : whitespace);
+    size_t const last = set_reverse_scan(sv.len, sv.str, &c, false);
+    return (SV_Str_view){
+        .str = sv.str,
+        .len = last == sv.len ? 0 : last + 1,
+    };
+}
+
+size_t
+SV_collapse_whitespace(SV_Str_view const src, size_t const dest_bytes,
+                       char *const dest_buf) {
+    if (!dest_buf || !dest_bytes || !src.str) {
+        return 0;
+    }
+    struct Set_class const c = set_class(whitespace);
+    size_t written = 0;
+    size_t i = set_scan(src.len, src.str, &c, false);
+    while (i < src.len && written + 1 < dest_bytes) {
+        if (written) {
+            dest_buf[written++] = ' ';
         }
+        size_t const end
+            = i + set_scan(src.len - i, src.str + i, &c, true);
+        size_t const bytes = min(end - i, dest_bytes - 1 - written);
+        memcpy(dest_buf + written, src.str + i, bytes);
+        written += bytes;
+        i = end + set_scan(src.len - end, src.str + end, &c, false);
+    }
+    dest_buf[written] = '\0';
+    return written + 1;
+}
+
+SV_Needle
+SV_needle(SV_Str_view const needle) {
+    SV_Str_view const n = needle.str ? needle : nil;
+    if (n.len <= 4) {
+        return (SV_Needle){.str = n};
     }
-    return last_pos;
+    return two_way_factorize((ptrdiff_t)n.len, n.str);
 }
 
 size_t
-SV_npos(SV_Str_view const sv) {
-    return sv.len;
+SV_needle_find(SV_Str_view const haystack, size_t const pos,
+               SV_Needle const *const needle) {
+    size_t const needle_len = needle ? needle->str.len : 0;
+    PROBE3(needle_find_entry, haystack.len, pos, needle_len);
+    size_t found = haystack.len;
+    if (needle && needle_len <= haystack.len && pos <= haystack.len) {
+        ptrdiff_t const rest = (ptrdiff_t)(haystack.len - pos);
+        found = pos + view_needle_match(rest, haystack.str + pos, needle);
+    }
+    PROBE3(needle_find_return, haystack.len, needle_len, found);
+    return found;
 }
 
-/* ======================   Static Helpers    ============================= */
+void
+SV_find_batch(SV_Str_view const *const views, size_t const n,
+              SV_Str_view const needle, size_t *const results) {
+    SV_Needle const nd = SV_needle(needle);
+    SV_needle_find_batch(views, n, &nd, results);
+}
 
-static size_t
-after_find(SV_Str_view const haystack, SV_Str_view const needle) {
-    if (needle.len > haystack.len) {
-        return 0;
+void
+SV_needle_find_batch(SV_Str_view const *const views, size_t const n,
+                     SV_Needle const *const needle, size_t *const results) {
+    if (!views || !needle || !results) {
+        return;
     }
-    size_t delim_i = 0;
-    size_t i = 0;
-    while (i < haystack.len && needle.str[delim_i] == haystack.str[i]) {
-        delim_i = (delim_i + 1) % needle.len;
-        ++i;
+    for (size_t i = 0; i < n; ++i) {
+        if (i + BATCH_PREFETCH_DISTANCE < n) {
+            PREFETCH(views[i + BATCH_PREFETCH_DISTANCE].str);
+        }
+        results[i] = views[i].str ? SV_needle_find(views[i], 0, needle) : 0;
     }
-    /* Also reset to the last mismatch found. If some of the delimeter matched
-       but then the string changed into a mismatch go back to get characters
-       that are partially in the delimeter. */
-    return i - delim_i;
 }
 
-static size_t
-before_reverse_find(SV_Str_view const haystack, SV_Str_view const needle) {
-    if (needle.len > haystack.len || !needle.len || !haystack.len) {
-        return haystack.len;
+size_t
+SV_count(SV_Str_view const haystack, SV_Str_view const needle) {
+    SV_Needle const n = SV_needle(needle);
+    return SV_needle_find_all(haystack, &n, 0, NULL);
+}
+
+size_t
+SV_needle_count(SV_Str_view const haystack, SV_Needle const *const needle) {
+    return SV_needle_find_all(haystack, needle, 0, NULL);
+}
+
+size_t
+SV_find_all(SV_Str_view const haystack, SV_Str_view const needle,
+            size_t const cap, size_t *const offsets) {
+    SV_Needle const n = SV_needle(needle);
+    return SV_needle_find_all(haystack, &n, cap, offsets);
+}
+
+size_t
+SV_needle_find_all(SV_Str_view const haystack, SV_Needle const *const needle,
+                   size_t const cap, size_t *const offsets) {
+    if (!haystack.str || !needle || !needle->str.len) {
+        return 0;
     }
-    size_t delim_i = 0;
-    size_t i = 0;
-    while (i < haystack.len
-           && needle.str[needle.len - delim_i - 1]
-                  == haystack.str[haystack.len - i - 1]) {
-        delim_i = (delim_i + 1) % needle.len;
-        ++i;
+    /* One two-way scan finds every occurrence of a long needle. Restarting
+       it after each match would compare up to the needle length again for
+       every occurrence, as in a periodic haystack of dense matches. */
+    if (needle->str.len > 4 && needle->str.len <= haystack.len) {
+        struct Occurrences all = {.cap = cap, .offsets = offsets};
+        (void)two_way_needle_match((ptrdiff_t)haystack.len, haystack.str,
+                                   needle, &all);
+        STATS_ADD(find_bytes, haystack.len);
+        return all.found;
     }
-    /* Ugly logic to account for the reverse nature of this modulo search.
-       the position needs to account for any part of the delim that may
-       have started to match but then mismatched. The 1 is because
-       this in an index being returned not a length. */
-    return i == haystack.len ? haystack.len : haystack.len - i + delim_i - 1;
+    size_t found = 0;
+    /* Overlapping occurrences begin at most one byte after the last. */
+    for (size_t pos = SV_needle_find(haystack, 0, needle); pos < haystack.len;
+         pos = SV_needle_find(haystack, pos + 1, needle)) {
+        if (offsets && found < cap) {
+            offsets[found] = pos;
+        }
+        ++found;
+    }
+    return found;
 }
 
-static inline size_t
-min(size_t const a, size_t const b) {
-    return a < b ? a : b;
+size_t
+SV_search_window_bytes(SV_Needle const *const needle) {
+    if (!needle || needle->str.len <= 1) {
+        return 0;
+    }
+    return 2 * (needle->str.len - 1);
 }
 
-static inline ptrdiff_t
-signed_max(ptrdiff_t const a, ptrdiff_t const b) {
-    return a > b ? a : b;
+SV_Search_state
+SV_search_state(SV_Needle const *const needle, char *const window) {
+    return (SV_Search_state){
+        .needle = needle,
+        .window = window,
+    };
+}
+
+/* An occurrence that ends in the chunk but begins before it begins in the
+   carried bytes, so it is found in the carry followed by the first needle
+   length - 1 bytes of the chunk. Every other occurrence lies within the
+   chunk. The new carry is the last needle length - 1 bytes of the stream,
+   less any leading bytes that differ from the needle's first byte and so
+   cannot begin an occurrence. */
+size_t
+SV_search_feed(SV_Search_state *const state, SV_Str_view const chunk,
+               size_t const cap, size_t *const offsets) {
+    if (!state || !state->needle || !state->needle->str.len || !chunk.str
+        || (state->needle->str.len > 1 && !state->window)) {
+        return 0;
+    }
+    SV_Needle const *const needle = state->needle;
+    size_t const keep = needle->str.len - 1;
+    char *const window = state->window;
+    size_t const carry = state->carry;
+    size_t const offset = state->offset;
+    size_t found = 0;
+    if (carry) {
+        size_t const head = min(chunk.len, keep);
+        memcpy(window + carry, chunk.str, head);
+        /* The seam is shorter than twice the needle, so every occurrence
+           in it begins in the carry. */
+        SV_Str_view const seam = {.str = window, .len = carry + head};
+        found = SV_needle_find_all(seam, needle, offsets ? cap : 0, offsets);
+        for (size_t i = 0; i < min(found, offsets ? cap : 0); ++i) {
+            offsets[i] += offset - carry;
+        }
+    }
+    size_t const room = offsets && found < cap ? cap - found : 0;
+    size_t const inside = SV_needle_find_all(
+        chunk, needle, room, offsets ? offsets + found : NULL);
+    for (size_t i = 0; i < min(inside, room); ++i) {
+        offsets[found + i] += offset;
+    }
+    found += inside;
+    size_t next = 0;
+    if (keep && chunk.len >= keep) {
+        memcpy(window, chunk.str + chunk.len - keep, keep);
+        next = keep;
+    } else if (keep) {
+        /* A chunk following a carry was already copied after it. */
+        if (!carry) {
+            memcpy(window, chunk.str, chunk.len);
+        }
+        size_t const old = min(carry, keep - chunk.len);
+        memmove(window, window + carry - old, old + chunk.len);
+        next = old + chunk.len;
+    }
+    char const *const start
+        = next ? memchr(window, needle->str.str[0], next) : NULL;
+    state->carry = start ? (size_t)(window + next - start) : 0;
+    if (start && start != window) {
+        memmove(window, start, state->carry);
+    }
+    state->offset = offset + chunk.len;
+    return found;
+}
+
+size_t
+SV_find_unescaped(SV_Str_view const sv, char const quote, char const escape) {
+    if (!sv.str) {
+        return 0;
+    }
+    unsigned char const *const s = (unsigned char const *)sv.str;
+    unsigned char pad[BLOCK_BYTES];
+    uint64_t next_is_escaped = 0;
+    for (size_t i = 0; i < sv.len; i += BLOCK_BYTES) {
+        size_t const rest = sv.len - i;
+        struct Block const b = rest >= BLOCK_BYTES
+                                 ? block_load(s + i)
+                                 : block_load_partial(rest, s + i, pad);
+        uint64_t const escaped = escaped_bits(
+            block_eq(&b, (unsigned char)escape), &next_is_escaped);
+        uint64_t quotes = block_eq(&b, (unsigned char)quote) & ~escaped;
+        if (rest < BLOCK_BYTES) {
+            quotes &= ((uint64_t)1 << rest) - 1;
+        }
+        if (quotes) {
+            return i + ctz64(quotes);
+        }
+    }
+    return sv.len;
+}
+
+SV_Str_view
+SV_unescape_into(SV_Str_view const src, char const escape,
+                 size_t const dest_bytes, char *const dest_buf) {
+    if (!src.str) {
+        return nil;
+    }
+    char const *const first = memchr(src.str, escape, src.len);
+    if (!first) {
+        return src;
+    }
+    if (!dest_buf || !dest_bytes) {
+        return nil;
+    }
+    size_t const cap = dest_bytes - 1;
+    size_t i = (size_t)(first - src.str);
+    size_t written = min(i, cap);
+    memcpy(dest_buf, src.str, written);
+    /* Each pass translates the escape at i and copies the run after it. */
+    while (i < src.len && written < cap) {
+        unsigned char out[4];
+        size_t out_len = 0;
+        size_t const used = unescape_sequence(src.len - i - 1, src.str + i + 1,
+                                              escape, out, &out_len);
+        if (out_len > cap - written) {
+            break;
+        }
+        memcpy(dest_buf + written, out, out_len);
+        written += out_len;
+        i += 1 + used;
+        char const *const next = memchr(src.str + i, escape, src.len - i);
+        size_t const run = next ? (size_t)(next - (src.str + i)) : src.len - i;
+        size_t const bytes = min(run, cap - written);
+        memcpy(dest_buf + written, src.str + i, bytes);
+        written += bytes;
+        i += run;
+    }
+    dest_buf[written] = '\0';
+    return (SV_Str_view){
+        .str = dest_buf,
+        .len = written,
+    };
+}
+
+/* A final newline begins no line so only the bytes before the last byte are
+   searched for newlines, each of which begins one more line. */
+size_t
+SV_line_count(SV_Str_view const sv) {
+    if (!sv.str || !sv.len) {
+        return 0;
+    }
+    unsigned char const *const s = (unsigned char const *)sv.str;
+    size_t const n = sv.len - 1;
+    size_t lines = 1;
+    size_t i = 0;
+    for (; n - i >= BLOCK_BYTES; i += BLOCK_BYTES) {
+        struct Block const b = block_load(s + i);
+        lines += popcount64(block_eq(&b, '\n'));
+    }
+    if (i < n) {
+        unsigned char pad[BLOCK_BYTES];
+        struct Block const b = block_load_partial(n - i, s + i, pad);
+        lines += popcount64(block_eq(&b, '\n'));
+    }
+    return lines;
+}
+
+size_t
+SV_line_index(SV_Str_view const sv, size_t cap, size_t *const offsets) {
+    if (!sv.str || !sv.len) {
+        return 0;
+    }
+    if (!offsets) {
+        cap = 0;
+    }
+    if (cap) {
+        offsets[0] = 0;
+    }
+    unsigned char const *const s = (unsigned char const *)sv.str;
+    unsigned char pad[BLOCK_BYTES];
+    size_t const n = sv.len - 1;
+    size_t lines = 1;
+    for (size_t i = 0; i < n; i += BLOCK_BYTES) {
+        size_t const rest = n - i;
+        struct Block const b = rest >= BLOCK_BYTES
+                                 ? block_load(s + i)
+                                 : block_load_partial(rest, s + i, pad);
+        uint64_t newlines = block_eq(&b, '\n');
+        if (lines >= cap) {
+            lines += popcount64(newlines);
+            continue;
+        }
+        for (; newlines; newlines &= newlines - 1, ++lines) {
+            if (lines < cap) {
+                offsets[lines] = i + ctz64(newlines) + 1;
+            }
+        }
+    }
+    return lines;
+}
+
+SV_Charset
+SV_charset(SV_Str_view const set) {
+    SV_Charset cs = {{0}};
+    if (!set.str) {
+        return cs;
+    }
+    for (size_t i = 0; i < set.len; ++i) {
+        unsigned char const c = (unsigned char)set.str[i];
+        cs.bits[c / 8] |= (unsigned char)(1U << (c % 8));
+    }
+    return cs;
+}
+
+bool
+SV_charset_contains(SV_Charset const *const set, char const c) {
+    if (!set) {
+        return false;
+    }
+    unsigned char const u = (unsigned char)c;
+    return (set->bits[u / 8] >> (u % 8)) & 1U;
+}
+
+SV_Csv_reader
+SV_csv_reader(SV_Str_view const src, char const delim, char const quote) {
+    return (SV_Csv_reader){
+        .src = src.str ? src : nil,
+        .delim = delim,
+        .quote = quote,
+    };
+}
+
+size_t
+SV_csv_next(SV_Csv_reader *const reader, size_t const cap,
+            SV_Csv_field *const fields) {
+    if (!reader || reader->pos >= reader->src.len) {
+        return 0;
+    }
+    size_t n = 0;
+    bool newline = false;
+    do {
+        size_t const sep = csv_next_separator(reader, &newline);
+        if (fields && n < cap) {
+            fields[n] = csv_field(reader, reader->pos, sep, newline);
+        }
+        ++n;
+        reader->pos = sep + 1;
+    } while (!newline && reader->pos <= reader->src.len);
+    return n;
+}
+
+size_t
+SV_csv_unescape(SV_Csv_field const field, char const quote,
+                size_t const dest_bytes, char *const dest_buf) {
+    if (!dest_buf || !dest_bytes || !field.view.str) {
+        return 0;
+    }
+    if (!field.needs_unescape) {
+        size_t const bytes = min(dest_bytes - 1, field.view.len);
+        memcpy(dest_buf, field.view.str, bytes);
+        dest_buf[bytes] = '\0';
+        return bytes + 1;
+    }
+    size_t written = 0;
+    for (size_t i = 0; i < field.view.len && written + 1 < dest_bytes; ++i) {
+        dest_buf[written++] = field.view.str[i];
+        /* Only the first of a doubled quote is written. */
+        if (field.view.str[i] == quote && i + 1 < field.view.len
+            && field.view.str[i + 1] == quote) {
+            ++i;
+        }
+    }
+    dest_buf[written] = '\0';
+    return written + 1;
+}
+
+size_t
+SV_json_index(SV_Str_view const src, size_t const cap, size_t *const index) {
+    if (!src.str) {
+        return 0;
+    }
+    unsigned char pad[BLOCK_BYTES];
+    uint64_t next_is_escaped = 0;
+    uint64_t in_string = 0;
+    uint64_t prev_scalar = 0;
+    size_t n = 0;
+    for (size_t block = 0; block < src.len; block += BLOCK_BYTES) {
+        size_t const remain = src.len - block;
+        unsigned char const *const bytes
+            = (unsigned char const *)src.str + block;
+        struct Block const b = remain >= BLOCK_BYTES
+                                 ? block_load(bytes)
+                                 : block_load_partial(remain, bytes, pad);
+        uint64_t const valid = remain >= BLOCK_BYTES
+                                 ? UINT64_MAX
+                                 : ((uint64_t)1 << remain) - 1;
+        uint64_t const space = block_eq(&b, ' ') | block_eq(&b, '\t')
+                             | block_eq(&b, '\n') | block_eq(&b, '\r');
+        uint64_t const op = (block_eq(&b, '{') | block_eq(&b, '}')
+                             | block_eq(&b, '[') | block_eq(&b, ']')
+                             | block_eq(&b, ':') | block_eq(&b, ','))
+                          & valid;
+        uint64_t const quotes
+            = block_eq(&b, '"') & valid
+            & ~escaped_bits(block_eq(&b, '\\') & valid, &next_is_escaped);
+        /* Opening quotes and the bytes of a string are marked, closing quotes
+           are not. The tail is every byte of a string but its opening quote
+           and no structural character can be found there. */
+        uint64_t const strings = prefix_xor(quotes) ^ in_string;
+        in_string = (uint64_t)0 - (strings >> (BLOCK_BYTES - 1));
+        uint64_t const string_tail = strings ^ quotes;
+        /* A number or literal begins wherever a scalar byte does not follow
+           another. Quotes are excluded so a string may begin after one. */
+        uint64_t const scalar = ~(op | space) & valid;
+        uint64_t const nonquote_scalar = scalar & ~quotes;
+        uint64_t const follows_scalar = (nonquote_scalar << 1) | prev_scalar;
+        prev_scalar = nonquote_scalar >> (BLOCK_BYTES - 1);
+        for (uint64_t structurals
+             = (op | (scalar & ~follows_scalar)) & ~string_tail;
+             structurals; structurals &= structurals - 1) {
+            if (index && n < cap) {
+                index[n] = block + ctz64(structurals);
+            }
+            ++n;
+        }
+    }
+    return n;
+}
+
+size_t
+SV_kv_parse(SV_Str_view const src, char const kv_delim, char const pair_delim,
+            SV_Charset const *const trim, size_t const cap,
+            SV_Str_view *const keys, SV_Str_view *const values) {
+    if (!src.str) {
+        return 0;
+    }
+    unsigned char pad[BLOCK_BYTES];
+    size_t n = 0;
+    size_t pair = 0;
+    size_t kv = src.len;
+    for (size_t block = 0; block < src.len; block += BLOCK_BYTES) {
+        size_t const remain = src.len - block;
+        unsigned char const *const bytes
+            = (unsigned char const *)src.str + block;
+        struct Block const b = remain >= BLOCK_BYTES
+                                 ? block_load(bytes)
+                                 : block_load_partial(remain, bytes, pad);
+        uint64_t const valid = remain >= BLOCK_BYTES
+                                 ? UINT64_MAX
+                                 : ((uint64_t)1 << remain) - 1;
+        uint64_t const pairs = block_eq(&b, (unsigned char)pair_delim) & valid;
+        for (uint64_t delims
+             = (block_eq(&b, (unsigned char)kv_delim) & valid) | pairs;
+             delims; delims &= delims - 1) {
+            unsigned const bit = ctz64(delims);
+            size_t const pos = block + bit;
+            if ((pairs >> bit) & 1) {
+                kv_pair(src, pair, kv, pos, trim, cap, keys, values, &n);
+                pair = pos + 1;
+                kv = src.len;
+            } else if (kv == src.len) {
+                kv = pos;
+            }
+        }
+    }
+    kv_pair(src, pair, kv, src.len, trim, cap, keys, values, &n);
+    return n;
+}
+
+SV_Url
+SV_url_parse(SV_Str_view const url) {
+    SV_Str_view const src = url.str ? url : nil;
+    SV_Url u = {
+        .scheme = {.str = src.str, .len = 0},
+    };
+    size_t pos = 0;
+    size_t const first
+        = view_complimentary_substring_length(src.len, src.str, 4, ":/?#");
+    if (first && first < src.len && src.str[first] == ':') {
+        u.scheme.len = first;
+        pos = first + 1;
+    }
+    u.authority = (SV_Str_view){.str = src.str + pos, .len = 0};
+    if (src.len - pos >= 2 && src.str[pos] == '/' && src.str[pos + 1] == '/') {
+        pos += 2;
+        u.authority = (SV_Str_view){
+            .str = src.str + pos,
+            .len = view_complimentary_substring_length(
+                src.len - pos, src.str + pos, 3, "/?#"),
+        };
+        pos += u.authority.len;
+    }
+    url_authority(&u);
+    u.path = (SV_Str_view){
+        .str = src.str + pos,
+        .len = view_complimentary_substring_length(src.len - pos, src.str + pos,
+                                                   2, "?#"),
+    };
+    pos += u.path.len;
+    u.query = (SV_Str_view){.str = src.str + pos, .len = 0};
+    if (pos < src.len && src.str[pos] == '?') {
+        ++pos;
+        u.query = (SV_Str_view){
+            .str = src.str + pos,
+            .len = view_match_char(src.len - pos, src.str + pos, '#'),
+        };
+        pos += u.query.len;
+    }
+    u.fragment = (SV_Str_view){.str = src.str + pos, .len = 0};
+    if (pos < src.len && src.str[pos] == '#') {
+        ++pos;
+        u.fragment = (SV_Str_view){
+            .str = src.str + pos,
+            .len = src.len - pos,
+        };
+    }
+    return u;
+}
+
+SV_Str_view
+SV_path_dirname(SV_Str_view const path) {
+    if (!path.str) {
+        return nil;
+    }
+    size_t const end = path_trim_separators(path);
+    if (!end) {
+        return (SV_Str_view){.str = path.str, .len = path.len ? 1 : 0};
+    }
+    size_t dir = reverse_view_match_char(end, path.str, '/');
+    if (dir == end) {
+        return (SV_Str_view){.str = path.str, .len = 0};
+    }
+    while (dir && path.str[dir - 1] == '/') {
+        --dir;
+    }
+    return (SV_Str_view){.str = path.str, .len = dir ? dir : 1};
+}
+
+SV_Str_view
+SV_path_basename(SV_Str_view const path) {
+    if (!path.str) {
+        return nil;
+    }
+    size_t const end = path_trim_separators(path);
+    if (!end) {
+        return (SV_Str_view){.str = path.str + path.len, .len = 0};
+    }
+    size_t const sep = reverse_view_match_char(end, path.str, '/');
+    size_t const begin = sep == end ? 0 : sep + 1;
+    return (SV_Str_view){
+        .str = path.str + begin,
+        .len = end - begin,
+    };
+}
+
+SV_Str_view
+SV_path_extension(SV_Str_view const path) {
+    SV_Str_view const base = SV_path_basename(path);
+    size_t const dot = reverse_view_match_char(base.len, base.str, '.');
+    if (dot == base.len || !dot || path_is_dotdot(base)) {
+        return (SV_Str_view){.str = base.str + base.len, .len = 0};
+    }
+    return (SV_Str_view){
+        .str = base.str + dot,
+        .len = base.len - dot,
+    };
+}
+
+SV_Str_view
+SV_path_stem(SV_Str_view const path) {
+    SV_Str_view const base = SV_path_basename(path);
+    return (SV_Str_view){
+        .str = base.str,
+        .len = base.len - SV_path_extension(path).len,
+    };
+}
+
+SV_Str_view
+SV_path_normal_begin(SV_Path_iter *const it, SV_Str_view const path) {
+    if (!it) {
+        return nil;
+    }
+    *it = (SV_Path_iter){
+        .path = path.str ? path : nil,
+        .segment = {.str = path.str ? path.str : nil.str, .len = 0},
+    };
+    for (SV_Str_view seg = path_raw_next(it->path, it->path.str); seg.len;
+         seg = path_raw_next(it->path, seg.str + seg.len)) {
+        it->dotdots += path_is_dotdot(seg);
+    }
+    return SV_path_normal_next(it);
+}
+
+SV_Str_view
+SV_path_normal_next(SV_Path_iter *const it) {
+    if (!it) {
+        return nil;
+    }
+    bool const absolute = it->path.len && *it->path.str == '/';
+    for (SV_Str_view seg
+         = path_raw_next(it->path, it->segment.str + it->segment.len);
+         seg.len; seg = path_raw_next(it->path, seg.str + seg.len)) {
+        if (path_is_dot(seg)) {
+            continue;
+        }
+        if (path_is_dotdot(seg)) {
+            --it->dotdots;
+            if (it->depth) {
+                --it->depth;
+                continue;
+            }
+            if (absolute) {
+                continue;
+            }
+            it->segment = seg;
+            return seg;
+        }
+        ++it->depth;
+        if (!path_removed(it, seg)) {
+            it->segment = seg;
+            return seg;
+        }
+    }
+    it->segment = (SV_Str_view){
+        .str = it->path.str + it->path.len,
+        .len = 0,
+    };
+    return it->segment;
+}
+
+bool
+SV_path_normal_end(SV_Path_iter const *const it) {
+    return !it || !it->segment.len;
+}
+
+bool
+SV_template_compile(SV_Template *const tmpl, SV_Str_view const pattern) {
+    if (!tmpl) {
+        return false;
+    }
+    SV_Str_view const p = pattern.str ? pattern : nil;
+    tmpl->fields = 0;
+    size_t pos = 0;
+    for (;;) {
+        SV_Str_view const literal = {
+            .str = p.str + pos,
+            .len = view_match_char(p.len - pos, p.str + pos, '<'),
+        };
+        tmpl->literals[tmpl->fields] = SV_needle(literal);
+        pos += literal.len;
+        if (pos == p.len) {
+            return true;
+        }
+        if ((tmpl->fields && !literal.len)
+            || tmpl->fields == SV_TEMPLATE_MAX_FIELDS) {
+            return false;
+        }
+        size_t const close
+            = view_match_char(p.len - pos - 1, p.str + pos + 1, '>');
+        if (pos + 1 + close == p.len) {
+            return false;
+        }
+        tmpl->names[tmpl->fields++] = (SV_Str_view){
+            .str = p.str + pos + 1,
+            .len = close,
+        };
+        pos += close + 2;
+    }
+}
+
+bool
+SV_template_match(SV_Template const *const tmpl, SV_Str_view const line,
+                  SV_Str_view *const fields) {
+    if (!tmpl || !line.str || (tmpl->fields && !fields)) {
+        return false;
+    }
+    SV_Needle const *const lit = tmpl->literals;
+    if (!SV_starts_with(line, lit[0].str)) {
+        return false;
+    }
+    size_t pos = lit[0].str.len;
+    if (!tmpl->fields) {
+        return pos == line.len;
+    }
+    SV_Str_view const last = lit[tmpl->fields].str;
+    if (line.len - pos < last.len || !SV_ends_with(line, last)) {
+        return false;
+    }
+    /* Fields between literals may not extend into the final literal. */
+    SV_Str_view const body = {
+        .str = line.str,
+        .len = line.len - last.len,
+    };
+    for (size_t i = 1; i < tmpl->fields; ++i) {
+        size_t const found = SV_needle_find(body, pos, &lit[i]);
+        if (found == body.len) {
+            return false;
+        }
+        fields[i - 1] = (SV_Str_view){
+            .str = line.str + pos,
+            .len = found - pos,
+        };
+        pos = found + lit[i].str.len;
+    }
+    fields[tmpl->fields - 1] = (SV_Str_view){
+        .str = line.str + pos,
+        .len = body.len - pos,
+    };
+    return true;
+}
+
+size_t
+SV_template_fields(SV_Template const *const tmpl) {
+    return tmpl ? tmpl->fields : 0;
+}
+
+size_t
+SV_template_field(SV_Template const *const tmpl, SV_Str_view const name) {
+    if (!tmpl) {
+        return 0;
+    }
+    size_t i = 0;
+    for (; i < tmpl->fields
+           && SV_compare(tmpl->names[i], name) != SV_ORDER_EQUAL;
+         ++i) {}
+    return i;
+}
+
+bool
+SV_utf8_valid(SV_Str_view const sv) {
+    return SV_utf8_valid_prefix(sv, NULL);
+}
+
+bool
+SV_utf8_valid_prefix(SV_Str_view const sv, size_t *const err_pos) {
+    SV_Str_view const v = sv.str ? sv : nil;
+    bool truncated = false;
+    size_t const valid
+        = utf8_prefix(v.len, (unsigned char const *)v.str, &truncated);
+    if (err_pos) {
+        *err_pos = valid;
+    }
+    return valid == v.len;
+}
+
+SV_Utf8_stream
+SV_utf8_stream(void) {
+    return (SV_Utf8_stream){.valid = 0};
+}
+
+bool
+SV_utf8_stream_feed(SV_Utf8_stream *const stream, SV_Str_view const chunk) {
+    if (!stream || stream->failed) {
+        return false;
+    }
+    SV_Str_view const c = chunk.str ? chunk : nil;
+    unsigned char const *src = (unsigned char const *)c.str;
+    size_t n = c.len;
+    bool truncated = false;
+    if (stream->partial_len && n) {
+        /* Complete the split sequence before the rest of the chunk. Four bytes
+           always decide a sequence so truncation means the chunk ran out. */
+        unsigned char seq[4];
+        size_t const have = stream->partial_len;
+        size_t const take = min(sizeof(seq) - have, n);
+        memcpy(seq, stream->partial, have);
+        memcpy(seq + have, src, take);
+        size_t const len = utf8_sequence(have + take, seq, &truncated);
+        if (truncated) {
+            memcpy(stream->partial + have, src, take);
+            stream->partial_len = (unsigned char)(have + take);
+            return true;
+        }
+        if (!len) {
+            stream->failed = true;
+            return false;
+        }
+        stream->valid += len;
+        stream->partial_len = 0;
+        src += len - have;
+        n -= len - have;
+    }
+    size_t const valid = utf8_prefix(n, src, &truncated);
+    stream->valid += valid;
+    if (valid == n) {
+        return true;
+    }
+    if (truncated) {
+        memcpy(stream->partial, src + valid, n - valid);
+        stream->partial_len = (unsigned char)(n - valid);
+        return true;
+    }
+    stream->failed = true;
+    return false;
+}
+
+bool
+SV_utf8_stream_finish(SV_Utf8_stream const *const stream,
+                      size_t *const err_pos) {
+    if (!stream) {
+        return false;
+    }
+    if (err_pos) {
+        *err_pos = stream->valid;
+    }
+    return !stream->failed && !stream->partial_len;
+}
+
+size_t
+SV_utf8_count(SV_Str_view const sv) {
+    if (!sv.str) {
+        return 0;
+    }
+    size_t leads = 0;
+    (void)utf8_select(sv.len, (unsigned char const *)sv.str, SIZE_MAX, &leads);
+    return leads;
+}
+
+size_t
+SV_utf8_offset(SV_Str_view const sv, size_t const k) {
+    if (!sv.str) {
+        return 0;
+    }
+    size_t leads = 0;
+    return utf8_select(sv.len, (unsigned char const *)sv.str, k, &leads);
+}
+
+SV_Utf8_index
+SV_utf8_index(SV_Str_view const sv, size_t const stride, size_t const cap,
+              size_t *const offsets) {
+    SV_Utf8_index index = {
+        .sv = sv.str ? sv : nil,
+        .offsets = offsets,
+        .stride = stride ? stride : 1,
+    };
+    unsigned char const *const s = (unsigned char const *)index.sv.str;
+    size_t const n = index.sv.len;
+    /* Each sample is lead 0 of the scan for the next so every byte of the
+       view is classified once. */
+    size_t pos = 0;
+    size_t leads = 0;
+    if (offsets && cap) {
+        offsets[index.samples++] = 0;
+        while (index.samples < cap) {
+            size_t const next
+                = pos + utf8_select(n - pos, s + pos, index.stride, &leads);
+            if (next == n) {
+                index.count = (index.samples - 1) * index.stride + leads;
+                return index;
+            }
+            offsets[index.samples++] = pos = next;
+        }
+    }
+    /* The samples ran out before the end of the view. */
+    (void)utf8_select(n - pos, s + pos, SIZE_MAX, &leads);
+    index.count
+        = (index.samples ? index.samples - 1 : 0) * index.stride + leads;
+    return index;
+}
+
+size_t
+SV_utf8_index_offset(SV_Utf8_index const *const index, size_t const k) {
+    if (!index) {
+        return 0;
+    }
+    if (k >= index->count) {
+        return index->sv.len;
+    }
+    if (!index->samples) {
+        return SV_utf8_offset(index->sv, k);
+    }
+    size_t const j = min(k / index->stride, index->samples - 1);
+    size_t const base = index->offsets[j];
+    size_t leads = 0;
+    return base
+         + utf8_select(index->sv.len - base,
+                       (unsigned char const *)index->sv.str + base,
+                       k - j * index->stride, &leads);
+}
+
+SV_Str_view
+SV_utf8_begin(SV_Str_view const sv) {
+    if (!sv.str) {
+        return nil;
+    }
+    return utf8_codepoint(sv, 0);
+}
+
+SV_Str_view
+SV_utf8_next(SV_Str_view const sv, SV_Str_view const cp) {
+    if (!sv.str || !cp.str || cp.str < sv.str) {
+        return nil;
+    }
+    return utf8_codepoint(sv, (size_t)(cp.str - sv.str) + cp.len);
+}
+
+bool
+SV_utf8_end(SV_Str_view const sv, SV_Str_view const cp) {
+    return !cp.len || cp.str >= sv.str + sv.len;
+}
+
+uint32_t
+SV_utf8_decode(SV_Str_view const cp) {
+    if (!cp.str || !cp.len) {
+        return 0xFFFD;
+    }
+    unsigned char const *const s = (unsigned char const *)cp.str;
+    bool truncated = false;
+    size_t const len = utf8_sequence(cp.len, s, &truncated);
+    if (!len || len != cp.len) {
+        return 0xFFFD;
+    }
+    /* The lead keeps 7, 5, 4, or 3 bits for sequences of 1 to 4 bytes. */
+    static unsigned char const lead_bits[5] = {0, 0x7F, 0x1F, 0x0F, 0x07};
+    uint32_t value = s[0] & lead_bits[len];
+    for (size_t i = 1; i < len; ++i) {
+        value = (value << 6) | (s[i] & 0x3F);
+    }
+    return value;
+}
+
+size_t
+SV_hex_decoded_len(SV_Str_view const src) {
+    return src.str ? src.len / 2 : 0;
+}
+
+size_t
+SV_hex_decode(SV_Str_view const src, size_t const dest_bytes,
+              unsigned char *const dest_buf, size_t *const err_pos) {
+    SV_Str_view const s = src.str ? src : nil;
+    unsigned char const *const in = (unsigned char const *)s.str;
+    size_t const cap = dest_buf ? dest_bytes : 0;
+    size_t i = 0;
+    size_t written = 0;
+#if defined(SIMD_AVX2_KERNELS)
+    if (HAVE_AVX2()) {
+        for (; s.len - i >= 32 && cap - written >= 16
+               && hex_decode_vector(in + i, dest_buf + written);
+             i += 32, written += 16) {}
+    }
+#endif
+    for (; i + 1 < s.len && written < cap; i += 2) {
+        int const hi = hex_value(in[i]);
+        int const lo = hex_value(in[i + 1]);
+        if (hi < 0 || lo < 0) {
+            i += hi >= 0;
+            break;
+        }
+        dest_buf[written++] = (unsigned char)((hi << 4) | lo);
+    }
+    if (err_pos) {
+        *err_pos = i;
+    }
+    return written;
+}
+
+size_t
+SV_base64_decoded_len(SV_Str_view const src) {
+    if (!src.str) {
+        return 0;
+    }
+    size_t const data = src.len - base64_padding(src);
+    return (data / 4 * 3) + (data % 4 ? data % 4 - 1 : 0);
+}
+
+size_t
+SV_base64_decode(SV_Str_view const src, SV_Base64_alphabet const alphabet,
+                 size_t const dest_bytes, unsigned char *const dest_buf,
+                 size_t *const err_pos) {
+    SV_Str_view const s = src.str ? src : nil;
+    unsigned char const *const in = (unsigned char const *)s.str;
+    size_t const cap = dest_buf ? dest_bytes : 0;
+    size_t const pad = base64_padding(s);
+    size_t const data = s.len - pad;
+    size_t i = 0;
+    size_t written = 0;
+#if defined(SIMD_AVX2_KERNELS)
+    if (HAVE_AVX2()) {
+        for (; data - i >= 32 && cap - written >= 32
+               && base64_decode_vector(in + i, alphabet, dest_buf + written);
+             i += 32, written += 24) {}
+    }
+#endif
+    while (i < data) {
+        size_t const group = min(4, data - i);
+        uint32_t bits = 0;
+        size_t k = 0;
+        for (int v = 0;
+             k < group && (v = base64_value(in[i + k], alphabet)) >= 0; ++k) {
+            bits = (bits << 6) | (uint32_t)v;
+        }
+        /* A final group of one character holds fewer than eight bits. */
+        if (k < group || group == 1 || cap - written < group - 1) {
+            i += k < group ? k : 0;
+            break;
+        }
+        bits <<= 6 * (4 - group);
+        for (size_t b = 0; b + 1 < group; ++b) {
+            dest_buf[written++] = (unsigned char)(bits >> (16 - (8 * b)));
+        }
+        i += group;
+    }
+    /* Padding is only valid if it completes the final group of four. */
+    if (i == data && (!pad || (data % 4) + pad == 4)) {
+        i = s.len;
+    }
+    if (err_pos) {
+        *err_pos = i;
+    }
+    return written;
+}
+
+bool
+SV_stats_snapshot(SV_Stats *const out) {
+    if (!out) {
+        return false;
+    }
+#ifdef SV_STATS
+    *out = stats;
+    return true;
+#else
+    *out = (SV_Stats){0};
+    return false;
+#endif
+}
+
+void
+SV_stats_reset(void) {
+#ifdef SV_STATS
+    stats = (SV_Stats){0};
+#endif
+}
+
+SV_Json_cursor
+SV_json_cursor(SV_Str_view const src, size_t const count,
+               size_t const *const index) {
+    return (SV_Json_cursor){
+        .src = src.str ? src : nil,
+        .index = index,
+        .count = index ? count : 0,
+        .i = 0,
+    };
+}
+
+SV_Json_type
+SV_json_type(SV_Json_cursor const *const cur) {
+    if (!cur) {
+        return SV_JSON_ERROR;
+    }
+    if (cur->i >= cur->count) {
+        return SV_JSON_END;
+    }
+    switch (json_char(cur)) {
+        case '{':
+            return SV_JSON_OBJECT;
+        case '[':
+            return SV_JSON_ARRAY;
+        case '"':
+            return SV_JSON_STRING;
+        case 't':
+            return SV_JSON_TRUE;
+        case 'f':
+            return SV_JSON_FALSE;
+        case 'n':
+            return SV_JSON_NULL;
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return SV_JSON_NUMBER;
+        default:
+            return SV_JSON_ERROR;
+    }
+}
+
+SV_Str_view
+SV_json_value(SV_Json_cursor *const cur) {
+    SV_Json_type const type = SV_json_type(cur);
+    if (type == SV_JSON_ERROR || type == SV_JSON_END) {
+        if (cur) {
+            (void)json_fail(cur);
+        }
+        return (SV_Str_view){
+            .str = cur ? cur->src.str + cur->src.len : nil.str,
+            .len = 0,
+        };
+    }
+    size_t const begin = cur->index[cur->i];
+    if (type == SV_JSON_OBJECT || type == SV_JSON_ARRAY) {
+        SV_json_skip(cur);
+        return (SV_Str_view){
+            .str = cur->src.str + begin,
+            .len = cur->index[cur->i - 1] + 1 - begin,
+        };
+    }
+    size_t const end = json_end(cur);
+    ++cur->i;
+    if (type != SV_JSON_STRING) {
+        return (SV_Str_view){
+            .str = cur->src.str + begin,
+            .len = end - begin,
+        };
+    }
+    if (end - begin < 2 || cur->src.str[end - 1] != '"') {
+        (void)json_fail(cur);
+        return (SV_Str_view){
+            .str = cur->src.str + cur->src.len,
+            .len = 0,
+        };
+    }
+    return (SV_Str_view){
+        .str = cur->src.str + begin + 1,
+        .len = end - begin - 2,
+    };
+}
+
+void
+SV_json_skip(SV_Json_cursor *const cur) {
+    if (!cur || cur->i >= cur->count) {
+        return;
+    }
+    char c = json_char(cur);
+    ++cur->i;
+    if (c != '{' && c != '[') {
+        return;
+    }
+    /* Strings are one structural position so nested brackets within them were
+       never indexed. Counting depth is all that is needed. */
+    size_t depth = 1;
+    while (depth && cur->i < cur->count) {
+        c = json_char(cur);
+        ++cur->i;
+        depth += (c == '{' || c == '[');
+        depth -= (c == '}' || c == ']');
+    }
+}
+
+bool
+SV_json_enter(SV_Json_cursor *const cur) {
+    SV_Json_type const type = SV_json_type(cur);
+    if (type != SV_JSON_OBJECT && type != SV_JSON_ARRAY) {
+        return false;
+    }
+    ++cur->i;
+    return true;
+}
+
+bool
+SV_json_next_key(SV_Json_cursor *const cur, SV_Str_view *const key) {
+    if (!cur || cur->i >= cur->count) {
+        return false;
+    }
+    char const c = json_char(cur);
+    if (c == '}') {
+        ++cur->i;
+        return false;
+    }
+    if (c == ',') {
+        ++cur->i;
+    }
+    if (SV_json_type(cur) != SV_JSON_STRING) {
+        return json_fail(cur);
+    }
+    SV_Str_view const k = SV_json_value(cur);
+    if (cur->i >= cur->count || json_char(cur) != ':') {
+        return json_fail(cur);
+    }
+    ++cur->i;
+    if (key) {
+        *key = k;
+    }
+    return true;
+}
+
+bool
+SV_json_next_element(SV_Json_cursor *const cur) {
+    if (!cur || cur->i >= cur->count) {
+        return false;
+    }
+    switch (json_char(cur)) {
+        case ']':
+            ++cur->i;
+            return false;
+        case ',':
+            /* A comma must be followed by another element, so a trailing
+               comma before the closing bracket is malformed. */
+            ++cur->i;
+            if (cur->i >= cur->count) {
+                return json_fail(cur);
+            }
+            switch (json_char(cur)) {
+                case ']':
+                case '}':
+                case ',':
+                case ':':
+                    return json_fail(cur);
+                default:
+                    return true;
+            }
+        case '}':
+        case ':':
+            return json_fail(cur);
+        default:
+            return true;
+    }
+}
+
+bool
+SV_json_find_key(SV_Json_cursor *const cur, SV_Str_view const key) {
+    SV_Str_view k;
+    while (SV_json_next_key(cur, &k)) {
+        if (SV_compare(k, key) == SV_ORDER_EQUAL) {
+            return true;
+        }
+        SV_json_skip(cur);
+    }
+    return false;
+}
+
+/* ======================   Static Helpers    ============================= */
+
+static size_t
+after_find(SV_Str_view const haystack, SV_Str_view const needle) {
+    if (needle.len > haystack.len) {
+        return 0;
+    }
+    size_t delim_i = 0;
+    size_t i = 0;
+    while (i < haystack.len && needle.str[delim_i] == haystack.str[i]) {
+        delim_i = (delim_i + 1) % needle.len;
+        ++i;
+    }
+    /* Also reset to the last mismatch found. If some of the delimeter matched
+       but then the string changed into a mismatch go back to get characters
+       that are partially in the delimeter. */
+    return i - delim_i;
+}
+
+static size_t
+before_reverse_find(SV_Str_view const haystack, SV_Str_view const needle) {
+    if (needle.len > haystack.len || !needle.len || !haystack.len) {
+        return haystack.len;
+    }
+    size_t delim_i = 0;
+    size_t i = 0;
+    while (i < haystack.len
+           && needle.str[needle.len - delim_i - 1]
+                  == haystack.str[haystack.len - i - 1]) {
+        delim_i = (delim_i + 1) % needle.len;
+        ++i;
+    }
+    /* Ugly logic to account for the reverse nature of this modulo search.
+       the position needs to account for any part of the delim that may
+       have started to match but then mismatched. The 1 is because
+       this in an index being returned not a length. */
+    return i == haystack.len ? haystack.len : haystack.len - i + delim_i - 1;
+}
+
+static inline size_t
+min(size_t const a, size_t const b) {
+    return a < b ? a : b;
+}
+
+static inline ptrdiff_t
+signed_max(ptrdiff_t const a, ptrdiff_t const b) {
+    return a > b ? a : b;
+}
+
+static inline SV_Order
+char_compare(char const a, char const b) {
+    return (a > b) - (a < b);
+}
+
+/* The byte of a view at depth or -1 once the view has ended so that a view
+   sorts before every longer view it is a prefix of. */
+static inline int
+sort_key(SV_Str_view const v, size_t const depth) {
+    return v.str && depth < v.len ? (unsigned char)v.str[depth] : -1;
+}
+
+static inline int
+sort_median(int const a, int const b, int const c) {
+    if (a < b) {
+        return b < c ? b : (a < c ? c : a);
+    }
+    return a < c ? a : (b < c ? c : b);
+}
+
+/* Compares the views after their shared first depth bytes. */
+static bool
+sort_suffix_less(SV_Str_view const a, SV_Str_view const b,
+                 size_t const depth) {
+    size_t const a_len = a.str ? a.len : 0;
+    size_t const b_len = b.str ? b.len : 0;
+    size_t const n = min(a_len, b_len);
+    if (n > depth) {
+        int const cmp = memcmp(a.str + depth, b.str + depth, n - depth);
+        if (cmp) {
+            return cmp < 0;
+        }
+    }
+    return a_len < b_len;
+}
+
+static void
+sort_insertion(SV_Str_view *const views, size_t const n, size_t const depth) {
+    for (size_t i = 1; i < n; ++i) {
+        SV_Str_view const v = views[i];
+        size_t j = i;
+        for (; j && sort_suffix_less(v, views[j - 1], depth); --j) {
+            views[j] = views[j - 1];
+        }
+        views[j] = v;
+    }
+}
+
+static inline void
+sort_swap(SV_Str_view *const views, size_t const i, size_t const j) {
+    SV_Str_view const tmp = views[i];
+    views[i] = views[j];
+    views[j] = tmp;
+}
+
+/* Classifies the next block of the CSV source. A quote toggles whether the
+   following bytes are quoted so the prefix xor of the quote bits marks every
+   quoted byte. A doubled quote within a quoted field toggles out and back in
+   leaving the bytes after it quoted as expected. The state carries into the
+   next block by broadcasting the final bit. */
+static void
+csv_classify(SV_Csv_reader *const r) {
+    unsigned char pad[BLOCK_BYTES];
+    size_t const remain = r->src.len - r->next_block;
+    unsigned char const *const src
+        = (unsigned char const *)r->src.str + r->next_block;
+    struct Block const b = remain >= BLOCK_BYTES
+                             ? block_load(src)
+                             : block_load_partial(remain, src, pad);
+    uint64_t const valid = remain >= BLOCK_BYTES
+                             ? UINT64_MAX
+                             : ((uint64_t)1 << remain) - 1;
+    uint64_t const quotes = block_eq(&b, (unsigned char)r->quote) & valid;
+    uint64_t const delims = block_eq(&b, (unsigned char)r->delim) & valid;
+    uint64_t const newlines = block_eq(&b, '\n') & valid;
+    uint64_t const quoted = prefix_xor(quotes) ^ r->in_quotes;
+    r->in_quotes = (uint64_t)0 - (quoted >> (BLOCK_BYTES - 1));
+    r->separators = (delims | newlines) & ~quoted;
+    r->newlines = newlines & ~quoted;
+    r->block = r->next_block;
+    r->next_block += BLOCK_BYTES;
+}
+
+/* Returns the position of the next unquoted delimiter or newline, reporting
+   which one was found. The end of the source counts as a newline. */
+static size_t
+csv_next_separator(SV_Csv_reader *const r, bool *const newline) {
+    while (!r->separators) {
+        if (r->next_block >= r->src.len) {
+            *newline = true;
+            return r->src.len;
+        }
+        csv_classify(r);
+    }
+    unsigned const bit = ctz64(r->separators);
+    r->separators &= r->separators - 1;
+    *newline = (r->newlines >> bit) & 1;
+    return r->block + bit;
+}
+
+/* Builds the field between begin and end, stripping the carriage return of a
+   CRLF record ending and the surrounding quotes of a quoted field. */
+static SV_Csv_field
+csv_field(SV_Csv_reader const *const r, size_t const begin, size_t end,
+          bool const newline) {
+    char const *const str = r->src.str;
+    if (newline && end > begin && str[end - 1] == '\r') {
+        --end;
+    }
+    if (end - begin >= 2 && str[begin] == r->quote && str[end - 1] == r->quote) {
+        SV_Str_view const inner = {
+            .str = str + begin + 1,
+            .len = end - begin - 2,
+        };
+        return (SV_Csv_field){
+            .view = inner,
+            .needs_unescape = view_match_char(inner.len, inner.str, r->quote)
+                           != inner.len,
+        };
+    }
+    return (SV_Csv_field){
+        .view = {.str = str + begin, .len = end - begin},
+        .needs_unescape = false,
+    };
+}
+
+static inline char
+json_char(SV_Json_cursor const *const cur) {
+    return cur->src.str[cur->index[cur->i]];
+}
+
+/* A value ends at the whitespace before the next structural position or the
+   end of the source. A string ends just past its closing quote. */
+static size_t
+json_end(SV_Json_cursor const *const cur) {
+    size_t const begin = cur->index[cur->i];
+    size_t end
+        = cur->i + 1 < cur->count ? cur->index[cur->i + 1] : cur->src.len;
+    while (end > begin && is_json_space(cur->src.str[end - 1])) {
+        --end;
+    }
+    return end;
+}
+
+/* Malformed text ends the cursor so every following call reports the end.
+   Returns false for convenience in the functions that report success. */
+static bool
+json_fail(SV_Json_cursor *const cur) {
+    cur->i = cur->count;
+    return false;
+}
+
+static inline bool
+is_json_space(char const c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Splits the authority of a URL into userinfo, host, and port. Bracketed IPv6
+   hosts may contain colons so the port is only found after the bracket. */
+static void
+url_authority(SV_Url *const u) {
+    SV_Str_view const a = u->authority;
+    size_t const at = reverse_view_match_char(a.len, a.str, '@');
+    u->userinfo = (SV_Str_view){.str = a.str, .len = at == a.len ? 0 : at};
+    SV_Str_view const host_port = at == a.len ? a : SV_remove_prefix(a, at + 1);
+    size_t colon = host_port.len;
+    if (host_port.len && *host_port.str == '[') {
+        size_t const close
+            = view_match_char(host_port.len, host_port.str, ']');
+        if (close + 1 < host_port.len && host_port.str[close + 1] == ':') {
+            colon = close + 1;
+        }
+    } else {
+        colon = reverse_view_match_char(host_port.len, host_port.str, ':');
+    }
+    u->host = (SV_Str_view){.str = host_port.str, .len = colon};
+    u->port = colon == host_port.len
+                ? (SV_Str_view){.str = host_port.str + colon, .len = 0}
+                : SV_remove_prefix(host_port, colon + 1);
+}
+
+/* Returns the next segment of the path beginning at or after from, which may
+   be a dot segment. Separators are skipped so the segment is empty only when
+   the end of the path is reached. */
+static SV_Str_view
+path_raw_next(SV_Str_view const path, char const *from) {
+    char const *const end = path.str + path.len;
+    while (from < end && *from == '/') {
+        ++from;
+    }
+    return (SV_Str_view){
+        .str = from,
+        .len = view_match_char(end - from, from, '/'),
+    };
+}
+
+static inline bool
+path_is_dot(SV_Str_view const seg) {
+    return seg.len == 1 && seg.str[0] == '.';
+}
+
+static inline bool
+path_is_dotdot(SV_Str_view const seg) {
+    return seg.len == 2 && seg.str[0] == '.' && seg.str[1] == '.';
+}
+
+/* A named segment is removed if some later `..` brings the balance of named
+   segments and `..` after it back to zero. The search stops as soon as the
+   remaining `..` segments are too few to do so. */
+static bool
+path_removed(SV_Path_iter const *const it, SV_Str_view const seg) {
+    size_t balance = 1;
+    size_t dotdots = it->dotdots;
+    for (SV_Str_view s = path_raw_next(it->path, seg.str + seg.len);
+         s.len && dotdots >= balance;
+         s = path_raw_next(it->path, s.str + s.len)) {
+        if (path_is_dotdot(s)) {
+            --dotdots;
+            if (!--balance) {
+                return true;
+            }
+        } else if (!path_is_dot(s)) {
+            ++balance;
+        }
+    }
+    return false;
+}
+
+/* Returns the length of the path without any trailing separators. */
+static size_t
+path_trim_separators(SV_Str_view const path) {
+    size_t end = path.len;
+    while (end && path.str[end - 1] == '/') {
+        --end;
+    }
+    return end;
+}
+
+static SV_Str_view
+charset_trim(SV_Str_view sv, SV_Charset const *const trim) {
+    if (!trim) {
+        return sv;
+    }
+    while (sv.len && SV_charset_contains(trim, *sv.str)) {
+        ++sv.str;
+        --sv.len;
+    }
+    while (sv.len && SV_charset_contains(trim, sv.str[sv.len - 1])) {
+        --sv.len;
+    }
+    return sv;
 }
 
-static inline SV_Order
-char_compare(char const a, char const b) {
-    return (a > b) - (a < b);
+/* Records the pair between begin and end whose key ends at kv, or at end if
+   the key value delimiter was not found before end. */
+static void
+kv_pair(SV_Str_view const src, size_t const begin, size_t const kv,
+        size_t const end, SV_Charset const *const trim, size_t const cap,
+        SV_Str_view *const keys, SV_Str_view *const values, size_t *const n) {
+    size_t const key_end = kv < end ? kv : end;
+    SV_Str_view const key = charset_trim(
+        (SV_Str_view){.str = src.str + begin, .len = key_end - begin}, trim);
+    SV_Str_view const value
+        = kv < end ? charset_trim(
+                         (SV_Str_view){
+                             .str = src.str + kv + 1,
+                             .len = end - kv - 1,
+                         },
+                         trim)
+                   : (SV_Str_view){.str = key.str + key.len, .len = 0};
+    /* A lone kv_delim, as in "a=1&=&b=2", is as empty as no pair at all. */
+    if (!key.len && !value.len) {
+        return;
+    }
+    if (*n < cap) {
+        if (keys) {
+            keys[*n] = key;
+        }
+        if (values) {
+            values[*n] = value;
+        }
+    }
+    ++*n;
 }
 
 /* ======================   Static Utilities    =========================== */
@@ -854,7 +2662,7 @@ view_complimentary_substring_length(size_t const str_size,
          i < set_size && BITOP(byteset, *(unsigned char *)set, |=);
          ++set, ++i) {}
     for (size_t i = 0; i < str_size && !BITOP(byteset, *(unsigned char *)a, &);
-         ++a) {}
+         ++a, ++i) {}
     return a - str;
 }
 
@@ -899,22 +2707,47 @@ view_match(ptrdiff_t const haystack_size,
     if (!haystack_size || !needle_size || needle_size > haystack_size) {
         return haystack_size;
     }
+    size_t found = 0;
     if (1 == needle_size) {
-        return view_match_char(haystack_size, haystack, *needle);
+        SEARCH_PATH(find, SV_STATS_PATH_BYTE, haystack_size, needle_size);
+        found = view_match_char(haystack_size, haystack, *needle);
+    } else if (2 == needle_size) {
+        SEARCH_PATH(find, SV_STATS_PATH_TWO_BYTE, haystack_size, needle_size);
+        found = two_byte_view_match(haystack_size, (unsigned char *)haystack,
+                                    2, (unsigned char *)needle);
+    } else if (3 == needle_size) {
+        SEARCH_PATH(find, SV_STATS_PATH_THREE_BYTE, haystack_size, needle_size);
+        found = three_byte_view_match(haystack_size, (unsigned char *)haystack,
+                                      3, (unsigned char *)needle);
+    } else if (4 == needle_size) {
+        SEARCH_PATH(find, SV_STATS_PATH_FOUR_BYTE, haystack_size, needle_size);
+        found = four_byte_view_match(haystack_size, (unsigned char *)haystack,
+                                     4, (unsigned char *)needle);
+    } else {
+        found = two_way_match(haystack_size, haystack, needle_size, needle);
     }
-    if (2 == needle_size) {
-        return two_byte_view_match(haystack_size, (unsigned char *)haystack, 2,
-                                   (unsigned char *)needle);
-    }
-    if (3 == needle_size) {
-        return three_byte_view_match(haystack_size, (unsigned char *)haystack,
-                                     3, (unsigned char *)needle);
-    }
-    if (4 == needle_size) {
-        return four_byte_view_match(haystack_size, (unsigned char *)haystack, 4,
-                                    (unsigned char *)needle);
+    STATS_ADD(find_bytes, found < (size_t)haystack_size
+                              ? found + (size_t)needle_size
+                              : (size_t)haystack_size);
+    return found;
+}
+
+/* The same dispatch as view_match for a needle that has been preprocessed.
+   Short needles never need preprocessing and take the brute force paths. */
+static size_t
+view_needle_match(ptrdiff_t const haystack_size,
+                  char const ARR_CONST_GEQ(haystack, haystack_size),
+                  SV_Needle const *const n) {
+    ptrdiff_t const needle_size = (ptrdiff_t)n->str.len;
+    if (needle_size <= 4 || !haystack_size || needle_size > haystack_size) {
+        return view_match(haystack_size, haystack, needle_size, n->str.str);
     }
-    return two_way_match(haystack_size, haystack, needle_size, needle);
+    size_t const found
+        = two_way_needle_match(haystack_size, haystack, n, NULL);
+    STATS_ADD(find_bytes, found < (size_t)haystack_size
+                              ? found + (size_t)needle_size
+                              : (size_t)haystack_size);
+    return found;
 }
 
 /* For now reverse logic for backwards searches has been separated into
@@ -930,25 +2763,37 @@ reverse_view_match(ptrdiff_t const haystack_size,
     if (!haystack_size || !needle_size || needle_size > haystack_size) {
         return haystack_size;
     }
+    size_t found = 0;
     if (1 == needle_size) {
-        return reverse_view_match_char(haystack_size, haystack, *needle);
-    }
-    if (2 == needle_size) {
-        return reverse_two_byte_view_match(haystack_size,
-                                           (unsigned char *)haystack, 2,
-                                           (unsigned char *)needle);
-    }
-    if (3 == needle_size) {
-        return reverse_three_byte_view_match(haystack_size,
-                                             (unsigned char *)haystack, 3,
-                                             (unsigned char *)needle);
-    }
-    if (4 == needle_size) {
-        return reverse_four_byte_view_match(haystack_size,
-                                            (unsigned char *)haystack, 4,
+        SEARCH_PATH(reverse_find, SV_STATS_PATH_BYTE, haystack_size,
+                    needle_size);
+        found = reverse_view_match_char(haystack_size, haystack, *needle);
+    } else if (2 == needle_size) {
+        SEARCH_PATH(reverse_find, SV_STATS_PATH_TWO_BYTE, haystack_size,
+                    needle_size);
+        found = reverse_two_byte_view_match(haystack_size,
+                                            (unsigned char *)haystack, 2,
                                             (unsigned char *)needle);
+    } else if (3 == needle_size) {
+        SEARCH_PATH(reverse_find, SV_STATS_PATH_THREE_BYTE, haystack_size,
+                    needle_size);
+        found = reverse_three_byte_view_match(haystack_size,
+                                              (unsigned char *)haystack, 3,
+                                              (unsigned char *)needle);
+    } else if (4 == needle_size) {
+        SEARCH_PATH(reverse_find, SV_STATS_PATH_FOUR_BYTE, haystack_size,
+                    needle_size);
+        found = reverse_four_byte_view_match(haystack_size,
+                                             (unsigned char *)haystack, 4,
+                                             (unsigned char *)needle);
+    } else {
+        found = two_way_reverse_match(haystack_size, haystack, needle_size,
+                                      needle);
     }
-    return two_way_reverse_match(haystack_size, haystack, needle_size, needle);
+    STATS_ADD(reverse_find_bytes, found < (size_t)haystack_size
+                                      ? (size_t)haystack_size - found
+                                      : (size_t)haystack_size);
+    return found;
 }
 
 /*==============   Post-Precomputation Two-Way Search    =================*/
@@ -981,18 +2826,47 @@ two_way_match(ptrdiff_t const haystack_size,
               char const ARR_CONST_GEQ(haystack, haystack_size),
               ptrdiff_t const needle_size,
               char const ARR_CONST_GEQ(needle, needle_size)) {
+    SV_Needle const n = two_way_factorize(needle_size, needle);
+    return two_way_needle_match(haystack_size, haystack, &n, NULL);
+}
+
+/* The preprocessing phase of the two-way search. It is separated from the
+   search so that a SV_Needle may save it for any number of searches. */
+static SV_Needle
+two_way_factorize(ptrdiff_t const needle_size,
+                  char const ARR_CONST_GEQ(needle, needle_size)) {
     /* Preprocessing to get critical position and period distance. */
     struct Factorization const s = maximal_suffix(needle_size, needle);
     struct Factorization const r = maximal_suffix_reverse(needle_size, needle);
     struct Factorization const w
         = (s.critical_position > r.critical_position) ? s : r;
-    /* Determine if memoization is available due to found border/overlap. */
-    if (!memcmp(needle, needle + w.period_distance, w.critical_position + 1)) {
-        return position_memoized(haystack_size, haystack, needle_size, needle,
-                                 w.period_distance, w.critical_position);
+    return (SV_Needle){
+        .str = {.str = needle, .len = (size_t)needle_size},
+        .critical_pos = w.critical_position,
+        .period = w.period_distance,
+        /* Determine if memoization is available due to found border/overlap. */
+        .memoized = !memcmp(needle, needle + w.period_distance,
+                            w.critical_position + 1),
+    };
+}
+
+/* The search phase of the two-way algorithm given a factorized needle. If
+   all is not NULL every occurrence is recorded in it, the scan continuing
+   past each match with the shift and memory it would take after any other
+   full comparison, and the haystack size is returned. */
+static inline size_t
+two_way_needle_match(ptrdiff_t const haystack_size,
+                     char const ARR_CONST_GEQ(haystack, haystack_size),
+                     SV_Needle const *const n, struct Occurrences *const all) {
+    if (n->memoized) {
+        SEARCH_PATH(find, SV_STATS_PATH_TWO_WAY_MEMOIZED, haystack_size,
+                    n->str.len);
+        return position_memoized(haystack_size, haystack, (ptrdiff_t)n->str.len,
+                                 n->str.str, n->period, n->critical_pos, all);
     }
-    return position_normal(haystack_size, haystack, needle_size, needle,
-                           w.period_distance, w.critical_position);
+    SEARCH_PATH(find, SV_STATS_PATH_TWO_WAY, haystack_size, n->str.len);
+    return position_normal(haystack_size, haystack, (ptrdiff_t)n->str.len,
+                           n->str.str, n->period, n->critical_pos, all);
 }
 
 /* Two Way string matching algorithm adapted from ESMAJ
@@ -1002,7 +2876,8 @@ position_memoized(ptrdiff_t const haystack_size,
                   char const ARR_CONST_GEQ(haystack, haystack_size),
                   ptrdiff_t const needle_size,
                   char const ARR_CONST_GEQ(needle, needle_size),
-                  ptrdiff_t const period_dist, ptrdiff_t const critical_pos) {
+                  ptrdiff_t const period_dist, ptrdiff_t const critical_pos,
+                  struct Occurrences *const all) {
     ptrdiff_t lpos = 0;
     ptrdiff_t rpos = 0;
     /* Eliminate worst case quadratic time complexity with memoization. */
@@ -1023,7 +2898,10 @@ position_memoized(ptrdiff_t const haystack_size,
             --rpos;
         }
         if (rpos <= memoize_shift) {
-            return lpos;
+            if (!all) {
+                return lpos;
+            }
+            occurrence(all, lpos);
         }
         lpos += period_dist;
         /* Some prefix of needle coincides with the text. Memoize the length
@@ -1040,7 +2918,8 @@ position_normal(ptrdiff_t const haystack_size,
                 char const ARR_CONST_GEQ(haystack, haystack_size),
                 ptrdiff_t const needle_size,
                 char const ARR_CONST_GEQ(needle, needle_size),
-                ptrdiff_t period_dist, ptrdiff_t const critical_pos) {
+                ptrdiff_t period_dist, ptrdiff_t const critical_pos,
+                struct Occurrences *const all) {
     period_dist
         = signed_max(critical_pos + 1, needle_size - critical_pos - 1) + 1;
     ptrdiff_t lpos = 0;
@@ -1060,13 +2939,25 @@ position_normal(ptrdiff_t const haystack_size,
             --rpos;
         }
         if (rpos < 0) {
-            return lpos;
+            if (!all) {
+                return lpos;
+            }
+            occurrence(all, lpos);
         }
         lpos += period_dist;
     }
     return haystack_size;
 }
 
+/* Records an occurrence found by a two-way search for every occurrence. */
+static inline void
+occurrence(struct Occurrences *const all, ptrdiff_t const pos) {
+    if (all->offsets && all->found < all->cap) {
+        all->offsets[all->found] = (size_t)pos;
+    }
+    ++all->found;
+}
+
 /* ==============   Suffix and Critical Factorization    =================*/
 
 /* Computing of the maximal suffix. Adapted from ESMAJ.
@@ -1201,10 +3092,14 @@ two_way_reverse_match(ptrdiff_t const haystack_size,
     if (!reverse_memcmp(needle + needle_size - 1,
                         needle + needle_size - w.period_distance - 1,
                         w.critical_position + 1)) {
+        SEARCH_PATH(reverse_find, SV_STATS_PATH_TWO_WAY_MEMOIZED,
+                    haystack_size, needle_size);
         return reverse_position_memoized(haystack_size, haystack, needle_size,
                                          needle, w.period_distance,
                                          w.critical_position);
     }
+    SEARCH_PATH(reverse_find, SV_STATS_PATH_TWO_WAY, haystack_size,
+                needle_size);
     return reverse_position_normal(haystack_size, haystack, needle_size, needle,
                                    w.period_distance, w.critical_position);
 }
@@ -1465,3 +3360,969 @@ reverse_four_byte_view_match(size_t const size,
     for (; iw != nw && --i >= h; iw = (iw >> 8) | (*i << 24)) {}
     return i < h ? size : (size_t)(i - h);
 }
+
+/* ==========================   Set Scanning   ============================ */
+
+/* Finding the first or last character in or out of a set compares whole
+   blocks against each character of a small set and visits the bits of the
+   result. The last character is found from the end of the view so trailing
+   characters cost only what they span. Large sets, and builds without vector
+   instructions, test bytes against a table one at a time. */
+
+static struct Set_class
+set_class(SV_Str_view const set) {
+    struct Set_class c = {
+        .table = SV_charset(set),
+    };
+    for (size_t i = 0; i < set.len && c.count <= SET_VECTOR_MAX; ++i) {
+        unsigned char const ch = (unsigned char)set.str[i];
+        size_t seen = 0;
+        for (; seen < c.count && c.chars[seen] != ch; ++seen) {}
+        if (seen == c.count) {
+            if (c.count < SET_VECTOR_MAX) {
+                c.chars[c.count] = ch;
+            }
+            ++c.count;
+        }
+    }
+    return c;
+}
+
+/* Returns the offset of the first of the n bytes whose membership in the set
+   is member, or n if there is none. */
+static size_t
+set_scan(size_t const n, char const ARR_CONST_GEQ(str, n),
+         struct Set_class const *const c, bool const member) {
+    unsigned char const *const s = (unsigned char const *)str;
+    size_t i = 0;
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+    if (c->count <= SET_VECTOR_MAX && n >= BLOCK_BYTES) {
+        for (;; i += BLOCK_BYTES) {
+            /* The final block overlaps bytes already scanned. */
+            size_t const start = min(i, n - BLOCK_BYTES);
+            struct Block const b = block_load(s + start);
+            uint64_t const in = block_in_set(&b, c);
+            uint64_t const found = (member ? in : ~in) >> (i - start);
+            if (found) {
+                return i + ctz64(found);
+            }
+            if (start + BLOCK_BYTES == n) {
+                return n;
+            }
+        }
+    }
+#endif
+    for (; i < n && SV_charset_contains(&c->table, (char)s[i]) != member;
+         ++i) {}
+    return i;
+}
+
+/* Returns the offset of the last of the n bytes whose membership in the set
+   is member, or n if there is none. */
+static size_t
+set_reverse_scan(size_t const n, char const ARR_CONST_GEQ(str, n),
+                 struct Set_class const *const c, bool const member) {
+    unsigned char const *const s = (unsigned char const *)str;
+    size_t end = n;
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+    if (c->count <= SET_VECTOR_MAX && n >= BLOCK_BYTES) {
+        for (;; end -= BLOCK_BYTES) {
+            /* The first block overlaps bytes already scanned. */
+            size_t const start = end < BLOCK_BYTES ? 0 : end - BLOCK_BYTES;
+            struct Block const b = block_load(s + start);
+            uint64_t const in = block_in_set(&b, c);
+            uint64_t const found = (member ? in : ~in)
+                                 << (BLOCK_BYTES - (end - start));
+            if (found) {
+                return end - 1 - clz64(found);
+            }
+            if (!start) {
+                return n;
+            }
+        }
+    }
+#endif
+    for (; end && SV_charset_contains(&c->table, (char)s[end - 1]) != member;
+         --end) {}
+    return end ? end - 1 : n;
+}
+
+/* =======================   Block Classification   ======================= */
+
+/* Parsers that must find several kinds of bytes at once classify the input
+   in blocks of 64 bytes, one bit per byte. The bits of a class can then be
+   combined with simple logic and visited in order with ctz64 rather than
+   branching on every byte. The vector tiers load the block once and compare
+   each class with a handful of instructions. */
+
+static inline struct Block
+block_load(unsigned char const ARR_CONST_GEQ(src, BLOCK_BYTES)) {
+#if defined(SIMD_AVX2)
+    return (struct Block){
+        .v = {
+            _mm256_loadu_si256((__m256i const *)src),
+            _mm256_loadu_si256((__m256i const *)(src + 32)),
+        },
+    };
+#elif defined(SIMD_SSE2)
+    return (struct Block){
+        .v = {
+            _mm_loadu_si128((__m128i const *)src),
+            _mm_loadu_si128((__m128i const *)(src + 16)),
+            _mm_loadu_si128((__m128i const *)(src + 32)),
+            _mm_loadu_si128((__m128i const *)(src + 48)),
+        },
+    };
+#else
+    return (struct Block){.bytes = src};
+#endif
+}
+
+/* Loads the final n < BLOCK_BYTES bytes of an input by copying them to the
+   zeroed pad so that no read occurs past the end of a view. The caller must
+   mask out the bits at or beyond n. The pad must outlive the block. */
+static inline struct Block
+block_load_partial(size_t const n, unsigned char const ARR_CONST_GEQ(src, n),
+                   unsigned char ARR_CONST_GEQ(pad, BLOCK_BYTES)) {
+    memset(pad, 0, BLOCK_BYTES);
+    memcpy(pad, src, n);
+    return block_load(pad);
+}
+
+static inline uint64_t
+block_eq(struct Block const *const b, unsigned char const c) {
+#if defined(SIMD_AVX2)
+    __m256i const splat = _mm256_set1_epi8((char)c);
+    uint64_t const lo
+        = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b->v[0], splat));
+    uint64_t const hi
+        = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b->v[1], splat));
+    return lo | (hi << 32);
+#elif defined(SIMD_SSE2)
+    __m128i const splat = _mm_set1_epi8((char)c);
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                    _mm_cmpeq_epi8(b->v[i], splat))
+             << (i * 16);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < BLOCK_BYTES; ++i) {
+        mask |= (uint64_t)(b->bytes[i] == c) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Bit i of the result is the xor of bits 0 through i of the input. Applied
+   to the bits of opening and closing quotes this marks every byte between
+   them, including the opening quote but not the closing quote. */
+static inline uint64_t
+prefix_xor(uint64_t x) {
+#if defined(__PCLMUL__)
+    return (uint64_t)_mm_cvtsi128_si64(_mm_clmulepi64_si128(
+        _mm_set_epi64x(0, (long long)x), _mm_set1_epi8((char)0xFF), 0));
+#else
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+#endif
+}
+
+/* Returns the bits of the bytes escaped by a backslash, given the bits of the
+   backslashes in a block. A backslash escapes the next byte only if it is not
+   escaped itself, so each run of backslashes escapes the byte after it when
+   the run has odd length. Subtracting the run starts from the odd bit
+   positions carries through each run and leaves the parity at its end,
+   resolving every run at once. The final byte of a block may escape the
+   first byte of the next, which is carried in next_is_escaped.
+   This is the escape scanner described by Langdale and Lemire for simdjson. */
+static inline uint64_t
+escaped_bits(uint64_t const backslash, uint64_t *const next_is_escaped) {
+    uint64_t const odd_bits = 0xAAAAAAAAAAAAAAAAULL;
+    if (!backslash) {
+        uint64_t const escaped = *next_is_escaped;
+        *next_is_escaped = 0;
+        return escaped;
+    }
+    uint64_t const potential_escape = backslash & ~*next_is_escaped;
+    uint64_t const maybe_escaped_and_odd = (potential_escape << 1) | odd_bits;
+    uint64_t const escape_and_terminal
+        = (maybe_escaped_and_odd - potential_escape) ^ odd_bits;
+    uint64_t const escaped
+        = escape_and_terminal ^ (backslash | *next_is_escaped);
+    *next_is_escaped = (escape_and_terminal & backslash) >> (BLOCK_BYTES - 1);
+    return escaped;
+}
+
+/* Bit i of the result is set if byte i of the block is not a UTF-8
+   continuation byte, 0b10xxxxxx. As signed bytes the continuation bytes are
+   exactly those below -64. */
+static inline uint64_t
+block_utf8_leads(struct Block const *const b) {
+#if defined(SIMD_AVX2)
+    __m256i const last_continuation = _mm256_set1_epi8(-65);
+    uint64_t const lo = (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpgt_epi8(b->v[0], last_continuation));
+    uint64_t const hi = (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpgt_epi8(b->v[1], last_continuation));
+    return lo | (hi << 32);
+#elif defined(SIMD_SSE2)
+    __m128i const last_continuation = _mm_set1_epi8(-65);
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                    _mm_cmpgt_epi8(b->v[i], last_continuation))
+             << (i * 16);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < BLOCK_BYTES; ++i) {
+        mask |= (uint64_t)((b->bytes[i] & 0xC0) != 0x80) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Count trailing zeros of a non-zero input. */
+static inline unsigned
+ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__) || defined(__INTEL_LLVM_COMPILER)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    for (; !(x & 1); x >>= 1, ++n) {}
+    return n;
+#endif
+}
+
+/* Bit i of the result is set if byte i of the block is in the set, which
+   must have no more than SET_VECTOR_MAX distinct characters. */
+static inline uint64_t
+block_in_set(struct Block const *const b, struct Set_class const *const c) {
+    uint64_t in = 0;
+    for (size_t i = 0; i < c->count; ++i) {
+        in |= block_eq(b, c->chars[i]);
+    }
+    return in;
+}
+
+/* Count leading zeros of a non-zero input. */
+static inline unsigned
+clz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__) || defined(__INTEL_LLVM_COMPILER)
+    return (unsigned)__builtin_clzll(x);
+#else
+    unsigned n = 0;
+    for (; !(x >> 63); x <<= 1, ++n) {}
+    return n;
+#endif
+}
+
+/* Count the set bits of the input. */
+static inline unsigned
+popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__) || defined(__INTEL_LLVM_COMPILER)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x -= (x >> 1) & 0x5555555555555555ULL;
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* ==========================   UTF-8 Validation   ======================== */
+
+/* Returns the offset of lead byte k of the n bytes, counting from zero, where
+   a lead is any byte that is not a continuation byte. Returns n if there are k
+   or fewer leads. The number of leads before the returned offset is written to
+   leads. Whole blocks are skipped with a population count. */
+static size_t
+utf8_select(size_t const n, unsigned char const ARR_CONST_GEQ(s, n),
+            size_t const k, size_t *const leads) {
+    unsigned char pad[BLOCK_BYTES];
+    size_t seen = 0;
+    for (size_t i = 0; i < n; i += BLOCK_BYTES) {
+        size_t const rest = n - i;
+        struct Block const b = rest >= BLOCK_BYTES
+                                 ? block_load(s + i)
+                                 : block_load_partial(rest, s + i, pad);
+        uint64_t mask = block_utf8_leads(&b);
+        if (rest < BLOCK_BYTES) {
+            mask &= ((uint64_t)1 << rest) - 1;
+        }
+        unsigned const count = popcount64(mask);
+        if (k - seen < count) {
+            for (size_t skip = k - seen; skip; --skip) {
+                mask &= mask - 1;
+            }
+            *leads = k;
+            return i + ctz64(mask);
+        }
+        seen += count;
+    }
+    *leads = seen;
+    return n;
+}
+
+/* Returns the code point beginning at byte i of the view: the byte at i and
+   every continuation byte after it. */
+static SV_Str_view
+utf8_codepoint(SV_Str_view const sv, size_t const i) {
+    if (i >= sv.len) {
+        return (SV_Str_view){
+            .str = sv.str + sv.len,
+            .len = 0,
+        };
+    }
+    size_t len = 1;
+    for (; i + len < sv.len && ((unsigned char)sv.str[i + len] & 0xC0) == 0x80;
+         ++len) {}
+    return (SV_Str_view){
+        .str = sv.str + i,
+        .len = len,
+    };
+}
+
+/* Returns the length of the well formed sequence at the start of the n > 0
+   bytes or 0 if it is not well formed. If the bytes end before a sequence that
+   is well formed so far is complete, truncated is set. These are the ranges of
+   Table 3-7 of the Unicode Standard. */
+static size_t
+utf8_sequence(size_t const n, unsigned char const ARR_CONST_GEQ(s, n),
+              bool *const truncated) {
+    *truncated = false;
+    unsigned char const lead = s[0];
+    if (lead < 0x80) {
+        return 1;
+    }
+    size_t len = 0;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        len = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        len = 3;
+        lo = lead == 0xE0 ? 0xA0 : 0x80;
+        hi = lead == 0xED ? 0x9F : 0xBF;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        len = 4;
+        lo = lead == 0xF0 ? 0x90 : 0x80;
+        hi = lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        return 0;
+    }
+    /* Only the second byte has a narrowed range. */
+    for (size_t i = 1; i < len; ++i, lo = 0x80, hi = 0xBF) {
+        if (i == n) {
+            *truncated = true;
+            return 0;
+        }
+        if (s[i] < lo || s[i] > hi) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/* Validates the bytes from the sequence starting at i and returns the length
+   of the valid prefix. Runs of ASCII are skipped eight bytes at a time. */
+static size_t
+utf8_scalar_prefix(size_t i, size_t const n,
+                   unsigned char const ARR_CONST_GEQ(s, n),
+                   bool *const truncated) {
+    *truncated = false;
+    while (i < n) {
+        uint64_t word;
+        if (n - i >= sizeof(word)) {
+            memcpy(&word, s + i, sizeof(word));
+            if (!(word & 0x8080808080808080ULL)) {
+                i += sizeof(word);
+                continue;
+            }
+        }
+        size_t const len = utf8_sequence(n - i, s + i, truncated);
+        if (!len) {
+            return i;
+        }
+        i += len;
+    }
+    return n;
+}
+
+/* Returns the length of the valid prefix of the bytes. The vector validator
+   only reports the vector in which the first error is found. That error may
+   belong to a sequence beginning up to three bytes earlier, and every byte
+   before it is part of a valid sequence, so the first byte that is not a
+   continuation within those three starts the scalar scan for the exact
+   position. */
+static size_t
+utf8_prefix(size_t const n, unsigned char const ARR_CONST_GEQ(s, n),
+            bool *const truncated) {
+    size_t start = 0;
+#if defined(SIMD_UTF8)
+    size_t block = 0;
+    bool valid = false;
+#    if defined(SIMD_UTF8_AVX2)
+    if (HAVE_AVX2()) {
+        valid = utf8_vector_valid_avx2(n, s, &block);
+    }
+#        if defined(SIMD_UTF8_SSSE3)
+    else {
+        valid = utf8_vector_valid_ssse3(n, s, &block);
+    }
+#        else
+    else {
+        return utf8_scalar_prefix(0, n, s, truncated);
+    }
+#        endif
+#    else
+    valid = utf8_vector_valid_ssse3(n, s, &block);
+#    endif
+    if (valid) {
+        *truncated = false;
+        return n;
+    }
+    for (start = block < 3 ? 0 : block - 3;
+         start < block && (s[start] & 0xC0) == 0x80; ++start) {}
+#endif
+    return utf8_scalar_prefix(start, n, s, truncated);
+}
+
+#if defined(SIMD_UTF8)
+
+/* The lookup algorithm of Keiser and Lemire, "Validating UTF-8 In Less Than
+   One Instruction Per Byte". Every error in UTF-8 is visible in at most the
+   high nibble of a byte and both nibbles of the byte before it. Three table
+   lookups flag, as bits, each kind of error those nibbles could indicate and
+   the intersection of the flags is the set of errors actually present. The
+   only exception is a continuation byte that is the third or fourth byte of
+   a sequence, which is found by looking two and three bytes back. Vectors
+   entirely of ASCII are skipped once no sequence is left incomplete. */
+
+#    define UTF8_TOO_SHORT (1 << 0)
+#    define UTF8_TOO_LONG (1 << 1)
+#    define UTF8_OVERLONG_3 (1 << 2)
+#    define UTF8_TOO_LARGE (1 << 3)
+#    define UTF8_SURROGATE (1 << 4)
+#    define UTF8_OVERLONG_2 (1 << 5)
+#    define UTF8_TOO_LARGE_1000 (1 << 6)
+#    define UTF8_OVERLONG_4 (1 << 6)
+#    define UTF8_TWO_CONTS (1 << 7)
+#    define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/* Indexed by the high nibble of the first byte of a pair. */
+static unsigned char const utf8_byte_1_high[16] = {
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TOO_LONG,
+    UTF8_TWO_CONTS,
+    UTF8_TWO_CONTS,
+    UTF8_TWO_CONTS,
+    UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+};
+
+/* Indexed by the low nibble of the first byte of a pair. */
+static unsigned char const utf8_byte_1_low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+};
+
+/* Indexed by the high nibble of the second byte of a pair. */
+static unsigned char const utf8_byte_2_high[16] = {
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+        | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+        | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE
+        | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE
+        | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT,
+};
+
+/* A byte at or above these in the final three positions of a vector begins a
+   sequence that continues into the next vector. A vector of 16 bytes loads
+   the final 16 entries. */
+static unsigned char const utf8_max_complete[32] = {
+    [32 - 3] = 0xF0 - 1,
+    [32 - 2] = 0xE0 - 1,
+    [32 - 1] = 0xC0 - 1,
+};
+
+/* The validator is written once for both vector widths. Each width supplies
+   a vector type, its size, and the operations below with its own suffix. */
+#    define UTF8_VECTOR_VALID(w, target)                                       \
+        static target bool utf8_vector_valid_##w(                              \
+            size_t const n, unsigned char const ARR_CONST_GEQ(s, n),           \
+            size_t *const block) {                                             \
+            Utf8_vec_##w const byte_1_high = utf8_table_##w(utf8_byte_1_high); \
+            Utf8_vec_##w const byte_1_low = utf8_table_##w(utf8_byte_1_low);   \
+            Utf8_vec_##w const byte_2_high = utf8_table_##w(utf8_byte_2_high); \
+            Utf8_vec_##w const max_complete = utf8_load_##w(                   \
+                utf8_max_complete + 32 - sizeof(Utf8_vec_##w));                \
+            Utf8_vec_##w const low_nibble = utf8_splat_##w(0x0F);              \
+            Utf8_vec_##w const third_byte = utf8_splat_##w(0xE0 - 0x80);       \
+            Utf8_vec_##w const fourth_byte = utf8_splat_##w(0xF0 - 0x80);      \
+            Utf8_vec_##w const high_bit = utf8_splat_##w(0x80);                \
+            Utf8_vec_##w prev = utf8_splat_##w(0);                             \
+            Utf8_vec_##w prev_incomplete = prev;                               \
+            unsigned char pad[sizeof(Utf8_vec_##w)];                           \
+            for (size_t i = 0;; i += sizeof(pad)) {                            \
+                bool const last = n - i < sizeof(pad);                         \
+                if (last) {                                                    \
+                    memset(pad, 0, sizeof(pad));                               \
+                    memcpy(pad, s + i, n - i);                                 \
+                }                                                              \
+                Utf8_vec_##w const in = utf8_load_##w(last ? pad : s + i);     \
+                Utf8_vec_##w error = prev_incomplete;                          \
+                if (!utf8_is_ascii_##w(in)) {                                  \
+                    Utf8_vec_##w const prev1 = utf8_prev_##w(in, prev, 1);     \
+                    Utf8_vec_##w const special = utf8_and_##w(                 \
+                        utf8_and_##w(                                          \
+                            utf8_lookup_##w(byte_1_high,                       \
+                                            utf8_high_nibbles_##w(prev1)),     \
+                            utf8_lookup_##w(byte_1_low,                        \
+                                            utf8_and_##w(prev1, low_nibble))), \
+                        utf8_lookup_##w(byte_2_high,                           \
+                                        utf8_high_nibbles_##w(in)));           \
+                    /* Only a lead of three or four bytes leaves the high bit  \
+                       set. */                                                 \
+                    Utf8_vec_##w const prev2 = utf8_prev_##w(in, prev, 2);     \
+                    Utf8_vec_##w const prev3 = utf8_prev_##w(in, prev, 3);     \
+                    Utf8_vec_##w const must_be_continuation = utf8_and_##w(    \
+                        utf8_or_##w(utf8_subs_##w(prev2, third_byte),          \
+                                    utf8_subs_##w(prev3, fourth_byte)),        \
+                        high_bit);                                             \
+                    error = utf8_xor_##w(must_be_continuation, special);       \
+                    prev_incomplete = utf8_subs_##w(in, max_complete);         \
+                }                                                              \
+                if (utf8_any_##w(error)) {                                     \
+                    *block = i;                                                \
+                    return false;                                              \
+                }                                                              \
+                if (last) {                                                    \
+                    return true;                                               \
+                }                                                              \
+                prev = in;                                                     \
+            }                                                                  \
+        }
+
+#    if defined(SIMD_UTF8_AVX2)
+
+typedef __m256i Utf8_vec_avx2;
+
+/* Shifts the bytes of in up by n, filling with the final bytes of prev. */
+#        define utf8_prev_avx2(in, prev, n)                                    \
+            _mm256_alignr_epi8(                                                \
+                (in), _mm256_permute2x128_si256((prev), (in), 0x21), 16 - (n))
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_load_avx2(unsigned char const *const src) {
+    return _mm256_loadu_si256((__m256i const *)src);
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_table_avx2(unsigned char const ARR_CONST_GEQ(t, 16)) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)t));
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_splat_avx2(unsigned char const c) {
+    return _mm256_set1_epi8((char)c);
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_lookup_avx2(Utf8_vec_avx2 const table, Utf8_vec_avx2 const nibbles) {
+    return _mm256_shuffle_epi8(table, nibbles);
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_high_nibbles_avx2(Utf8_vec_avx2 const v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), utf8_splat_avx2(0x0F));
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_and_avx2(Utf8_vec_avx2 const a, Utf8_vec_avx2 const b) {
+    return _mm256_and_si256(a, b);
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_or_avx2(Utf8_vec_avx2 const a, Utf8_vec_avx2 const b) {
+    return _mm256_or_si256(a, b);
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_xor_avx2(Utf8_vec_avx2 const a, Utf8_vec_avx2 const b) {
+    return _mm256_xor_si256(a, b);
+}
+
+static inline TARGET_AVX2 Utf8_vec_avx2
+utf8_subs_avx2(Utf8_vec_avx2 const a, Utf8_vec_avx2 const b) {
+    return _mm256_subs_epu8(a, b);
+}
+
+static inline TARGET_AVX2 bool
+utf8_any_avx2(Utf8_vec_avx2 const v) {
+    return !_mm256_testz_si256(v, v);
+}
+
+static inline TARGET_AVX2 bool
+utf8_is_ascii_avx2(Utf8_vec_avx2 const v) {
+    return !_mm256_movemask_epi8(v);
+}
+
+UTF8_VECTOR_VALID(avx2, TARGET_AVX2)
+
+#    endif /* SIMD_UTF8_AVX2 */
+#    if defined(SIMD_UTF8_SSSE3)
+
+typedef __m128i Utf8_vec_ssse3;
+
+/* Shifts the bytes of in up by n, filling with the final bytes of prev. */
+#        define utf8_prev_ssse3(in, prev, n)                                   \
+            _mm_alignr_epi8((in), (prev), 16 - (n))
+
+static inline Utf8_vec_ssse3
+utf8_load_ssse3(unsigned char const *const src) {
+    return _mm_loadu_si128((__m128i const *)src);
+}
+
+static inline Utf8_vec_ssse3
+utf8_table_ssse3(unsigned char const ARR_CONST_GEQ(t, 16)) {
+    return _mm_loadu_si128((__m128i const *)t);
+}
+
+static inline Utf8_vec_ssse3
+utf8_splat_ssse3(unsigned char const c) {
+    return _mm_set1_epi8((char)c);
+}
+
+static inline Utf8_vec_ssse3
+utf8_lookup_ssse3(Utf8_vec_ssse3 const table, Utf8_vec_ssse3 const nibbles) {
+    return _mm_shuffle_epi8(table, nibbles);
+}
+
+static inline Utf8_vec_ssse3
+utf8_high_nibbles_ssse3(Utf8_vec_ssse3 const v) {
+    return _mm_and_si128(_mm_srli_epi16(v, 4), utf8_splat_ssse3(0x0F));
+}
+
+static inline Utf8_vec_ssse3
+utf8_and_ssse3(Utf8_vec_ssse3 const a, Utf8_vec_ssse3 const b) {
+    return _mm_and_si128(a, b);
+}
+
+static inline Utf8_vec_ssse3
+utf8_or_ssse3(Utf8_vec_ssse3 const a, Utf8_vec_ssse3 const b) {
+    return _mm_or_si128(a, b);
+}
+
+static inline Utf8_vec_ssse3
+utf8_xor_ssse3(Utf8_vec_ssse3 const a, Utf8_vec_ssse3 const b) {
+    return _mm_xor_si128(a, b);
+}
+
+static inline Utf8_vec_ssse3
+utf8_subs_ssse3(Utf8_vec_ssse3 const a, Utf8_vec_ssse3 const b) {
+    return _mm_subs_epu8(a, b);
+}
+
+static inline bool
+utf8_any_ssse3(Utf8_vec_ssse3 const v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+}
+
+static inline bool
+utf8_is_ascii_ssse3(Utf8_vec_ssse3 const v) {
+    return !_mm_movemask_epi8(v);
+}
+
+UTF8_VECTOR_VALID(ssse3, )
+
+#    endif /* SIMD_UTF8_SSSE3 */
+
+#endif /* SIMD_UTF8 */
+
+/* =========================   Hex and Base64   ============================ */
+
+/* Returns the value of a hex digit in either case or -1. */
+static inline int
+hex_value(unsigned char const c) {
+    if ((unsigned)(c - '0') < 10) {
+        return c - '0';
+    }
+    unsigned const letter = (unsigned)((c | 0x20) - 'a');
+    return letter < 6 ? (int)letter + 10 : -1;
+}
+
+/* Returns the six bit value of a base64 character or -1. */
+static inline int
+base64_value(unsigned char const c, SV_Base64_alphabet const alphabet) {
+    if ((unsigned)(c - 'A') < 26) {
+        return c - 'A';
+    }
+    if ((unsigned)(c - 'a') < 26) {
+        return c - 'a' + 26;
+    }
+    if ((unsigned)(c - '0') < 10) {
+        return c - '0' + 52;
+    }
+    if (c == (alphabet == SV_BASE64_URL ? '-' : '+')) {
+        return 62;
+    }
+    if (c == (alphabet == SV_BASE64_URL ? '_' : '/')) {
+        return 63;
+    }
+    return -1;
+}
+
+/* Returns the number of `=` that end the text, at most two. */
+static size_t
+base64_padding(SV_Str_view const s) {
+    size_t pad = 0;
+    for (; pad < 2 && pad < s.len && s.str[s.len - 1 - pad] == '='; ++pad) {}
+    return pad;
+}
+
+/* Translates the n bytes after an escape into out and returns how many of
+   them were used. An escape at the end of the input stands for itself. */
+static size_t
+unescape_sequence(size_t const n, char const ARR_CONST_GEQ(s, n),
+                  char const escape, unsigned char ARR_CONST_GEQ(out, 4),
+                  size_t *const out_len) {
+    *out_len = 1;
+    if (!n) {
+        out[0] = (unsigned char)escape;
+        return 0;
+    }
+    switch (s[0]) {
+        case 'a':
+            out[0] = '\a';
+            return 1;
+        case 'b':
+            out[0] = '\b';
+            return 1;
+        case 'f':
+            out[0] = '\f';
+            return 1;
+        case 'n':
+            out[0] = '\n';
+            return 1;
+        case 'r':
+            out[0] = '\r';
+            return 1;
+        case 't':
+            out[0] = '\t';
+            return 1;
+        case 'v':
+            out[0] = '\v';
+            return 1;
+        case '0':
+            out[0] = '\0';
+            return 1;
+        case 'x':
+            if (n >= 3 && hex_value((unsigned char)s[1]) >= 0
+                && hex_value((unsigned char)s[2]) >= 0) {
+                out[0] = (unsigned char)((hex_value((unsigned char)s[1]) << 4)
+                                         | hex_value((unsigned char)s[2]));
+                return 3;
+            }
+            break;
+        case 'u': {
+            uint32_t cp = 0;
+            if (!hex_quad(n - 1, s + 1, &cp)) {
+                break;
+            }
+            size_t used = 5;
+            uint32_t low = 0;
+            if (cp >= 0xD800 && cp <= 0xDBFF && n >= 11 && s[5] == escape
+                && s[6] == 'u' && hex_quad(n - 7, s + 7, &low) && low >= 0xDC00
+                && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                used = 11;
+            } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            *out_len = utf8_encode(cp, out);
+            return used;
+        }
+        default:
+            break;
+    }
+    out[0] = (unsigned char)s[0];
+    return 1;
+}
+
+/* Reads four hex digits from the n bytes into value if they are present. */
+static bool
+hex_quad(size_t const n, char const ARR_CONST_GEQ(s, n),
+         uint32_t *const value) {
+    if (n < 4) {
+        return false;
+    }
+    uint32_t v = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        int const digit = hex_value((unsigned char)s[i]);
+        if (digit < 0) {
+            return false;
+        }
+        v = (v << 4) | (uint32_t)digit;
+    }
+    *value = v;
+    return true;
+}
+
+/* Writes the UTF-8 encoding of a scalar value below U+110000 to out and
+   returns its length. */
+static size_t
+utf8_encode(uint32_t const cp, unsigned char ARR_CONST_GEQ(out, 4)) {
+    if (cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (unsigned char)(0xC0 | (cp >> 6));
+        out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | (cp >> 12));
+        out[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | (cp >> 18));
+    out[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+#if defined(SIMD_AVX2_KERNELS)
+
+/* Bytes of v in the inclusive range [lo, lo + span] are all ones. Bytes below
+   lo wrap around to large unsigned values and fall outside the span. */
+static inline TARGET_AVX2 __m256i
+range_eq(__m256i const v, unsigned char const lo, unsigned char const span) {
+    __m256i const shifted = _mm256_sub_epi8(v, _mm256_set1_epi8((char)lo));
+    return _mm256_cmpeq_epi8(
+        _mm256_min_epu8(shifted, _mm256_set1_epi8((char)span)), shifted);
+}
+
+/* Decodes 32 hex digits into 16 bytes if all are valid. Each digit becomes
+   its value and adjacent values are combined as high * 16 + low with one
+   multiply-add, then packed to bytes. */
+static TARGET_AVX2 bool
+hex_decode_vector(unsigned char const ARR_CONST_GEQ(src, 32),
+                  unsigned char ARR_CONST_GEQ(dest, 16)) {
+    __m256i const v = _mm256_loadu_si256((__m256i const *)src);
+    __m256i const digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    __m256i const is_digit = range_eq(v, '0', 9);
+    __m256i const lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i const is_letter = range_eq(lower, 'a', 5);
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter))
+        != UINT32_MAX) {
+        return false;
+    }
+    __m256i const letter
+        = _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10));
+    __m256i const value = _mm256_blendv_epi8(letter, digit, is_digit);
+    __m256i const pairs
+        = _mm256_maddubs_epi16(value, _mm256_set1_epi16(0x0110));
+    /* Packing works within each 128 bit lane so the halves are gathered. */
+    __m256i const packed
+        = _mm256_permute4x64_epi64(_mm256_packus_epi16(pairs, pairs), 0x08);
+    _mm_storeu_si128((__m128i *)dest, _mm256_castsi256_si128(packed));
+    return true;
+}
+
+/* Decodes 32 base64 characters into 24 bytes if all are valid, writing 32
+   bytes to the destination. Each character is offset to its six bit value by
+   the range it falls in. Two multiply-adds then join each group of four
+   values into 24 bits that are shuffled into big endian byte order. */
+static TARGET_AVX2 bool
+base64_decode_vector(unsigned char const ARR_CONST_GEQ(src, 32),
+                     SV_Base64_alphabet const alphabet,
+                     unsigned char ARR_CONST_GEQ(dest, 32)) {
+    unsigned char const c62 = alphabet == SV_BASE64_URL ? '-' : '+';
+    unsigned char const c63 = alphabet == SV_BASE64_URL ? '_' : '/';
+    __m256i const v = _mm256_loadu_si256((__m256i const *)src);
+    __m256i const upper = range_eq(v, 'A', 25);
+    __m256i const lower = range_eq(v, 'a', 25);
+    __m256i const digit = range_eq(v, '0', 9);
+    __m256i const is_62 = _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)c62));
+    __m256i const is_63 = _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)c63));
+    __m256i const valid = _mm256_or_si256(
+        _mm256_or_si256(upper, lower),
+        _mm256_or_si256(digit, _mm256_or_si256(is_62, is_63)));
+    if ((uint32_t)_mm256_movemask_epi8(valid) != UINT32_MAX) {
+        return false;
+    }
+    __m256i const offset = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+            _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+        _mm256_or_si256(
+            _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+            _mm256_or_si256(
+                _mm256_and_si256(is_62, _mm256_set1_epi8((char)(62 - c62))),
+                _mm256_and_si256(is_63, _mm256_set1_epi8((char)(63 - c63))))));
+    __m256i const values = _mm256_add_epi8(v, offset);
+    __m256i const pairs
+        = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i const groups
+        = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    __m256i const bytes = _mm256_shuffle_epi8(
+        groups, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                 -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                 -1, -1, -1, -1));
+    __m256i const packed = _mm256_permutevar8x32_epi32(
+        bytes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    _mm256_storeu_si256((__m256i *)dest, packed);
+    return true;
+}
+
+#endif /* SIMD_AVX2_KERNELS */
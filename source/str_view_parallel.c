@@ -0,0 +1,1498 @@
+/* This file implements the parallel SV_Str_view interface with POSIX threads.
+   The pool gives every thread, including the one submitting a loop, a
+   Chase-Lev deque of index ranges. The owner pushes and pops at the bottom
+   while idle threads steal from the top, so the owner works depth first on
+   small ranges near each other in memory and thieves take the large ranges
+   split off earliest. A search splits the haystack into chunks that overlap
+   by the needle length minus one and runs the same preprocessed needle search
+   as the single threaded interface over each chunk. Results are merged in
+   chunk order so they never depend on scheduling. */
+#include "str_view_parallel.h"
+#include "str_view.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The smallest chunk worth handing to a thread. Below this the cost of
+   claiming and merging a chunk outweighs the search itself. */
+#define MIN_CHUNK_BYTES ((size_t)1 << 20)
+
+/* The fewest views of a batch handed to a thread at once. */
+#define MIN_BATCH_VIEWS 4096
+
+/* Chunks per thread so that a thread finishing early can take more work. */
+#define CHUNKS_PER_THREAD 4
+
+/* The offsets first allocated for the occurrences of one chunk. */
+#define CHUNK_MATCHES 64
+
+/* Buckets of a parallel sort at most this long are not split by another
+   radix pass but sorted whole by one thread. */
+#define MIN_SORT_VIEWS ((size_t)1 << 16)
+
+/* The keys of one radix pass: one for views that have ended and one for
+   each byte value. */
+#define RADIX_KEYS 257
+
+/* The shards of a deduplication set, chosen by the top bits of a hash. Must
+   be a power of two. */
+#define DEDUP_SHARD_BITS 6
+#define DEDUP_SHARDS ((size_t)1 << DEDUP_SHARD_BITS)
+
+/* The fewest slots of one shard. */
+#define DEDUP_MIN_SLOTS 16
+
+/* The bytes of one arena block. Views longer than this get a block of their
+   own. */
+#define ARENA_BLOCK_BYTES ((size_t)1 << 16)
+
+/* Keeps data written by different threads on different cache lines. */
+#define CACHE_LINE 64
+
+/* The ranges a deque holds. A thread only pushes while halving a range so a
+   deque never holds more than one range per bit of a size_t. Must be a power
+   of two. */
+#define DEQUE_CAPACITY 128
+
+/* ========================   Type Definitions   =========================== */
+
+/* Half open range of task indices. */
+struct Range {
+    size_t begin;
+    size_t end;
+};
+
+/* Deque entries are atomic because a thief may read an entry the owner is
+   overwriting. The thief then loses the race on top and discards it. */
+struct Slot {
+    atomic_size_t begin;
+    atomic_size_t end;
+};
+
+/* A Chase-Lev work-stealing deque of fixed capacity. The slots sit between
+   top and bottom so thieves updating one do not share a cache line with the
+   owner updating the other. */
+struct Deque {
+    atomic_llong top;
+    struct Slot slots[DEQUE_CAPACITY];
+    atomic_llong bottom;
+};
+
+/* A pool thread and the deque it owns. Index 0 belongs to the thread that
+   submits a loop and has no pool thread. */
+struct Worker {
+    SV_Pool *pool;
+    size_t index;
+    pthread_t id;
+};
+
+struct SV_Pool {
+    /* The workers started plus the submitting thread. */
+    size_t threads;
+    struct Worker *workers;
+    struct Deque *deques;
+    /* Guards epoch and stop and lets workers sleep between loops. */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    /* Held for the length of a loop so loops run one at a time. */
+    pthread_mutex_t submit;
+    /* Counts loops submitted so a worker knows when a new one begins. */
+    unsigned long long epoch;
+    bool stop;
+    /* The loop being run. */
+    void (*task)(void *, size_t);
+    void *arg;
+    /* Ranges at most this long are run rather than split. */
+    size_t grain;
+    /* The tasks of the loop that have not completed. */
+    atomic_size_t remaining;
+};
+
+/* The loop SV_parallel_for_range runs with one task per chunk. */
+struct Chunked {
+    void (*range)(void *, size_t, size_t);
+    void *arg;
+    size_t n;
+    size_t chunk;
+};
+
+/* The result each chunk of a search produces. */
+enum Search_kind {
+    SEARCH_FIND,
+    SEARCH_COUNT,
+    SEARCH_FIND_ALL,
+};
+
+/* The occurrences found in one chunk by SV_parallel_find_all. At most cap
+   offsets are kept but every occurrence is counted. */
+struct Chunk_matches {
+    size_t *offsets;
+    size_t len;
+    size_t count;
+};
+
+/* The state shared by every thread of one search. */
+struct Search {
+    SV_Str_view haystack;
+    SV_Needle needle;
+    enum Search_kind kind;
+    size_t chunk_bytes;
+    size_t chunks;
+    /* The leftmost occurrence found so far or the haystack length. */
+    atomic_size_t first;
+    /* The occurrences counted so far. */
+    atomic_size_t count;
+    /* One entry per chunk for SEARCH_FIND_ALL. */
+    struct Chunk_matches *matches;
+    size_t cap;
+    /* Set if a thread could not allocate room for its offsets. */
+    atomic_bool failed;
+};
+
+/* The state shared by every thread of one batch search. */
+struct Batch {
+    SV_Str_view const *views;
+    SV_Needle needle;
+    size_t *results;
+};
+
+struct SV_Spsc_queue {
+    /* The consumer's line: the next batch to read and its last view of the
+       producer's position. */
+    _Alignas(CACHE_LINE) atomic_size_t head;
+    size_t tail_cache;
+    /* The producer's line: the next slot to fill and its last view of the
+       consumer's position. */
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    size_t head_cache;
+    /* Read only after creation. */
+    _Alignas(CACHE_LINE) size_t mask;
+    SV_View_batch *slots;
+};
+
+/* A slot is ready to fill on the lap that begins at position p when its
+   sequence is p and ready to read when it is p + 1. Reading it sets the
+   sequence to p + capacity for the next lap. */
+struct Mpmc_slot {
+    atomic_size_t seq;
+    SV_View_batch batch;
+};
+
+struct SV_Mpmc_queue {
+    _Alignas(CACHE_LINE) atomic_size_t enqueue_pos;
+    _Alignas(CACHE_LINE) atomic_size_t dequeue_pos;
+    _Alignas(CACHE_LINE) size_t mask;
+    struct Mpmc_slot *slots;
+};
+
+/* The state shared by every thread of one line index. */
+struct Lines {
+    SV_Str_view sv;
+    size_t chunk;
+    /* The lines of each chunk and then the index of its first line. */
+    size_t *counts;
+    size_t cap;
+    size_t *offsets;
+};
+
+/* A range of views in a parallel sort that share their first depth bytes. */
+struct Sort_bucket {
+    size_t begin;
+    size_t end;
+    size_t depth;
+};
+
+/* A growable list of buckets. */
+struct Sort_buckets {
+    struct Sort_bucket *buckets;
+    size_t len;
+    size_t alloc;
+};
+
+/* The state of one parallel sort. */
+struct Sort {
+    SV_Str_view *views;
+    SV_Executor const *executor;
+    /* Buckets longer than this are split by another radix pass. */
+    size_t limit;
+    /* Buckets waiting for a radix pass and buckets ready to sort. */
+    struct Sort_buckets pending;
+    struct Sort_buckets ready;
+    /* The bucket being split and the radix key of each of its views. */
+    struct Sort_bucket bucket;
+    uint16_t *keys;
+    /* One histogram per chunk of the bucket. */
+    size_t (*counts)[RADIX_KEYS];
+    size_t chunk;
+};
+
+/* The set's copy of a view. The hash is kept so a probe rejects most
+   unequal entries without comparing their bytes. */
+struct Dedup_entry {
+    uint64_t hash;
+    size_t len;
+    char str[];
+};
+
+/* The count of the views whose hash chose one shard. Every insert updates
+   a count so each has its own cache line. */
+struct Dedup_shard {
+    _Alignas(CACHE_LINE) atomic_size_t count;
+};
+
+/* One open addressing table with linear probing. A slot is empty until one
+   compare and swap sets it and then never changes. The table is split into
+   shards so unrelated inserts start far apart, but a probe that fills its
+   shard runs on into the next one so the set holds its full capacity however
+   unevenly the hash spreads. */
+struct SV_Dedup_set {
+    _Atomic(struct Dedup_entry *) *slots;
+    struct Dedup_shard *shards;
+    /* The table has mask + 1 slots. */
+    size_t mask;
+    /* Every shard has shard_mask + 1 slots. */
+    size_t shard_mask;
+    /* Every arena handed out, for destruction. */
+    _Atomic(SV_Dedup_arena *) arenas;
+};
+
+/* A block of arena memory. The bytes are uint64_t so every entry carved
+   from a block is aligned for its header. */
+struct Arena_block {
+    struct Arena_block *next;
+    uint64_t bytes[];
+};
+
+struct SV_Dedup_arena {
+    SV_Dedup_set *set;
+    struct Arena_block *blocks;
+    /* The free bytes at the end of the newest block. */
+    unsigned char *cur;
+    size_t left;
+    /* The next arena of the set. */
+    SV_Dedup_arena *next;
+};
+
+/* The free space of an arena before an allocation so it may be undone. */
+struct Arena_mark {
+    unsigned char *cur;
+    size_t left;
+};
+
+/* =========================   Prototypes   =============================== */
+
+static void *pool_worker(void *);
+static void pool_participate(SV_Pool *, size_t);
+static void pool_run(SV_Pool *, size_t, struct Range);
+static bool pool_steal(SV_Pool *, size_t, struct Range *);
+static void pool_executor_run(void *, size_t, void (*)(void *, size_t),
+                              void *);
+static bool deque_push(struct Deque *, struct Range);
+static bool deque_take(struct Deque *, struct Range *);
+static bool deque_steal(struct Deque *, struct Range *);
+static void chunked_task(void *, size_t);
+static bool search_prepare(struct Search *, SV_Str_view, SV_Str_view,
+                           enum Search_kind, SV_Executor const *);
+static void search_range(void *, size_t, size_t);
+static void batch_range(void *, size_t, size_t);
+static void search_chunk(struct Search *, size_t);
+static void chunk_find_all(struct Search *, size_t, SV_Str_view);
+static SV_Str_view chunk_view(struct Search const *, size_t);
+static void atomic_min(atomic_size_t *, size_t);
+static size_t ring_slots(size_t);
+static void lines_count_range(void *, size_t, size_t);
+static void lines_index_range(void *, size_t, size_t);
+static bool sort_split(struct Sort *, struct Sort_bucket);
+static void sort_histogram_range(void *, size_t, size_t);
+static void sort_bucket_task(void *, size_t);
+static bool sort_buckets_push(struct Sort_buckets *, struct Sort_bucket);
+static uint16_t radix_key(SV_Str_view, size_t);
+static struct Dedup_entry *arena_copy(SV_Dedup_arena *, SV_Str_view, uint64_t,
+                                      struct Arena_mark *);
+static void arena_rollback(SV_Dedup_arena *, struct Arena_mark);
+static bool entry_equal(struct Dedup_entry const *, SV_Str_view, uint64_t);
+static SV_Str_view entry_view(struct Dedup_entry const *);
+static uint64_t dedup_hash(SV_Str_view);
+static size_t dedup_home(SV_Dedup_set const *, uint64_t);
+static uint64_t hash_mix(uint64_t);
+static size_t executor_threads(SV_Executor const *);
+static size_t online_processors(void);
+
+/* ===================   Interface Implementation   ====================== */
+
+SV_Pool *
+SV_pool_create(size_t threads) {
+    if (!threads) {
+        threads = online_processors();
+    }
+    SV_Pool *const p = calloc(1, sizeof(*p));
+    if (!p) {
+        return NULL;
+    }
+    p->workers = calloc(threads, sizeof(*p->workers));
+    p->deques = calloc(threads, sizeof(*p->deques));
+    if (!p->workers || !p->deques) {
+        free(p->workers);
+        free(p->deques);
+        free(p);
+        return NULL;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        atomic_init(&p->deques[i].top, 0);
+        atomic_init(&p->deques[i].bottom, 0);
+    }
+    atomic_init(&p->remaining, 0);
+    (void)pthread_mutex_init(&p->lock, NULL);
+    (void)pthread_cond_init(&p->wake, NULL);
+    (void)pthread_mutex_init(&p->submit, NULL);
+    p->threads = 1;
+    for (size_t i = 1; i < threads; ++i) {
+        p->workers[i] = (struct Worker){.pool = p, .index = i};
+        if (pthread_create(&p->workers[i].id, NULL, pool_worker,
+                           &p->workers[i])) {
+            break;
+        }
+        ++p->threads;
+    }
+    return p;
+}
+
+void
+SV_pool_destroy(SV_Pool *const pool) {
+    if (!pool) {
+        return;
+    }
+    (void)pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    (void)pthread_cond_broadcast(&pool->wake);
+    (void)pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 1; i < pool->threads; ++i) {
+        (void)pthread_join(pool->workers[i].id, NULL);
+    }
+    (void)pthread_mutex_destroy(&pool->lock);
+    (void)pthread_cond_destroy(&pool->wake);
+    (void)pthread_mutex_destroy(&pool->submit);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
+
+size_t
+SV_pool_threads(SV_Pool const *const pool) {
+    return pool ? pool->threads : 1;
+}
+
+void
+SV_pool_for(SV_Pool *const pool, size_t const tasks,
+            void (*const task)(void *, size_t), void *const arg) {
+    if (!task) {
+        return;
+    }
+    if (!pool || pool->threads == 1 || tasks <= 1) {
+        for (size_t i = 0; i < tasks; ++i) {
+            task(arg, i);
+        }
+        return;
+    }
+    (void)pthread_mutex_lock(&pool->submit);
+    pool->task = task;
+    pool->arg = arg;
+    pool->grain = tasks / (pool->threads * CHUNKS_PER_THREAD);
+    if (!pool->grain) {
+        pool->grain = 1;
+    }
+    /* Every range of the last loop completed before it returned so each
+       deque is empty and the root range always fits. */
+    atomic_store(&pool->remaining, tasks);
+    (void)deque_push(&pool->deques[0], (struct Range){.end = tasks});
+    (void)pthread_mutex_lock(&pool->lock);
+    ++pool->epoch;
+    (void)pthread_cond_broadcast(&pool->wake);
+    (void)pthread_mutex_unlock(&pool->lock);
+    pool_participate(pool, 0);
+    (void)pthread_mutex_unlock(&pool->submit);
+}
+
+SV_Executor
+SV_pool_executor(SV_Pool *const pool) {
+    return (SV_Executor){
+        .run = pool_executor_run,
+        .ctx = pool,
+        .threads = SV_pool_threads(pool),
+    };
+}
+
+void
+SV_parallel_for(SV_Executor const *const executor, size_t const tasks,
+                void (*const task)(void *, size_t), void *const arg) {
+    if (!task) {
+        return;
+    }
+    if (executor_threads(executor) <= 1 || tasks <= 1) {
+        for (size_t i = 0; i < tasks; ++i) {
+            task(arg, i);
+        }
+        return;
+    }
+    executor->run(executor->ctx, tasks, task, arg);
+}
+
+size_t
+SV_parallel_chunk(SV_Executor const *const executor, size_t const n,
+                  size_t const min_chunk) {
+    size_t const per = executor_threads(executor) * CHUNKS_PER_THREAD;
+    size_t const chunk = (n / per) + (n % per != 0);
+    if (chunk < min_chunk) {
+        return min_chunk ? min_chunk : 1;
+    }
+    return chunk ? chunk : 1;
+}
+
+void
+SV_parallel_for_range(SV_Executor const *const executor, size_t const n,
+                      size_t const min_chunk,
+                      void (*const range)(void *, size_t, size_t),
+                      void *const arg) {
+    if (!range || !n) {
+        return;
+    }
+    struct Chunked c = {
+        .range = range,
+        .arg = arg,
+        .n = n,
+        .chunk = SV_parallel_chunk(executor, n, min_chunk),
+    };
+    SV_parallel_for(executor, (n + c.chunk - 1) / c.chunk, chunked_task, &c);
+}
+
+size_t
+SV_parallel_find(SV_Str_view const haystack, SV_Str_view const needle,
+                 SV_Executor const *const executor) {
+    struct Search s;
+    if (!search_prepare(&s, haystack, needle, SEARCH_FIND, executor)) {
+        return SV_needle_find(s.haystack, 0, &s.needle);
+    }
+    SV_parallel_for_range(executor, s.haystack.len, s.chunk_bytes,
+                          search_range, &s);
+    return atomic_load(&s.first);
+}
+
+size_t
+SV_parallel_count(SV_Str_view const haystack, SV_Str_view const needle,
+                  SV_Executor const *const executor) {
+    struct Search s;
+    if (!search_prepare(&s, haystack, needle, SEARCH_COUNT, executor)) {
+        return SV_needle_count(s.haystack, &s.needle);
+    }
+    SV_parallel_for_range(executor, s.haystack.len, s.chunk_bytes,
+                          search_range, &s);
+    return atomic_load(&s.count);
+}
+
+size_t
+SV_parallel_find_all(SV_Str_view const haystack, SV_Str_view const needle,
+                     SV_Executor const *const executor, size_t const cap,
+                     size_t *const offsets) {
+    struct Search s;
+    bool const parallel
+        = search_prepare(&s, haystack, needle, SEARCH_FIND_ALL, executor);
+    s.cap = offsets ? cap : 0;
+    s.matches = parallel ? calloc(s.chunks, sizeof(*s.matches)) : NULL;
+    if (!s.matches) {
+        return SV_needle_find_all(s.haystack, &s.needle, cap, offsets);
+    }
+    SV_parallel_for_range(executor, s.haystack.len, s.chunk_bytes,
+                          search_range, &s);
+    bool const failed = atomic_load(&s.failed);
+    size_t written = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < s.chunks; ++i) {
+        struct Chunk_matches const *const m = &s.matches[i];
+        size_t const start = i * s.chunk_bytes;
+        for (size_t j = 0; !failed && j < m->len && written < s.cap; ++j) {
+            offsets[written++] = start + m->offsets[j];
+        }
+        total += m->count;
+        free(m->offsets);
+    }
+    free(s.matches);
+    if (failed) {
+        return SV_needle_find_all(s.haystack, &s.needle, cap, offsets);
+    }
+    return total;
+}
+
+void
+SV_parallel_find_batch(SV_Str_view const *const views, size_t const n,
+                       SV_Str_view const needle,
+                       SV_Executor const *const executor,
+                       size_t *const results) {
+    if (!views || !results) {
+        return;
+    }
+    struct Batch b = {
+        .views = views,
+        .needle = SV_needle(needle),
+        .results = results,
+    };
+    SV_parallel_for_range(executor, n, MIN_BATCH_VIEWS, batch_range, &b);
+}
+
+void
+SV_view_batch_release(SV_View_batch const *const batch) {
+    if (batch && batch->release) {
+        batch->release(batch->ctx);
+    }
+}
+
+SV_Spsc_queue *
+SV_spsc_create(size_t const capacity) {
+    size_t const slots = ring_slots(capacity);
+    SV_Spsc_queue *const q = aligned_alloc(CACHE_LINE, sizeof(*q));
+    if (!q) {
+        return NULL;
+    }
+    q->slots = malloc(slots * sizeof(*q->slots));
+    if (!q->slots) {
+        free(q);
+        return NULL;
+    }
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->tail_cache = 0;
+    q->head_cache = 0;
+    q->mask = slots - 1;
+    return q;
+}
+
+void
+SV_spsc_destroy(SV_Spsc_queue *const queue) {
+    if (!queue) {
+        return;
+    }
+    size_t const tail = atomic_load(&queue->tail);
+    for (size_t i = atomic_load(&queue->head); i != tail; ++i) {
+        SV_view_batch_release(&queue->slots[i & queue->mask]);
+    }
+    free(queue->slots);
+    free(queue);
+}
+
+/* The consumer's position is only read again when the cached copy says the
+   ring is too full, so a producer running ahead of its consumer touches the
+   consumer's line about once per lap. */
+size_t
+SV_spsc_push(SV_Spsc_queue *const queue, SV_View_batch const *const batches,
+             size_t const n) {
+    if (!queue || !batches) {
+        return 0;
+    }
+    size_t const tail
+        = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t const capacity = queue->mask + 1;
+    if (capacity - (tail - queue->head_cache) < n) {
+        queue->head_cache
+            = atomic_load_explicit(&queue->head, memory_order_acquire);
+    }
+    size_t const room = capacity - (tail - queue->head_cache);
+    size_t const k = n < room ? n : room;
+    for (size_t i = 0; i < k; ++i) {
+        queue->slots[(tail + i) & queue->mask] = batches[i];
+    }
+    if (k) {
+        atomic_store_explicit(&queue->tail, tail + k, memory_order_release);
+    }
+    return k;
+}
+
+size_t
+SV_spsc_pop(SV_Spsc_queue *const queue, SV_View_batch *const batches,
+            size_t const cap) {
+    if (!queue || !batches) {
+        return 0;
+    }
+    size_t const head
+        = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (queue->tail_cache - head < cap) {
+        queue->tail_cache
+            = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    }
+    size_t const ready = queue->tail_cache - head;
+    size_t const k = cap < ready ? cap : ready;
+    for (size_t i = 0; i < k; ++i) {
+        batches[i] = queue->slots[(head + i) & queue->mask];
+    }
+    if (k) {
+        atomic_store_explicit(&queue->head, head + k, memory_order_release);
+    }
+    return k;
+}
+
+SV_Mpmc_queue *
+SV_mpmc_create(size_t const capacity) {
+    size_t const slots = ring_slots(capacity);
+    SV_Mpmc_queue *const q = aligned_alloc(CACHE_LINE, sizeof(*q));
+    if (!q) {
+        return NULL;
+    }
+    q->slots = malloc(slots * sizeof(*q->slots));
+    if (!q->slots) {
+        free(q);
+        return NULL;
+    }
+    for (size_t i = 0; i < slots; ++i) {
+        atomic_init(&q->slots[i].seq, i);
+    }
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+    q->mask = slots - 1;
+    return q;
+}
+
+void
+SV_mpmc_destroy(SV_Mpmc_queue *const queue) {
+    if (!queue) {
+        return;
+    }
+    for (size_t pos = atomic_load(&queue->dequeue_pos);; ++pos) {
+        struct Mpmc_slot *const slot = &queue->slots[pos & queue->mask];
+        if (atomic_load(&slot->seq) != pos + 1) {
+            break;
+        }
+        SV_view_batch_release(&slot->batch);
+    }
+    free(queue->slots);
+    free(queue);
+}
+
+/* Vyukov's bounded queue extended to claim a run of slots at once. The run
+   is counted from the position last seen and the compare and swap fails if
+   any other producer claimed a slot since, so every slot of a successful
+   claim was empty and is owned by this call alone. */
+size_t
+SV_mpmc_push(SV_Mpmc_queue *const queue, SV_View_batch const *const batches,
+             size_t const n) {
+    if (!queue || !batches || !n) {
+        return 0;
+    }
+    size_t pos
+        = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t k = 0;
+        size_t seq = 0;
+        for (; k < n && k <= queue->mask; ++k) {
+            seq = atomic_load_explicit(
+                &queue->slots[(pos + k) & queue->mask].seq,
+                memory_order_acquire);
+            if (seq != pos + k) {
+                break;
+            }
+        }
+        if (!k) {
+            /* A slot still holding the last lap's batch means the ring is
+               full. Otherwise another producer moved on first. */
+            if ((ptrdiff_t)(seq - pos) < 0) {
+                return 0;
+            }
+            pos = atomic_load_explicit(&queue->enqueue_pos,
+                                       memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(
+                &queue->enqueue_pos, &pos, pos + k, memory_order_relaxed,
+                memory_order_relaxed)) {
+            for (size_t i = 0; i < k; ++i) {
+                struct Mpmc_slot *const slot
+                    = &queue->slots[(pos + i) & queue->mask];
+                slot->batch = batches[i];
+                atomic_store_explicit(&slot->seq, pos + i + 1,
+                                      memory_order_release);
+            }
+            return k;
+        }
+    }
+}
+
+size_t
+SV_mpmc_pop(SV_Mpmc_queue *const queue, SV_View_batch *const batches,
+            size_t const cap) {
+    if (!queue || !batches || !cap) {
+        return 0;
+    }
+    size_t pos
+        = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t k = 0;
+        size_t seq = 0;
+        for (; k < cap && k <= queue->mask; ++k) {
+            seq = atomic_load_explicit(
+                &queue->slots[(pos + k) & queue->mask].seq,
+                memory_order_acquire);
+            if (seq != pos + k + 1) {
+                break;
+            }
+        }
+        if (!k) {
+            /* A slot not yet filled on this lap means the ring is empty.
+               Otherwise another consumer moved on first. */
+            if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+                return 0;
+            }
+            pos = atomic_load_explicit(&queue->dequeue_pos,
+                                       memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(
+                &queue->dequeue_pos, &pos, pos + k, memory_order_relaxed,
+                memory_order_relaxed)) {
+            for (size_t i = 0; i < k; ++i) {
+                struct Mpmc_slot *const slot
+                    = &queue->slots[(pos + i) & queue->mask];
+                batches[i] = slot->batch;
+                atomic_store_explicit(&slot->seq, pos + i + queue->mask + 1,
+                                      memory_order_release);
+            }
+            return k;
+        }
+    }
+}
+
+size_t
+SV_parallel_line_index(SV_Str_view const sv,
+                       SV_Executor const *const executor, size_t const cap,
+                       size_t *const offsets) {
+    if (!sv.str || executor_threads(executor) <= 1) {
+        return SV_line_index(sv, cap, offsets);
+    }
+    struct Lines l = {
+        .sv = sv,
+        .chunk = SV_parallel_chunk(executor, sv.len, MIN_CHUNK_BYTES),
+        .cap = offsets ? cap : 0,
+        .offsets = offsets,
+    };
+    size_t const chunks = (sv.len + l.chunk - 1) / l.chunk;
+    l.counts = chunks > 1 ? malloc(chunks * sizeof(*l.counts)) : NULL;
+    if (!l.counts) {
+        return SV_line_index(sv, cap, offsets);
+    }
+    SV_parallel_for_range(executor, sv.len, l.chunk, lines_count_range, &l);
+    size_t total = 0;
+    for (size_t i = 0; i < chunks; ++i) {
+        size_t const count = l.counts[i];
+        l.counts[i] = total;
+        total += count;
+    }
+    if (l.cap) {
+        SV_parallel_for_range(executor, sv.len, l.chunk, lines_index_range,
+                              &l);
+    }
+    free(l.counts);
+    return total;
+}
+
+SV_Dedup_set *
+SV_dedup_create(size_t const capacity) {
+    /* Twice the capacity keeps the table at most half full so probes stay
+       short even where the hash is unevenly spread. */
+    size_t slots = DEDUP_MIN_SLOTS;
+    while (slots * DEDUP_SHARDS < capacity * 2) {
+        slots *= 2;
+    }
+    SV_Dedup_set *const set = malloc(sizeof(*set));
+    if (!set) {
+        return NULL;
+    }
+    set->mask = (DEDUP_SHARDS * slots) - 1;
+    set->shard_mask = slots - 1;
+    atomic_init(&set->arenas, NULL);
+    set->shards = aligned_alloc(CACHE_LINE,
+                                DEDUP_SHARDS * sizeof(*set->shards));
+    /* The zero bytes of calloc are the null pointer on every platform with
+       lock free atomic pointers, so the slots start empty. */
+    set->slots = calloc(DEDUP_SHARDS * slots, sizeof(*set->slots));
+    if (!set->shards || !set->slots) {
+        free(set->shards);
+        free(set->slots);
+        free(set);
+        return NULL;
+    }
+    for (size_t i = 0; i < DEDUP_SHARDS; ++i) {
+        atomic_init(&set->shards[i].count, 0);
+    }
+    return set;
+}
+
+void
+SV_dedup_destroy(SV_Dedup_set *const set) {
+    if (!set) {
+        return;
+    }
+    for (SV_Dedup_arena *a = atomic_load(&set->arenas); a;) {
+        for (struct Arena_block *b = a->blocks; b;) {
+            struct Arena_block *const next = b->next;
+            free(b);
+            b = next;
+        }
+        SV_Dedup_arena *const next = a->next;
+        free(a);
+        a = next;
+    }
+    free(set->slots);
+    free(set->shards);
+    free(set);
+}
+
+SV_Dedup_arena *
+SV_dedup_arena(SV_Dedup_set *const set) {
+    if (!set) {
+        return NULL;
+    }
+    SV_Dedup_arena *const a = malloc(sizeof(*a));
+    if (!a) {
+        return NULL;
+    }
+    *a = (SV_Dedup_arena){.set = set};
+    SV_Dedup_arena *head = atomic_load(&set->arenas);
+    do {
+        a->next = head;
+    } while (!atomic_compare_exchange_weak(&set->arenas, &head, a));
+    return a;
+}
+
+/* Most tokens of real text are repeats so the view is only copied once a
+   probe reaches an empty slot. If another thread claims that slot first its
+   entry is compared like any other and, if equal, the copy is given back. */
+SV_Str_view
+SV_dedup_insert(SV_Dedup_arena *const arena, SV_Str_view const sv) {
+    if (!arena || !sv.str) {
+        return (SV_Str_view){0};
+    }
+    SV_Dedup_set const *const set = arena->set;
+    uint64_t const hash = dedup_hash(sv);
+    size_t const s = hash >> (64 - DEDUP_SHARD_BITS);
+    struct Dedup_entry *copy = NULL;
+    struct Arena_mark mark;
+    for (size_t probe = 0, i = dedup_home(set, hash); probe <= set->mask;
+         ++probe, i = (i + 1) & set->mask) {
+        struct Dedup_entry *e
+            = atomic_load_explicit(&set->slots[i], memory_order_acquire);
+        if (!e) {
+            if (!copy) {
+                copy = arena_copy(arena, sv, hash, &mark);
+                if (!copy) {
+                    return (SV_Str_view){0};
+                }
+            }
+            if (atomic_compare_exchange_strong_explicit(
+                    &set->slots[i], &e, copy, memory_order_release,
+                    memory_order_acquire)) {
+                (void)atomic_fetch_add_explicit(&set->shards[s].count, 1,
+                                                memory_order_relaxed);
+                return entry_view(copy);
+            }
+        }
+        if (entry_equal(e, sv, hash)) {
+            if (copy) {
+                arena_rollback(arena, mark);
+            }
+            return entry_view(e);
+        }
+    }
+    if (copy) {
+        arena_rollback(arena, mark);
+    }
+    return (SV_Str_view){0};
+}
+
+SV_Str_view
+SV_dedup_find(SV_Dedup_set const *const set, SV_Str_view const sv) {
+    if (!set || !sv.str) {
+        return (SV_Str_view){0};
+    }
+    uint64_t const hash = dedup_hash(sv);
+    for (size_t probe = 0, i = dedup_home(set, hash); probe <= set->mask;
+         ++probe, i = (i + 1) & set->mask) {
+        struct Dedup_entry const *const e
+            = atomic_load_explicit(&set->slots[i], memory_order_acquire);
+        if (!e) {
+            break;
+        }
+        if (entry_equal(e, sv, hash)) {
+            return entry_view(e);
+        }
+    }
+    return (SV_Str_view){0};
+}
+
+size_t
+SV_dedup_size(SV_Dedup_set const *const set) {
+    if (!set) {
+        return 0;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < DEDUP_SHARDS; ++i) {
+        size += atomic_load_explicit(&set->shards[i].count,
+                                     memory_order_relaxed);
+    }
+    return size;
+}
+
+void
+SV_parallel_sort(SV_Str_view *const views, size_t const n,
+                 SV_Executor const *const executor) {
+    size_t const threads = executor_threads(executor);
+    if (!views || threads <= 1 || n <= MIN_SORT_VIEWS) {
+        SV_sort(views, n);
+        return;
+    }
+    size_t const limit = n / (threads * CHUNKS_PER_THREAD);
+    struct Sort s = {
+        .views = views,
+        .executor = executor,
+        .limit = limit < MIN_SORT_VIEWS ? MIN_SORT_VIEWS : limit,
+        .keys = malloc(n * sizeof(*s.keys)),
+        .counts = malloc(threads * CHUNKS_PER_THREAD * sizeof(*s.counts)),
+    };
+    bool ok = s.keys && s.counts
+           && sort_buckets_push(&s.pending,
+                                (struct Sort_bucket){.end = n, .depth = 0});
+    while (ok && s.pending.len) {
+        ok = sort_split(&s, s.pending.buckets[--s.pending.len]);
+    }
+    if (ok) {
+        SV_parallel_for(executor, s.ready.len, sort_bucket_task, &s);
+    }
+    free(s.keys);
+    free(s.counts);
+    free(s.pending.buckets);
+    free(s.ready.buckets);
+    /* The views are still a permutation of the input whatever pass failed. */
+    if (!ok) {
+        SV_sort(views, n);
+    }
+}
+
+/* ======================   Static Helpers   ============================= */
+
+/* Sleeps until a loop is submitted or the pool stops. A worker still
+   finishing the last loop when the next begins simply joins the next one
+   early, which is safe because it only reads the loop through the ranges it
+   takes and those are published after the loop is set up. */
+static void *
+pool_worker(void *const arg) {
+    struct Worker const *const w = arg;
+    SV_Pool *const p = w->pool;
+    unsigned long long seen = 0;
+    for (;;) {
+        (void)pthread_mutex_lock(&p->lock);
+        while (!p->stop && p->epoch == seen) {
+            (void)pthread_cond_wait(&p->wake, &p->lock);
+        }
+        bool const stop = p->stop;
+        seen = p->epoch;
+        (void)pthread_mutex_unlock(&p->lock);
+        if (stop) {
+            return NULL;
+        }
+        pool_participate(p, w->index);
+    }
+}
+
+/* Runs ranges from the thread's own deque, then from others, until every
+   task of the loop has completed. */
+static void
+pool_participate(SV_Pool *const p, size_t const self) {
+    struct Range r;
+    while (atomic_load(&p->remaining)) {
+        if (deque_take(&p->deques[self], &r) || pool_steal(p, self, &r)) {
+            pool_run(p, self, r);
+        } else {
+            (void)sched_yield();
+        }
+    }
+}
+
+/* Halves the range, leaving each upper half for thieves, until it is no
+   longer than the grain and then runs it. */
+static void
+pool_run(SV_Pool *const p, size_t const self, struct Range r) {
+    while (r.end - r.begin > p->grain) {
+        size_t const mid = r.begin + ((r.end - r.begin) / 2);
+        if (!deque_push(&p->deques[self],
+                        (struct Range){.begin = mid, .end = r.end})) {
+            break;
+        }
+        r.end = mid;
+    }
+    for (size_t i = r.begin; i < r.end; ++i) {
+        p->task(p->arg, i);
+    }
+    (void)atomic_fetch_sub_explicit(&p->remaining, r.end - r.begin,
+                                    memory_order_release);
+}
+
+/* Visits the other deques in turn starting after the thread's own so the
+   threads do not all converge on the same victim. */
+static bool
+pool_steal(SV_Pool *const p, size_t const self, struct Range *const r) {
+    for (size_t k = 1; k < p->threads; ++k) {
+        if (deque_steal(&p->deques[(self + k) % p->threads], r)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+pool_executor_run(void *const ctx, size_t const tasks,
+                  void (*const task)(void *, size_t), void *const arg) {
+    SV_pool_for(ctx, tasks, task, arg);
+}
+
+/* The deque follows Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+   Work-Stealing for Weak Memory Models", with a fixed array. Its sequentially
+   consistent fences are folded into the accesses they order, which costs
+   the same on x86 and lets thread sanitizers follow the synchronization.
+   Only the owner pushes and takes. A full deque refuses the push and the
+   owner runs the range itself. */
+static bool
+deque_push(struct Deque *const d, struct Range const r) {
+    long long const b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long long const t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_CAPACITY) {
+        return false;
+    }
+    struct Slot *const s = &d->slots[b & (DEQUE_CAPACITY - 1)];
+    atomic_store_explicit(&s->begin, r.begin, memory_order_relaxed);
+    atomic_store_explicit(&s->end, r.end, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+/* Takes the newest range. When one range remains the owner races thieves for
+   it on top like any thief would. */
+static bool
+deque_take(struct Deque *const d, struct Range *const r) {
+    long long const b
+        = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store(&d->bottom, b);
+    long long t = atomic_load(&d->top);
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+    struct Slot *const s = &d->slots[b & (DEQUE_CAPACITY - 1)];
+    r->begin = atomic_load_explicit(&s->begin, memory_order_relaxed);
+    r->end = atomic_load_explicit(&s->end, memory_order_relaxed);
+    if (t < b) {
+        return true;
+    }
+    bool const won = atomic_compare_exchange_strong_explicit(
+        &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return won;
+}
+
+/* Takes the oldest range. Losing the race on top to another thief or the
+   owner reports the deque as empty and the caller moves on. */
+static bool
+deque_steal(struct Deque *const d, struct Range *const r) {
+    long long t = atomic_load(&d->top);
+    long long const b = atomic_load(&d->bottom);
+    if (t >= b) {
+        return false;
+    }
+    struct Slot *const s = &d->slots[t & (DEQUE_CAPACITY - 1)];
+    r->begin = atomic_load_explicit(&s->begin, memory_order_relaxed);
+    r->end = atomic_load_explicit(&s->end, memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(
+        &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+static void
+chunked_task(void *const arg, size_t const i) {
+    struct Chunked const *const c = arg;
+    size_t const begin = i * c->chunk;
+    size_t const end = c->n - begin < c->chunk ? c->n : begin + c->chunk;
+    c->range(c->arg, begin, end);
+}
+
+/* Prepares the shared state of a search and reports whether it is worth
+   splitting. If not the caller should search alone. */
+static bool
+search_prepare(struct Search *const s, SV_Str_view const haystack,
+               SV_Str_view const needle, enum Search_kind const kind,
+               SV_Executor const *const executor) {
+    SV_Str_view const h = haystack.str ? haystack : SV_from_terminated("");
+    size_t const chunk_bytes
+        = SV_parallel_chunk(executor, h.len, MIN_CHUNK_BYTES);
+    *s = (struct Search){
+        .haystack = h,
+        .needle = SV_needle(needle),
+        .kind = kind,
+        .chunk_bytes = chunk_bytes,
+        .chunks = (h.len + chunk_bytes - 1) / chunk_bytes,
+    };
+    atomic_init(&s->first, h.len);
+    atomic_init(&s->count, 0);
+    atomic_init(&s->failed, false);
+    return s->needle.str.len && s->needle.str.len <= h.len && s->chunks > 1
+        && executor_threads(executor) > 1;
+}
+
+/* The chunk size was passed as the minimum so each range is exactly one
+   chunk and begin identifies it. */
+static void
+search_range(void *const arg, size_t const begin, size_t const end) {
+    (void)end;
+    struct Search *const s = arg;
+    /* Any occurrence in a chunk beginning after the leftmost so far would
+       lose to it. */
+    if (s->kind == SEARCH_FIND && begin >= atomic_load(&s->first)) {
+        return;
+    }
+    search_chunk(s, begin / s->chunk_bytes);
+}
+
+static void
+batch_range(void *const arg, size_t const begin, size_t const end) {
+    struct Batch *const b = arg;
+    SV_needle_find_batch(b->views + begin, end - begin, &b->needle,
+                         b->results + begin);
+}
+
+static void
+search_chunk(struct Search *const s, size_t const i) {
+    SV_Str_view const v = chunk_view(s, i);
+    switch (s->kind) {
+        case SEARCH_FIND: {
+            size_t const pos = SV_needle_find(v, 0, &s->needle);
+            if (pos < v.len) {
+                atomic_min(&s->first, (i * s->chunk_bytes) + pos);
+            }
+        } break;
+        case SEARCH_COUNT:
+            atomic_fetch_add(&s->count, SV_needle_count(v, &s->needle));
+            break;
+        case SEARCH_FIND_ALL:
+            chunk_find_all(s, i, v);
+            break;
+    }
+}
+
+/* Records the occurrences of one chunk. No chunk can contribute more than
+   cap offsets to the result so no more than that are kept. A first scan
+   writes up to CHUNK_MATCHES offsets, enough for most chunks, and a chunk
+   with more is scanned again into storage sized to hold them. */
+static void
+chunk_find_all(struct Search *const s, size_t const i, SV_Str_view const v) {
+    struct Chunk_matches *const m = &s->matches[i];
+    if (atomic_load(&s->failed)) {
+        return;
+    }
+    if (!s->cap) {
+        m->count = SV_needle_count(v, &s->needle);
+        return;
+    }
+    size_t keep = s->cap < CHUNK_MATCHES ? s->cap : CHUNK_MATCHES;
+    for (;;) {
+        m->offsets = malloc(keep * sizeof(*m->offsets));
+        if (!m->offsets) {
+            atomic_store(&s->failed, true);
+            return;
+        }
+        m->count = SV_needle_find_all(v, &s->needle, keep, m->offsets);
+        if (m->count <= keep || keep == s->cap) {
+            break;
+        }
+        free(m->offsets);
+        keep = m->count < s->cap ? m->count : s->cap;
+    }
+    m->len = m->count < keep ? m->count : keep;
+}
+
+/* Chunk i holds the occurrences beginning in its chunk_bytes. It extends
+   needle length - 1 bytes into the next chunk so an occurrence beginning at
+   its final byte is still found, but no occurrence beginning in the next
+   chunk fits. */
+static SV_Str_view
+chunk_view(struct Search const *const s, size_t const i) {
+    size_t const start = i * s->chunk_bytes;
+    size_t const rest = s->haystack.len - start;
+    size_t const len = s->chunk_bytes + s->needle.str.len - 1;
+    return (SV_Str_view){
+        .str = s->haystack.str + start,
+        .len = len < rest ? len : rest,
+    };
+}
+
+static void
+atomic_min(atomic_size_t *const a, size_t const value) {
+    size_t cur = atomic_load(a);
+    while (value < cur && !atomic_compare_exchange_weak(a, &cur, value)) {}
+}
+
+/* The slots of a ring holding at least capacity entries, a power of two. */
+static size_t
+ring_slots(size_t const capacity) {
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+/* The lines beginning in the chunk. A line begins at begin if the byte before
+   it is a newline, so for every chunk but the first the view starts one
+   byte early and its own first line, which begins in the previous chunk, is
+   not counted. A newline at the chunk's last byte begins a line in the next
+   chunk and SV_line_count() already leaves it out. */
+static void
+lines_count_range(void *const arg, size_t const begin, size_t const end) {
+    struct Lines *const l = arg;
+    size_t const from = begin ? begin - 1 : 0;
+    size_t const lines = SV_line_count((SV_Str_view){
+        .str = l->sv.str + from,
+        .len = end - from,
+    });
+    l->counts[begin / l->chunk] = lines - (begin != 0);
+}
+
+/* Writes the offsets of the lines beginning in the chunk from the index of
+   its first line. The newlines were already counted so they are found here
+   with memchr, which stops as soon as the cap is reached. */
+static void
+lines_index_range(void *const arg, size_t const begin, size_t const end) {
+    struct Lines *const l = arg;
+    size_t line = l->counts[begin / l->chunk];
+    if (line >= l->cap) {
+        return;
+    }
+    if (!begin) {
+        l->offsets[line++] = 0;
+    }
+    char const *const str = l->sv.str;
+    char const *const last = str + end - 1;
+    for (char const *p = str + (begin ? begin - 1 : 0);
+         line < l->cap && p < last && (p = memchr(p, '\n', last - p));
+         ++p) {
+        l->offsets[line++] = (size_t)(p - str) + 1;
+    }
+}
+
+/* One MSD radix pass over a bucket on the byte at its depth. The keys and
+   their histograms are computed in parallel, which is where the views are
+   dereferenced and most cache misses land. The views are then permuted in
+   place with the American flag algorithm, which follows each displaced view
+   to its bucket and needs no second array of views. */
+static bool
+sort_split(struct Sort *const s, struct Sort_bucket const b) {
+    size_t const len = b.end - b.begin;
+    s->bucket = b;
+    s->chunk = SV_parallel_chunk(s->executor, len, MIN_SORT_VIEWS / 4);
+    size_t const chunks = (len + s->chunk - 1) / s->chunk;
+    SV_parallel_for_range(s->executor, len, s->chunk, sort_histogram_range,
+                          s);
+    size_t next[RADIX_KEYS];
+    size_t ends[RADIX_KEYS];
+    size_t total = 0;
+    for (size_t k = 0; k < RADIX_KEYS; ++k) {
+        next[k] = total;
+        for (size_t c = 0; c < chunks; ++c) {
+            total += s->counts[c][k];
+        }
+        ends[k] = total;
+    }
+    SV_Str_view *const views = s->views + b.begin;
+    uint16_t *const keys = s->keys;
+    for (size_t k = 0; k < RADIX_KEYS; ++k) {
+        while (next[k] < ends[k]) {
+            size_t const i = next[k];
+            SV_Str_view v = views[i];
+            uint16_t key = keys[i];
+            while (key != k) {
+                size_t const j = next[key]++;
+                SV_Str_view const displaced = views[j];
+                uint16_t const displaced_key = keys[j];
+                views[j] = v;
+                keys[j] = key;
+                v = displaced;
+                key = displaced_key;
+            }
+            views[i] = v;
+            keys[i] = key;
+            ++next[k];
+        }
+    }
+    /* Views that have ended at this depth are all equal so the first key is
+       finished and the rest move on to the next byte. */
+    for (size_t k = 1, begin = ends[0]; k < RADIX_KEYS; begin = ends[k++]) {
+        struct Sort_bucket const sub = {
+            .begin = b.begin + begin,
+            .end = b.begin + ends[k],
+            .depth = b.depth + 1,
+        };
+        if (sub.end - sub.begin <= 1) {
+            continue;
+        }
+        if (!sort_buckets_push(
+                sub.end - sub.begin > s->limit ? &s->pending : &s->ready,
+                sub)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The chunk size was passed as the minimum so each range is exactly one
+   chunk and begin identifies its histogram. */
+static void
+sort_histogram_range(void *const arg, size_t const begin, size_t const end) {
+    struct Sort *const s = arg;
+    size_t *const counts = s->counts[begin / s->chunk];
+    memset(counts, 0, sizeof(s->counts[0]));
+    SV_Str_view const *const views = s->views + s->bucket.begin;
+    for (size_t i = begin; i < end; ++i) {
+        uint16_t const key = radix_key(views[i], s->bucket.depth);
+        s->keys[i] = key;
+        ++counts[key];
+    }
+}
+
+static void
+sort_bucket_task(void *const arg, size_t const i) {
+    struct Sort const *const s = arg;
+    struct Sort_bucket const b = s->ready.buckets[i];
+    SV_sort_from(s->views + b.begin, b.end - b.begin, b.depth);
+}
+
+static bool
+sort_buckets_push(struct Sort_buckets *const list,
+                  struct Sort_bucket const b) {
+    if (list->len == list->alloc) {
+        size_t const alloc = list->alloc ? list->alloc * 2 : 64;
+        struct Sort_bucket *const grown
+            = realloc(list->buckets, alloc * sizeof(*list->buckets));
+        if (!grown) {
+            return false;
+        }
+        list->buckets = grown;
+        list->alloc = alloc;
+    }
+    list->buckets[list->len++] = b;
+    return true;
+}
+
+/* Zero for a view that has ended at depth so it sorts first, otherwise one
+   more than its byte. A NULL view sorts as the empty string as in SV_sort. */
+static inline uint16_t
+radix_key(SV_Str_view const v, size_t const depth) {
+    return v.str && depth < v.len ? (uint16_t)((unsigned char)v.str[depth] + 1)
+                                  : 0;
+}
+
+/* Copies the view, null terminated, after an entry header at the end of the
+   arena's newest block. */
+static struct Dedup_entry *
+arena_copy(SV_Dedup_arena *const arena, SV_Str_view const sv,
+           uint64_t const hash, struct Arena_mark *const mark) {
+    size_t const bytes
+        = (sizeof(struct Dedup_entry) + sv.len + 1 + sizeof(uint64_t) - 1)
+        & ~(sizeof(uint64_t) - 1);
+    *mark = (struct Arena_mark){.cur = arena->cur, .left = arena->left};
+    if (bytes > arena->left) {
+        size_t const block_bytes
+            = bytes > ARENA_BLOCK_BYTES ? bytes : ARENA_BLOCK_BYTES;
+        struct Arena_block *const b
+            = malloc(sizeof(struct Arena_block) + block_bytes);
+        if (!b) {
+            return NULL;
+        }
+        b->next = arena->blocks;
+        arena->blocks = b;
+        arena->cur = (unsigned char *)b->bytes;
+        arena->left = block_bytes;
+    }
+    struct Dedup_entry *const e = (struct Dedup_entry *)arena->cur;
+    arena->cur += bytes;
+    arena->left -= bytes;
+    e->hash = hash;
+    e->len = sv.len;
+    memcpy(e->str, sv.str, sv.len);
+    e->str[sv.len] = '\0';
+    return e;
+}
+
+/* Gives back the copy made since the mark. If the copy opened a new block
+   the block is kept and the older block's free space is used again. */
+static inline void
+arena_rollback(SV_Dedup_arena *const arena, struct Arena_mark const mark) {
+    arena->cur = mark.cur;
+    arena->left = mark.left;
+}
+
+static inline bool
+entry_equal(struct Dedup_entry const *const e, SV_Str_view const sv,
+            uint64_t const hash) {
+    return e->hash == hash && e->len == sv.len
+        && !memcmp(e->str, sv.str, sv.len);
+}
+
+static inline SV_Str_view
+entry_view(struct Dedup_entry const *const e) {
+    return (SV_Str_view){.str = e->str, .len = e->len};
+}
+
+/* Folds the view eight bytes at a time. The top bits pick the shard and the
+   bottom bits the slot so both must be well mixed. */
+static uint64_t
+dedup_hash(SV_Str_view const sv) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ sv.len;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= sv.len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, sv.str + i, sizeof(word));
+        h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, sv.str + i, sv.len - i);
+    return hash_mix(h ^ tail);
+}
+
+/* The first slot a probe for the hash reads: the top bits pick the shard and
+   the bottom bits the slot within it. */
+static inline size_t
+dedup_home(SV_Dedup_set const *const set, uint64_t const hash) {
+    size_t const shard = hash >> (64 - DEDUP_SHARD_BITS);
+    return (shard * (set->shard_mask + 1)) + (hash & set->shard_mask);
+}
+
+/* The finalizer of splitmix64. */
+static inline uint64_t
+hash_mix(uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+static size_t
+executor_threads(SV_Executor const *const executor) {
+    if (!executor || !executor->run || !executor->threads) {
+        return 1;
+    }
+    return executor->threads;
+}
+
+static size_t
+online_processors(void) {
+    long const n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
@@ -24,7 +24,12 @@ algorithms that run in reverse providing the optimal time complexity for reverse
 string matching. Constant space complexity is an important component of
 maintaining the pure attributes of the searching function. Regardless of the
 underlying string matching algorithm, no side effects occur and no auxiliary
-global or static global storage is needed. */
+global or static global storage is needed.
+
+The one exception is a library built with the `SV_STATS` or `SV_USDT` CMake
+options. `SV_STATS` counts the paths searches take into thread local storage
+and `SV_USDT` fires tracing probes, both side effects, so those builds drop the
+pure attribute from every function. Neither changes what a function returns. */
 #ifndef SV_STR_VIEW
 #define SV_STR_VIEW
 
@@ -91,6 +96,16 @@ any pointer input that could change between calls. */
 #    define SV_STR_LITERAL(str_literal) str_literal
 #endif /* __GNUC__ || __clang__ || __INTEL_LLVM_COMPILER */
 
+/* Counting statistics and firing probes are side effects of the searches, so
+   a compiler must not merge or drop calls it believes are pure. */
+#if defined(SV_STATS) || defined(SV_USDT)
+#    undef SV_ATTRIB_PURE
+/** @brief Describes a function as having no side effects when given the same
+arguments with same underlying data. Empty when statistics are counted or
+probes are compiled in. */
+#    define SV_ATTRIB_PURE /**/
+#endif
+
 #if defined(_MSVC_VER) || defined(_WIN32) || defined(_WIN64)
 #    if defined(SV_BUILD_DLL)
 /** @brief A macro to help with library linking on windows. */
@@ -107,8 +122,28 @@ any pointer input that could change between calls. */
 #    define SV_API /**/
 #endif             /* _MSVC_VER */
 
+/* Trivial accessors are defined at the end of this header. Defining
+   SV_HEADER_ONLY before including it makes them static inline so compilers
+   can fold them into the loops that call them without link time
+   optimization. Otherwise they are declared with SV_API and the library
+   compiles the same definitions out of line, so both builds link together. */
+#ifdef SV_HEADER_ONLY
+/** @brief The linkage of the trivial accessors: static inline when
+SV_HEADER_ONLY is defined and exported from the library otherwise. */
+#    define SV_INLINE static inline
+#else
+/** @brief The linkage of the trivial accessors: static inline when
+SV_HEADER_ONLY is defined and exported from the library otherwise. */
+#    define SV_INLINE SV_API
+#endif
+
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /** @name Types
 The types of the `SV_Str_view` interface. */
@@ -211,8 +246,8 @@ is the minimum value between count and `(length - pos)`.
 given greater than SV_Str_view length an empty view is returned positioned at
 the end of SV_Str_view.
 @warning The end position may or may not hold the null terminator. */
-SV_API SV_Str_view SV_substr(SV_Str_view sv, size_t pos,
-                             size_t count) SV_ATTRIB_PURE;
+SV_INLINE SV_Str_view SV_substr(SV_Str_view sv, size_t pos,
+                                size_t count) SV_ATTRIB_PURE;
 
 /** @brief Returns the bytes of the string pointer to, null terminator included.
 @param[in] str the null terminated input string.
@@ -302,6 +337,31 @@ SV_API SV_Order SV_view_compare(SV_Str_view lhs, char const *rhs, size_t n)
 
 /**@}*/
 
+/** @name Sorting
+Sort arrays of `SV_Str_view` in the order of SV_compare(). */
+/**@{*/
+
+/** @brief Sorts an array of views in place in the order of SV_compare().
+@param[in] views the array of views to sort.
+@param[in] n the number of views.
+
+The sort is a multikey quicksort. It partitions on one byte at a time so the
+common prefix of equal ranges is never compared again, and allocates nothing.
+It is not stable, so equal views with different pointers may be reordered. A
+view with a NULL pointer sorts as the empty string. */
+SV_API void SV_sort(SV_Str_view *views, size_t n);
+
+/** @brief Sorts an array of views known to share their first depth bytes.
+@param[in] views the array of views to sort.
+@param[in] n the number of views.
+@param[in] depth the length of the prefix every view shares.
+
+This is SV_sort() without comparing the first depth bytes again, for callers
+that have already bucketed views by a prefix, such as a radix sort. */
+SV_API void SV_sort_from(SV_Str_view *views, size_t n, size_t depth);
+
+/**@}*/
+
 /** @name Tokenization and Iteration
 Tokenize a `SV_Str_view` and use convenient iteration abstractions. */
 /**@{*/
@@ -328,7 +388,7 @@ such as loops.
 meaning a call to SV_token_begin() or SV_token_next() has yielded a size 0
 SV_Str_view that points at the end of the src SV_Str_view, which may or may not
 be null terminated. */
-SV_API bool SV_token_end(SV_Str_view src, SV_Str_view token) SV_ATTRIB_PURE;
+SV_INLINE bool SV_token_end(SV_Str_view src, SV_Str_view token) SV_ATTRIB_PURE;
 
 /** @brief Advances to the next token in the remaining view separated by the
 delim.
@@ -366,8 +426,8 @@ such as loops.
 position, meaning a call to SV_token_reverse_begin() or SV_token_reverse_next()
 has yielded a size 0 SV_Str_view that points at the start of the src
 SV_Str_view. */
-SV_API bool SV_token_reverse_end(SV_Str_view src,
-                                 SV_Str_view token) SV_ATTRIB_PURE;
+SV_INLINE bool SV_token_reverse_end(SV_Str_view src,
+                                    SV_Str_view token) SV_ATTRIB_PURE;
 
 /** @brief Advances the token in src to the next token between two delimiters
 provided by delim.
@@ -390,21 +450,22 @@ SV_API SV_Str_view SV_token_reverse_next(SV_Str_view src, SV_Str_view token,
 the first valid character in the view.
 @param[in] sv the input string view.
 @return if the view stores NULL, the placeholder SV_null() is returned. */
-SV_API char const *SV_begin(SV_Str_view sv) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_begin(SV_Str_view sv) SV_ATTRIB_PURE;
 
 /** @brief Returns the reverse iterator beginning, the last character of the
 current view.
 @param[in] sv the input string view.
 @return if the view is null SV_null() is returned. If the view is sized zero
 with a valid pointer that pointer in the view is returned. */
-SV_API char const *SV_reverse_begin(SV_Str_view sv) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_reverse_begin(SV_Str_view sv) SV_ATTRIB_PURE;
 
 /** @brief Advances the null terminated string pointer from its previous
 position. If NULL is provided SV_null() is returned.
 @param[in] c the pointer to a null terminated string iterator.
 @return the next character in the string or the end iterator if no characters
 remain. */
-SV_API char const *SV_next(char const *c) SV_ATTRIB_NULLTERM(1) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_next(char const *c)
+    SV_ATTRIB_NULLTERM(1) SV_ATTRIB_PURE;
 
 /** @brief Advances the iterator to the next character in the SV_Str_view being
 iterated through in reverse.
@@ -412,14 +473,14 @@ iterated through in reverse.
 @warning It is undefined behavior to change the SV_Str_view one is iterating
 through during iteration.
 If the char pointer is null, SV_null() is returned. */
-SV_API char const *SV_reverse_next(char const *c) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_reverse_next(char const *c) SV_ATTRIB_PURE;
 
 /** @brief Returns a read only pointer to the end of the string view.
 @param[in] sv the view being iterated over.
 @return the character pointer to the end of this iteration. This may or may not
 be a null terminated character depending on the view. If the view stores NULL,
 the placeholder SV_null() is returned. */
-SV_API char const *SV_end(SV_Str_view sv) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_end(SV_Str_view sv) SV_ATTRIB_PURE;
 
 /** @brief The ending position of a reverse iteration.
 @param[in] sv the view being iterated over in reverse.
@@ -427,7 +488,7 @@ SV_API char const *SV_end(SV_Str_view sv) SV_ATTRIB_PURE;
 @warning It is undefined behavior to access or use rend. It is undefined
 behavior to pass in any SV_Str_view not being iterated through as started with
 reverse_begin. */
-SV_API char const *SV_reverse_end(SV_Str_view sv) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_reverse_end(SV_Str_view sv) SV_ATTRIB_PURE;
 
 /**@}*/
 
@@ -504,7 +565,8 @@ SV_Str_view.
 It is safe to provide n larger than SV_Str_view size as that will result in a
 size 0 view to the end of the current view which may or may not be the null
 terminator. */
-SV_API SV_Str_view SV_remove_prefix(SV_Str_view sv, size_t n) SV_ATTRIB_PURE;
+SV_INLINE SV_Str_view SV_remove_prefix(SV_Str_view sv,
+                                       size_t n) SV_ATTRIB_PURE;
 
 /** @brief Confirms the presence of a suffix within a string view.
 @param[in] sv the string view to search.
@@ -522,7 +584,8 @@ SV_Str_view.
 It is safe to provide n larger than SV_Str_view size as that will result in a
 size 0 view to the end of the current view which may or may not be the null
 terminator. */
-SV_API SV_Str_view SV_remove_suffix(SV_Str_view sv, size_t n) SV_ATTRIB_PURE;
+SV_INLINE SV_Str_view SV_remove_suffix(SV_Str_view sv,
+                                       size_t n) SV_ATTRIB_PURE;
 
 /** Finds the first position of an occurrence of any character in set.
 @param[in] haystack the input view to search.
@@ -570,6 +633,1003 @@ returns 0. */
 SV_API size_t SV_find_last_not_of(SV_Str_view haystack,
                                   SV_Str_view set) SV_ATTRIB_PURE;
 
+/** @brief A needle preprocessed for repeated searches.
+
+Substring searches longer than four bytes factorize the needle before every
+search in the Two-Way algorithm. A `SV_Needle` saves that factorization so the
+same needle may search any number of haystacks with no setup cost. The needle
+string must outlive the `SV_Needle`. Construct it with SV_needle() and avoid
+accessing struct fields. */
+typedef struct {
+    /** The view of the needle string. */
+    SV_Str_view str;
+    /** The critical position of the needle factorization. */
+    ptrdiff_t critical_pos;
+    /** The period of the right half of the factorization. */
+    ptrdiff_t period;
+    /** True if the needle is periodic and the search may memoize shifts. */
+    bool memoized;
+} SV_Needle;
+
+/** @brief Preprocesses a needle for repeated searches.
+@param[in] needle the substring that will be searched.
+@return the preprocessed needle. A NULL needle is treated as empty. */
+SV_API SV_Needle SV_needle(SV_Str_view needle) SV_ATTRIB_PURE;
+
+/** @brief Searches for a preprocessed needle in haystack starting from pos.
+@param[in] haystack the string view to search.
+@param[in] pos the position from which to start the search.
+@param[in] needle the needle preprocessed by SV_needle().
+@return the index of the first character of the match. If the needle is larger
+than the haystack, or position is greater than haystack length, then haystack
+length (npos) is returned. The result is always the same as SV_find(). */
+SV_API size_t SV_needle_find(SV_Str_view haystack, size_t pos,
+                             SV_Needle const *needle) SV_ATTRIB_PURE;
+
+/** @brief Searches for one needle in each of many views.
+@param[in] views the array of views to search.
+@param[in] n the number of views.
+@param[in] needle the substring to match within each view.
+@param[out] results the array of n positions to fill, where results[i] is
+`SV_find(views[i], 0, needle)`.
+
+The needle is preprocessed once for the whole batch and the bytes of upcoming
+views are prefetched while the current view is searched, which suits many
+short views such as the fields of records. */
+SV_API void SV_find_batch(SV_Str_view const *views, size_t n,
+                          SV_Str_view needle, size_t *results);
+
+/** @brief Searches for a preprocessed needle in each of many views.
+@param[in] views the array of views to search.
+@param[in] n the number of views.
+@param[in] needle the needle preprocessed by SV_needle().
+@param[out] results the array of n positions to fill, the same as
+SV_find_batch(). */
+SV_API void SV_needle_find_batch(SV_Str_view const *views, size_t n,
+                                 SV_Needle const *needle, size_t *results);
+
+/** @brief Counts every occurrence of needle in haystack.
+@param[in] haystack the string view to search.
+@param[in] needle the substring to count.
+@return the number of positions at which needle occurs, including occurrences
+that overlap. An empty needle occurs nowhere.
+
+Needles longer than four bytes are counted in one two-way scan that continues
+past each occurrence, so the time is linear in the haystack length even when
+occurrences overlap densely. SV_find_all() and the needle variants do the
+same. */
+SV_API size_t SV_count(SV_Str_view haystack, SV_Str_view needle) SV_ATTRIB_PURE;
+
+/** @brief Counts every occurrence of a preprocessed needle in haystack.
+@param[in] haystack the string view to search.
+@param[in] needle the needle preprocessed by SV_needle().
+@return the same count as SV_count(). */
+SV_API size_t SV_needle_count(SV_Str_view haystack,
+                              SV_Needle const *needle) SV_ATTRIB_PURE;
+
+/** @brief Finds the position of every occurrence of needle in haystack.
+@param[in] haystack the string view to search.
+@param[in] needle the substring to find.
+@param[in] cap the number of positions available in the offsets array.
+@param[out] offsets the array to fill with positions in ascending order.
+@return the number of occurrences, including those that overlap, which may be
+greater than cap. Only the first cap positions are written. */
+SV_API size_t SV_find_all(SV_Str_view haystack, SV_Str_view needle, size_t cap,
+                          size_t *offsets);
+
+/** @brief Finds the position of every occurrence of a preprocessed needle.
+@param[in] haystack the string view to search.
+@param[in] needle the needle preprocessed by SV_needle().
+@param[in] cap the number of positions available in the offsets array.
+@param[out] offsets the array to fill with positions in ascending order.
+@return the same count as SV_find_all(). */
+SV_API size_t SV_needle_find_all(SV_Str_view haystack, SV_Needle const *needle,
+                                 size_t cap, size_t *offsets);
+
+/** @brief The state of a search over a stream that arrives in chunks.
+
+Only the last needle length - 1 bytes of the stream can begin an occurrence
+that ends in a later chunk, so the state keeps at most that many bytes in a
+window the caller provides, along with the stream offset of the next chunk.
+Construct it with SV_search_state() and avoid accessing struct fields. */
+typedef struct {
+    /** The needle preprocessed by SV_needle(). */
+    SV_Needle const *needle;
+    /** The caller's buffer of SV_search_window_bytes() bytes. The carried
+        bytes are at its start and the rest is working space. */
+    char *window;
+    /** The bytes of the stream's end carried at the start of window. */
+    size_t carry;
+    /** The stream offset of the first byte of the next chunk. */
+    size_t offset;
+} SV_Search_state;
+
+/** @brief Returns the bytes of window a streaming search for needle needs.
+@param[in] needle the needle preprocessed by SV_needle().
+@return twice the needle length minus one, or 0 for needles of at most one
+byte, which never span chunks. */
+SV_API size_t SV_search_window_bytes(SV_Needle const *needle) SV_ATTRIB_PURE;
+
+/** @brief Begins a streaming search at stream offset 0.
+@param[in] needle the needle preprocessed by SV_needle(), which must outlive
+the state.
+@param[in] window a buffer of at least SV_search_window_bytes() bytes that
+must outlive the state. It may be NULL if that is 0.
+@return the state of a search that has seen no bytes. */
+SV_API SV_Search_state SV_search_state(SV_Needle const *needle, char *window);
+
+/** @brief Searches the next chunk of a stream.
+@param[in] state the state of the search, updated to follow chunk.
+@param[in] chunk the bytes of the stream that follow every earlier chunk.
+@param[in] cap the number of positions available in the offsets array.
+@param[out] offsets the array to fill, in ascending order, with the stream
+offsets of the occurrences that end in this chunk.
+@return the number of occurrences that end in this chunk, which may be greater
+than cap. Only the first cap offsets are written.
+
+Over any division of a stream into chunks, the offsets reported are exactly
+those SV_find_all() reports over the whole stream. Occurrences that span the
+previous chunk are found in the carried bytes followed by at most needle
+length - 1 bytes of chunk, copied after them in the window. The rest of chunk
+is searched in place and is not referenced after the call returns. */
+SV_API size_t SV_search_feed(SV_Search_state *state, SV_Str_view chunk,
+                             size_t cap, size_t *offsets);
+
+/**@}*/
+
+/** @name Trimming
+Remove characters from the ends of views and collapse whitespace. */
+/**@{*/
+
+/** @brief Removes characters in set from both ends of a view.
+@param[in] sv the view to trim.
+@param[in] set the characters to remove. An empty set (NULL) removes the ASCII
+whitespace characters ` \t\n\v\f\r`.
+@return the view of sv between the first and last characters not in set, which
+is empty and at the end of sv if every character is in set.
+
+No bytes are copied. Small sets are compared against 64 bytes at a time with
+vector instructions and trailing characters are found scanning from the end, so
+the cost is proportional to the number of characters removed. */
+SV_API SV_Str_view SV_trim(SV_Str_view sv, SV_Str_view set) SV_ATTRIB_PURE;
+
+/** @brief Removes characters in set from the start of a view.
+@param[in] sv the view to trim.
+@param[in] set the characters to remove. An empty set (NULL) removes the ASCII
+whitespace characters ` \t\n\v\f\r`.
+@return the view of sv from the first character not in set, which is empty and
+at the end of sv if every character is in set. */
+SV_API SV_Str_view SV_trim_left(SV_Str_view sv, SV_Str_view set) SV_ATTRIB_PURE;
+
+/** @brief Removes characters in set from the end of a view.
+@param[in] sv the view to trim.
+@param[in] set the characters to remove. An empty set (NULL) removes the ASCII
+whitespace characters ` \t\n\v\f\r`.
+@return the view of sv up to and including the last character not in set,
+which is empty and at the start of sv if every character is in set. */
+SV_API SV_Str_view SV_trim_right(SV_Str_view sv,
+                                 SV_Str_view set) SV_ATTRIB_PURE;
+
+/** @brief Copies a view into the destination buffer with whitespace removed
+from both ends and each inner run of whitespace replaced by one space, null
+terminating the string.
+@param[in] src the view to copy.
+@param[in] dest_bytes the bytes available in the destination.
+@param[in] dest_buf the character buffer destination.
+@return the number of bytes written, including the null terminator.
+
+Whitespace is the ASCII characters ` \t\n\v\f\r`. The output may be cut off
+if the destination is too small, as with SV_fill(). */
+SV_API size_t SV_collapse_whitespace(SV_Str_view src, size_t dest_bytes,
+                                     char *dest_buf);
+
+/**@}*/
+
+/** @name Quoted Strings
+Find the end of quoted strings and unescape their contents. */
+/**@{*/
+
+/** @brief Finds the first quote character that is not escaped.
+@param[in] sv the view to search, such as the contents of a string after its
+opening quote.
+@param[in] quote the quote character to find.
+@param[in] escape the escape character, usually `\`.
+@return the position of the first quote that is not escaped or the length of
+sv if there is none.
+
+A quote is escaped when preceded by an odd run of escape characters. Runs are
+resolved 64 bytes at a time with bit arithmetic rather than byte by byte. */
+SV_API size_t SV_find_unescaped(SV_Str_view sv, char quote,
+                                char escape) SV_ATTRIB_PURE;
+
+/** @brief Unescapes a view into the destination buffer only if it contains
+escapes.
+@param[in] src the view to unescape, such as a quoted string without quotes.
+@param[in] escape the escape character, usually `\`.
+@param[in] dest_bytes the bytes available in the destination.
+@param[in] dest_buf the character buffer destination.
+@return src itself if it contains no escape characters, in which case nothing
+is written. Otherwise a view of the unescaped string in dest_buf, which is null
+terminated and may be cut off if the destination is too small as with
+SV_fill(). Compare the `str` of the result with the `str` of src to learn which
+occurred.
+
+The character after an escape is translated as in C and JSON: `b f n r t v a`
+to their control characters, `0` to a null byte, `xHH` to one byte, and `uXXXX`
+to UTF-8, joining surrogate pairs. A surrogate that is not half of a pair
+becomes U+FFFD. Any other character, such as a quote or the escape itself,
+stands for itself, as does an `x` or `u` without all of its digits and an
+escape at the end of src. */
+SV_API SV_Str_view SV_unescape_into(SV_Str_view src, char escape,
+                                    size_t dest_bytes, char *dest_buf);
+
+/**@}*/
+
+/** @name Line Indexing
+Count and locate the lines of a `SV_Str_view`. A line begins at the start of
+the view and after every newline except a final one, so `"a\nb"` and
+`"a\nb\n"` both have two lines and the empty view has none. */
+/**@{*/
+
+/** @brief Counts the lines of a view.
+@param[in] sv the view to count.
+@return the number of lines.
+
+Newlines are counted a block of bytes at a time with a population count. */
+SV_API size_t SV_line_count(SV_Str_view sv) SV_ATTRIB_PURE;
+
+/** @brief Finds the offset at which every line of a view begins.
+@param[in] sv the view to index.
+@param[in] cap the number of offsets available in the offsets array.
+@param[out] offsets the array to fill with line starts in ascending order.
+@return the same count as SV_line_count(), which may be greater than cap. Only
+the first cap offsets are written. */
+SV_API size_t SV_line_index(SV_Str_view sv, size_t cap, size_t *offsets);
+
+/**@}*/
+
+/** @name Character Sets
+Precompute membership tables for sets of characters used across many calls. */
+/**@{*/
+
+/** @brief A table of 256 bits recording membership of each byte value.
+
+Functions that accept a set of characters as a `SV_Str_view` build this table on
+every call. Building it once with SV_charset() saves that work when the same set
+is used repeatedly, such as when trimming many fields. */
+typedef struct {
+    /** Bit `c % 8` of byte `c / 8` is set if character `c` is a member. */
+    unsigned char bits[32];
+} SV_Charset;
+
+/** @brief Constructs the table of characters found in the set.
+@param[in] set the characters that are members. A NULL or empty view yields the
+empty set.
+@return the membership table of set. */
+SV_API SV_Charset SV_charset(SV_Str_view set) SV_ATTRIB_PURE;
+
+/** @brief Tests membership of a character in a set.
+@param[in] set the membership table.
+@param[in] c the character to test.
+@return true if c is a member of the set, false otherwise or if set is NULL. */
+SV_API bool SV_charset_contains(SV_Charset const *set, char c) SV_ATTRIB_PURE;
+
+/**@}*/
+
+/** @name CSV Parsing
+Read RFC 4180 style records as arrays of `SV_Str_view` fields. */
+/**@{*/
+
+/** @brief A single field of a CSV record.
+
+The view points into the source being read. A quoted field has its surrounding
+quotes removed from the view but any doubled quotes within remain as written. */
+typedef struct {
+    /** The field contents without surrounding quotes. */
+    SV_Str_view view;
+    /** True if the field contains doubled quotes that must be unescaped with
+       SV_csv_unescape() before use. */
+    bool needs_unescape;
+} SV_Csv_field;
+
+/** @brief The state of a CSV reader over a source view.
+
+The reader classifies the source 64 bytes at a time, remembering the unquoted
+delimiters and newlines of the current block between calls. Construct it with
+SV_csv_reader() and avoid accessing struct fields. */
+typedef struct {
+    /** The source view being read. */
+    SV_Str_view src;
+    /** The position at which the next field begins. */
+    size_t pos;
+    /** The offset of the block currently classified. */
+    size_t block;
+    /** The offset of the next block to classify. */
+    size_t next_block;
+    /** Unquoted delimiters and newlines remaining in the current block. */
+    unsigned long long separators;
+    /** The subset of separators that end a record. */
+    unsigned long long newlines;
+    /** All bits set if the previous block ended within a quoted field. */
+    unsigned long long in_quotes;
+    /** The field delimiter. */
+    char delim;
+    /** The quote character. */
+    char quote;
+} SV_Csv_reader;
+
+/** @brief Constructs a reader over the source view.
+@param[in] src the CSV text to read.
+@param[in] delim the field delimiter, usually `,`.
+@param[in] quote the quote character, usually `"`.
+@return a reader positioned at the first record of src.
+
+Records end at an unquoted `\n` or the end of the source and a `\r` immediately
+before either is not part of the last field. Delimiters and newlines within
+quotes are part of the field. */
+SV_API SV_Csv_reader SV_csv_reader(SV_Str_view src, char delim,
+                                   char quote) SV_ATTRIB_PURE;
+
+/** @brief Reads the next record of the reader into the fields array.
+@param[in] reader the reader to advance.
+@param[in] cap the number of fields available in the fields array.
+@param[out] fields the array to fill with the fields of the record.
+@return the number of fields in the record, which may be greater than cap. Only
+the first cap fields are written. Zero is returned when no records remain.
+
+For example:
+
+```
+SV_Csv_reader r = SV_csv_reader(src, ',', '"');
+SV_Csv_field fields[16];
+for (size_t n; (n = SV_csv_next(&r, 16, fields));)
+{}
+```
+
+An empty line is a record of one empty field. A final newline at the end of
+the source does not begin another record. */
+SV_API size_t SV_csv_next(SV_Csv_reader *reader, size_t cap,
+                          SV_Csv_field *fields);
+
+/** @brief Copies a field into the destination buffer, replacing each doubled
+quote with a single quote, null terminating the string.
+@param[in] field the field to unescape.
+@param[in] quote the quote character used by the reader.
+@param[in] dest_bytes the bytes available in the destination.
+@param[in] dest_buf the character buffer destination.
+@return the number of bytes written, including the null terminator.
+
+A field that does not need unescaping is copied as is. The output may be cut
+off if the destination is too small, as with SV_fill(). */
+SV_API size_t SV_csv_unescape(SV_Csv_field field, char quote,
+                              size_t dest_bytes, char *dest_buf);
+
+/**@}*/
+
+/** @name JSON Indexing
+Index the structure of JSON text and read keys and values as `SV_Str_view`. */
+/**@{*/
+
+/** @brief The type of the JSON value at the position of a cursor. */
+typedef enum {
+    /** The cursor is not at a valid value. */
+    SV_JSON_ERROR = 0,
+    /** An object beginning with `{`. */
+    SV_JSON_OBJECT,
+    /** An array beginning with `[`. */
+    SV_JSON_ARRAY,
+    /** A string beginning with `"`. */
+    SV_JSON_STRING,
+    /** A number beginning with `-` or a digit. */
+    SV_JSON_NUMBER,
+    /** The literal `true`. */
+    SV_JSON_TRUE,
+    /** The literal `false`. */
+    SV_JSON_FALSE,
+    /** The literal `null`. */
+    SV_JSON_NULL,
+    /** The cursor has consumed every structural position. */
+    SV_JSON_END,
+} SV_Json_type;
+
+/** @brief An on-demand cursor over the structural index of JSON text.
+
+The cursor moves forward through the positions written by SV_json_index(),
+never allocating or copying. Construct it with SV_json_cursor() and avoid
+accessing struct fields. */
+typedef struct {
+    /** The JSON text that was indexed. */
+    SV_Str_view src;
+    /** The structural positions of the text. */
+    size_t const *index;
+    /** The number of structural positions. */
+    size_t count;
+    /** The next structural position to consume. */
+    size_t i;
+} SV_Json_cursor;
+
+/** @brief Writes the position of every structural character of the JSON text
+into the index.
+@param[in] src the JSON text to index.
+@param[in] cap the number of positions available in the index.
+@param[out] index the array to fill with structural positions.
+@return the number of structural positions in src, which may be greater than
+cap. Only the first cap positions are written.
+
+A structural position is any of `{}[]:,` outside of a string, the opening quote
+of a string, or the first character of a number or literal. The text is
+classified 64 bytes at a time, resolving escaped quotes and string regions
+without branching on each byte. The text is not validated beyond this. */
+SV_API size_t SV_json_index(SV_Str_view src, size_t cap, size_t *index);
+
+/** @brief Constructs a cursor over indexed JSON text.
+@param[in] src the JSON text that was indexed.
+@param[in] count the number of structural positions returned by indexing.
+@param[in] index the structural positions written by SV_json_index().
+@return a cursor positioned at the first value of src. */
+SV_API SV_Json_cursor SV_json_cursor(SV_Str_view src, size_t count,
+                                     size_t const *index) SV_ATTRIB_PURE;
+
+/** @brief Obtain the type of the value at the cursor.
+@param[in] cur the cursor to check.
+@return the type of the value found at the cursor position. */
+SV_API SV_Json_type SV_json_type(SV_Json_cursor const *cur) SV_ATTRIB_PURE;
+
+/** @brief Reads the value at the cursor and advances past it.
+@param[in] cur the cursor to advance.
+@return a view of the value in the source. A string is viewed without its
+surrounding quotes and with any escapes as written. An object or array is
+viewed from its opening to its closing bracket. If no valid value is found
+an empty view at the end of the source is returned and the cursor ends. */
+SV_API SV_Str_view SV_json_value(SV_Json_cursor *cur);
+
+/** @brief Advances past the value at the cursor, including every nested value
+of an object or array, using only the structural index.
+@param[in] cur the cursor to advance. */
+SV_API void SV_json_skip(SV_Json_cursor *cur);
+
+/** @brief Steps into the object or array at the cursor.
+@param[in] cur the cursor to advance.
+@return true if the cursor was at an object or array, false otherwise. */
+SV_API bool SV_json_enter(SV_Json_cursor *cur);
+
+/** @brief Reads the next key of the object the cursor has entered, leaving the
+cursor at the value of that key.
+@param[in] cur the cursor within an object.
+@param[out] key the key without its surrounding quotes. May be NULL.
+@return true if a key was read, false if the end of the object was reached and
+consumed or the text is malformed.
+
+The value of each key must be read or skipped before the next key. For example:
+
+```
+SV_Json_cursor cur = SV_json_cursor(line, n, index);
+SV_Str_view key;
+if (SV_json_enter(&cur))
+{
+    while (SV_json_next_key(&cur, &key))
+    {
+        if (SV_compare(key, SV_from("id")) == SV_ORDER_EQUAL)
+        {
+            id = SV_json_value(&cur);
+        }
+        else
+        {
+            SV_json_skip(&cur);
+        }
+    }
+}
+``` */
+SV_API bool SV_json_next_key(SV_Json_cursor *cur, SV_Str_view *key);
+
+/** @brief Moves to the next element of the array the cursor has entered.
+@param[in] cur the cursor within an array.
+@return true if the cursor is at another element, false if the end of the array
+was reached and consumed or the text is malformed.
+
+The element must be read or skipped before the next call. */
+SV_API bool SV_json_next_element(SV_Json_cursor *cur);
+
+/** @brief Searches the remaining keys of the object the cursor has entered.
+@param[in] cur the cursor within an object.
+@param[in] key the key to find as written in the text, without quotes.
+@return true if the key is found leaving the cursor at its value, false if the
+end of the object was reached and consumed. Values of other keys are skipped. */
+SV_API bool SV_json_find_key(SV_Json_cursor *cur, SV_Str_view key);
+
+/**@}*/
+
+/** @name Key Value Parsing
+Split blocks of key value pairs into arrays of `SV_Str_view`. */
+/**@{*/
+
+/** @brief Splits the source into key value pairs in a single pass.
+@param[in] src the source of pairs to split.
+@param[in] kv_delim the character separating a key from its value.
+@param[in] pair_delim the character separating one pair from the next.
+@param[in] trim the characters to trim from both ends of every key and value.
+May be NULL to trim nothing.
+@param[in] cap the number of views available in the keys and values arrays.
+@param[out] keys the array to fill with the key of each pair.
+@param[out] values the array to fill with the value of each pair.
+@return the number of pairs in src, which may be greater than cap. Only the
+first cap pairs are written.
+
+Only the first kv_delim of a pair separates the key and value, so a value may
+contain kv_delim. A pair without kv_delim has an empty value positioned at the
+end of its key. A pair whose key and value are both empty after trimming is
+skipped, such as one between repeated pair_delim or a lone kv_delim. The
+source is classified 64 bytes at a time so each byte is visited once. For
+example, HTTP header lines and query strings may be split as follows.
+
+```
+SV_Charset const space = SV_charset(SV_from(" \t\r"));
+size_t n = SV_kv_parse(headers, ':', '\n', &space, 64, keys, values);
+size_t q = SV_kv_parse(query, '=', '&', NULL, 16, keys, values);
+``` */
+SV_API size_t SV_kv_parse(SV_Str_view src, char kv_delim, char pair_delim,
+                          SV_Charset const *trim, size_t cap,
+                          SV_Str_view *keys, SV_Str_view *values);
+
+/**@}*/
+
+/** @name Paths and URLs
+Decompose URLs and filesystem paths into component `SV_Str_view`. */
+/**@{*/
+
+/** @brief The components of a URL as views into the source.
+
+A component that is not present is an empty view positioned where it would have
+begun. Delimiters such as `://`, `?`, and `#` are not part of any component. */
+typedef struct {
+    /** The scheme before the first `:`, such as `https`. */
+    SV_Str_view scheme;
+    /** Everything between `//` and the path: userinfo, host, and port. */
+    SV_Str_view authority;
+    /** The userinfo of the authority before `@`. */
+    SV_Str_view userinfo;
+    /** The host of the authority. An IPv6 host keeps its brackets. */
+    SV_Str_view host;
+    /** The port of the authority after the final `:`. */
+    SV_Str_view port;
+    /** The path, beginning with `/` if the URL has an authority. */
+    SV_Str_view path;
+    /** The query after `?`. */
+    SV_Str_view query;
+    /** The fragment after `#`. */
+    SV_Str_view fragment;
+} SV_Url;
+
+/** @brief Splits a URL into its components in one forward scan.
+@param[in] url the URL or URI reference to split.
+@return the components of the URL. No component is validated or decoded.
+
+The generic syntax of RFC 3986 is followed, so a relative reference such as
+`/search?q=1` yields an empty scheme and authority. */
+SV_API SV_Url SV_url_parse(SV_Str_view url) SV_ATTRIB_PURE;
+
+/** @brief Obtain the directory portion of a path.
+@param[in] path a path using `/` as the separator.
+@return the view of path before its final component, not including the
+separator. Trailing separators do not begin a final component. The root of an
+absolute path is `/` and a path without a separator has an empty directory
+positioned at its start. */
+SV_API SV_Str_view SV_path_dirname(SV_Str_view path) SV_ATTRIB_PURE;
+
+/** @brief Obtain the final component of a path.
+@param[in] path a path using `/` as the separator.
+@return the view of the final component of path ignoring trailing separators.
+The root path yields an empty view. */
+SV_API SV_Str_view SV_path_basename(SV_Str_view path) SV_ATTRIB_PURE;
+
+/** @brief Obtain the extension of the final component of a path.
+@param[in] path a path using `/` as the separator.
+@return the view of the basename from its final `.`, including the dot. A
+basename with no dot, or whose only dot is its first character such as
+`.bashrc`, has an empty extension positioned at the end of the basename. */
+SV_API SV_Str_view SV_path_extension(SV_Str_view path) SV_ATTRIB_PURE;
+
+/** @brief Obtain the final component of a path without its extension.
+@param[in] path a path using `/` as the separator.
+@return the view of the basename up to but not including its extension. */
+SV_API SV_Str_view SV_path_stem(SV_Str_view path) SV_ATTRIB_PURE;
+
+/** @brief The state of iteration over the lexically normalized segments of a
+path. Avoid accessing struct fields. */
+typedef struct {
+    /** The path being iterated. */
+    SV_Str_view path;
+    /** The segment most recently returned. */
+    SV_Str_view segment;
+    /** The named segments before the current one not yet removed by `..`. */
+    size_t depth;
+    /** The number of `..` segments after the current position. */
+    size_t dotdots;
+} SV_Path_iter;
+
+/** @brief Begins iteration over the segments of a path as they would appear
+after lexical normalization.
+@param[in] it the iterator to initialize.
+@param[in] path a path using `/` as the separator.
+@return the first segment of the normalized path.
+
+Empty and `.` segments are skipped and each `..` removes the named segment
+before it, without allocating or copying. A `..` with nothing left to remove is
+returned for a relative path and skipped for an absolute path. No filesystem
+access occurs so symbolic links are not considered. For example, the segments
+of `/a/./b/../c//d` are `a`, `c`, and `d`.
+
+```
+SV_Path_iter it;
+for (SV_Str_view seg = SV_path_normal_begin(&it, path);
+     !SV_path_normal_end(&it);
+     seg = SV_path_normal_next(&it))
+{}
+```
+
+A named segment is decided by looking ahead only as far as the `..` segments
+remaining could remove it, so paths without `..` are iterated in linear time. */
+SV_API SV_Str_view SV_path_normal_begin(SV_Path_iter *it, SV_Str_view path);
+
+/** @brief Advances to the next segment of the normalized path.
+@param[in] it the iterator to advance.
+@return the next segment or an empty view at the end of the path when no
+segments remain. */
+SV_API SV_Str_view SV_path_normal_next(SV_Path_iter *it);
+
+/** @brief Provides the status of the normalized iteration.
+@param[in] it the iterator to check.
+@return true if no segments remain, false otherwise. */
+SV_API bool SV_path_normal_end(SV_Path_iter const *it) SV_ATTRIB_PURE;
+
+/**@}*/
+
+/** @name Templates
+Extract named fields from lines that follow a fixed template. */
+/**@{*/
+
+#ifndef SV_TEMPLATE_MAX_FIELDS
+/** @brief The most fields a template may contain. Define before including the
+header to change it, consistently across every translation unit. */
+#    define SV_TEMPLATE_MAX_FIELDS 16
+#endif
+
+/** @brief A compiled template of literal text and named fields.
+
+Construct it with SV_template_compile() and avoid accessing struct fields. The
+pattern from which it was compiled must outlive the template. */
+typedef struct {
+    /** The literal text before each field and after the final field. */
+    SV_Needle literals[SV_TEMPLATE_MAX_FIELDS + 1];
+    /** The name of each field. */
+    SV_Str_view names[SV_TEMPLATE_MAX_FIELDS];
+    /** The number of fields. */
+    size_t fields;
+} SV_Template;
+
+/** @brief Compiles a template pattern of literal text and `<name>` fields.
+@param[out] tmpl the template to compile into.
+@param[in] pattern the pattern such as `<ts> <level> [<module>] <msg>`.
+@return true if the pattern compiled, false if a field is not closed, two
+fields are not separated by literal text, or there are more than
+SV_TEMPLATE_MAX_FIELDS fields.
+
+Literal text may not contain `<`. Each literal that separates two fields is
+preprocessed once as a `SV_Needle`. */
+SV_API bool SV_template_compile(SV_Template *tmpl, SV_Str_view pattern);
+
+/** @brief Matches a line against a compiled template.
+@param[in] tmpl the compiled template.
+@param[in] line the line to match.
+@param[out] fields an array of at least SV_template_fields() views to fill.
+@return true if the line matches, false otherwise. On a mismatch the fields
+before the mismatch are filled.
+
+The line must begin with the literal text before the first field and end with
+the literal text after the last field. Every other field ends at the first
+occurrence of the literal text that follows it. The line is scanned once. */
+SV_API bool SV_template_match(SV_Template const *tmpl, SV_Str_view line,
+                              SV_Str_view *fields);
+
+/** @brief Obtain the number of fields in a template.
+@param[in] tmpl the compiled template.
+@return the number of fields. */
+SV_API size_t SV_template_fields(SV_Template const *tmpl) SV_ATTRIB_PURE;
+
+/** @brief Obtain the index of a named field in a template.
+@param[in] tmpl the compiled template.
+@param[in] name the name of the field without angle brackets.
+@return the index of the first field with the name or the number of fields if
+it is not found. */
+SV_API size_t SV_template_field(SV_Template const *tmpl,
+                                SV_Str_view name) SV_ATTRIB_PURE;
+
+/**@}*/
+
+/** @name UTF-8 Validation
+Confirm that views hold well formed UTF-8 before they are passed on. */
+/**@{*/
+
+/** @brief The state of a UTF-8 validation over a stream of chunks.
+
+Construct it with SV_utf8_stream() and avoid accessing struct fields. */
+typedef struct {
+    /** The bytes of the stream validated as complete sequences. */
+    size_t valid;
+    /** The bytes of a sequence split across chunks. */
+    unsigned char partial[3];
+    /** The number of bytes in partial. */
+    unsigned char partial_len;
+    /** True once an invalid sequence has been found. */
+    bool failed;
+} SV_Utf8_stream;
+
+/** @brief Checks that a view is well formed UTF-8.
+@param[in] sv the view to check.
+@return true if every byte of sv belongs to a complete and well formed UTF-8
+sequence, false otherwise.
+
+Overlong encodings, surrogates, code points above U+10FFFF, and truncated
+sequences are rejected. Vector instructions check 32 bytes at a time on x86-64
+processors with AVX2, or 16 on others when the library is built with SSSE3, and
+runs of ASCII are skipped quickly on every target. */
+SV_API bool SV_utf8_valid(SV_Str_view sv) SV_ATTRIB_PURE;
+
+/** @brief Checks that a view is well formed UTF-8 and finds the first error.
+@param[in] sv the view to check.
+@param[out] err_pos the length of the longest valid prefix of sv, which is the
+start of the first invalid or truncated sequence. May be NULL.
+@return true if sv is well formed UTF-8 and err_pos is sv length, false
+otherwise. */
+SV_API bool SV_utf8_valid_prefix(SV_Str_view sv, size_t *err_pos);
+
+/** @brief Constructs the state to validate a stream of chunks.
+@return a stream that has validated no bytes. */
+SV_API SV_Utf8_stream SV_utf8_stream(void) SV_ATTRIB_PURE;
+
+/** @brief Validates the next chunk of a stream.
+@param[in] stream the stream to advance.
+@param[in] chunk the next bytes of the stream.
+@return true if the stream is well formed UTF-8 so far, false once an invalid
+sequence has been found.
+
+Chunks may be split anywhere, including within a multibyte sequence. The bytes
+of the split sequence are copied into the stream so the chunk need not outlive
+the call. */
+SV_API bool SV_utf8_stream_feed(SV_Utf8_stream *stream, SV_Str_view chunk);
+
+/** @brief Finishes validation of a stream.
+@param[in] stream the stream to finish.
+@param[out] err_pos the offset in the stream of the first invalid or truncated
+sequence, or the length of the stream if it is valid. May be NULL.
+@return true if the stream is well formed UTF-8 and does not end within a
+sequence, false otherwise. */
+SV_API bool SV_utf8_stream_finish(SV_Utf8_stream const *stream,
+                                  size_t *err_pos);
+
+/**@}*/
+
+/** @name UTF-8 Code Points
+Count, locate, and iterate the code points of UTF-8 views. */
+/**@{*/
+
+/** @brief A sampled index of code point offsets in a view.
+
+Construct it with SV_utf8_index() and avoid accessing struct fields. The view
+and the offsets array must outlive the index. */
+typedef struct {
+    /** The indexed view. */
+    SV_Str_view sv;
+    /** The caller provided array of byte offsets of every stride code point. */
+    size_t const *offsets;
+    /** The number of offsets written. */
+    size_t samples;
+    /** The code points between samples. */
+    size_t stride;
+    /** The number of code points in the view. */
+    size_t count;
+} SV_Utf8_index;
+
+/** @brief Counts the code points of a view.
+@param[in] sv the UTF-8 view.
+@return the number of bytes that are not continuation bytes, which is the
+number of code points if sv is valid UTF-8.
+
+Continuation bytes are counted 64 at a time with vector instructions when
+available and a population count. */
+SV_API size_t SV_utf8_count(SV_Str_view sv) SV_ATTRIB_PURE;
+
+/** @brief Finds the byte offset of a code point.
+@param[in] sv the UTF-8 view.
+@param[in] k the index of the code point counting from zero.
+@return the byte offset of code point k or the length of sv if sv has k or
+fewer code points.
+
+For example, truncate a view to at most 10 code points:
+
+```
+SV_Str_view const cut = SV_substr(sv, 0, SV_utf8_offset(sv, 10));
+```
+
+The view is scanned from the start. Use SV_utf8_index() for repeated random
+access into long views. */
+SV_API size_t SV_utf8_offset(SV_Str_view sv, size_t k) SV_ATTRIB_PURE;
+
+/** @brief Builds a sampled index of code point offsets in one pass.
+@param[in] sv the UTF-8 view to index.
+@param[in] stride the code points between samples. Zero is treated as one.
+@param[in] cap the number of offsets available in the offsets array.
+@param[out] offsets the array in which to write the byte offset of every
+stride code point.
+@return the index over sv. If cap offsets are too few to sample all of sv,
+lookups beyond the final sample scan from it. */
+SV_API SV_Utf8_index SV_utf8_index(SV_Str_view sv, size_t stride, size_t cap,
+                                   size_t *offsets);
+
+/** @brief Finds the byte offset of a code point with a sampled index.
+@param[in] index the index of the view.
+@param[in] k the index of the code point counting from zero.
+@return the same offset as SV_utf8_offset() for the indexed view, scanning at
+most stride code points from the nearest sample. */
+SV_API size_t SV_utf8_index_offset(SV_Utf8_index const *index,
+                                   size_t k) SV_ATTRIB_PURE;
+
+/** @brief Obtain the first code point of a view.
+@param[in] sv the UTF-8 view.
+@return a view of the bytes of the first code point, which is empty if sv is
+empty.
+
+A code point is a byte followed by every continuation byte after it, so a view
+that is valid UTF-8 yields SV_utf8_count() code points. Iterate with
+SV_utf8_next() and SV_utf8_end():
+
+```
+for (SV_Str_view c = SV_utf8_begin(sv); !SV_utf8_end(sv, c);
+     c = SV_utf8_next(sv, c)) {
+    uint32_t const cp = SV_utf8_decode(c);
+}
+```
+*/
+SV_API SV_Str_view SV_utf8_begin(SV_Str_view sv) SV_ATTRIB_PURE;
+
+/** @brief Advances to the code point after cp.
+@param[in] sv the UTF-8 view being iterated.
+@param[in] cp the current code point.
+@return a view of the next code point, which is empty at the end of sv. */
+SV_API SV_Str_view SV_utf8_next(SV_Str_view sv, SV_Str_view cp) SV_ATTRIB_PURE;
+
+/** @brief Provides the status of a code point iteration.
+@param[in] sv the UTF-8 view being iterated.
+@param[in] cp the current code point.
+@return true if iteration is complete, false otherwise. */
+SV_API bool SV_utf8_end(SV_Str_view sv, SV_Str_view cp) SV_ATTRIB_PURE;
+
+/** @brief Decodes a code point view.
+@param[in] cp a view from SV_utf8_begin() or SV_utf8_next().
+@return the scalar value of the code point or U+FFFD if its bytes are not a
+well formed UTF-8 sequence. */
+SV_API uint32_t SV_utf8_decode(SV_Str_view cp) SV_ATTRIB_PURE;
+
+/**@}*/
+
+/** @name Hex and Base64 Decoding
+Decode encoded views directly into caller buffers. */
+/**@{*/
+
+/** @brief The alphabets of base64 encoding from RFC 4648. */
+typedef enum {
+    /** The standard alphabet ending in `+` and `/`. */
+    SV_BASE64_STANDARD,
+    /** The URL and filename safe alphabet ending in `-` and `_`. */
+    SV_BASE64_URL,
+} SV_Base64_alphabet;
+
+/** @brief Obtain the exact decoded size of a hex view.
+@param[in] src the hex digits.
+@return the number of bytes src decodes to if it is valid. */
+SV_API size_t SV_hex_decoded_len(SV_Str_view src) SV_ATTRIB_PURE;
+
+/** @brief Decodes pairs of hex digits into bytes.
+@param[in] src the hex digits, in either case, with no separators.
+@param[in] dest_bytes the bytes available in the destination.
+@param[out] dest_buf the destination of the decoded bytes.
+@param[out] err_pos the number of characters of src decoded, which is the
+length of src on success and otherwise the position of the first invalid digit,
+of an unpaired final digit, or of the first pair that did not fit in the
+destination. May be NULL.
+@return the number of bytes written. No null terminator is written.
+
+Digits are validated and combined 32 at a time on x86-64 processors with
+AVX2. */
+SV_API size_t SV_hex_decode(SV_Str_view src, size_t dest_bytes,
+                            unsigned char *dest_buf, size_t *err_pos);
+
+/** @brief Obtain the exact decoded size of a base64 view.
+@param[in] src the base64 text with or without padding.
+@return the number of bytes src decodes to if it is valid. */
+SV_API size_t SV_base64_decoded_len(SV_Str_view src) SV_ATTRIB_PURE;
+
+/** @brief Decodes base64 text into bytes.
+@param[in] src the base64 text with no whitespace. Padding with `=` is
+optional but if present must complete the final group of four.
+@param[in] alphabet the alphabet of src.
+@param[in] dest_bytes the bytes available in the destination.
+@param[out] dest_buf the destination of the decoded bytes.
+@param[out] err_pos the number of characters of src decoded, which is the
+length of src on success and otherwise the position of the first invalid
+character, of a final group too short to hold a byte, or of the first group
+that did not fit in the destination. May be NULL.
+@return the number of bytes written. No null terminator is written.
+
+Characters are validated and decoded 32 at a time on x86-64 processors with
+AVX2. */
+SV_API size_t SV_base64_decode(SV_Str_view src, SV_Base64_alphabet alphabet,
+                               size_t dest_bytes, unsigned char *dest_buf,
+                               size_t *err_pos);
+
+/**@}*/
+
+/** @name Statistics
+Count the paths searches and tokenizers take. Counting is compiled in only when
+the library is built with `SV_STATS` defined, which the `SV_STATS` CMake option
+does. Otherwise every counter stays zero at no cost to the searches. */
+/**@{*/
+
+/** @brief The paths a substring search can take. Needles of one to four bytes
+are compared directly and longer needles use the two-way algorithm, memoized
+when the needle is periodic. A library built with the `SV_USDT` CMake option
+also reports the path as the last argument of its `find_path` and
+`reverse_find_path` probes. */
+typedef enum {
+    /** A one byte needle. */
+    SV_STATS_PATH_BYTE,
+    /** A two byte needle. */
+    SV_STATS_PATH_TWO_BYTE,
+    /** A three byte needle. */
+    SV_STATS_PATH_THREE_BYTE,
+    /** A four byte needle. */
+    SV_STATS_PATH_FOUR_BYTE,
+    /** A two-way search for a needle without a periodic prefix. */
+    SV_STATS_PATH_TWO_WAY,
+    /** A two-way search for a periodic needle that remembers its matched
+    prefix. */
+    SV_STATS_PATH_TWO_WAY_MEMOIZED,
+    /** The number of paths. */
+    SV_STATS_PATHS,
+} SV_Stats_path;
+
+/** @brief The counters of one thread. */
+typedef struct {
+    /** Left to right searches by the path taken. */
+    uint64_t find_paths[SV_STATS_PATHS];
+    /** Right to left searches by the path taken. */
+    uint64_t reverse_find_paths[SV_STATS_PATHS];
+    /** Haystack bytes left to right searches covered: up to the end of the
+    match or the whole haystack if there was none. */
+    uint64_t find_bytes;
+    /** Haystack bytes right to left searches covered: from the start of the
+    match or the whole haystack if there was none. */
+    uint64_t reverse_find_bytes;
+    /** Calls to SV_token_begin and SV_token_reverse_begin. */
+    uint64_t token_loops;
+    /** Calls to SV_token_next and SV_token_reverse_next. Divided by
+    token_loops this is the tokens per loop. */
+    uint64_t token_steps;
+} SV_Stats;
+
+/** @brief Copy the counters of the calling thread.
+@param[out] stats the destination of the counters. Zeroed if counting is not
+compiled in.
+@return true if the library was built with `SV_STATS` and counts, false if
+every counter is always zero.
+
+Counters are thread local so counting never contends. Work done by other
+threads, such as those of a `SV_Pool`, is counted by those threads. */
+SV_API bool SV_stats_snapshot(SV_Stats *stats);
+
+/** @brief Zero the counters of the calling thread. */
+SV_API void SV_stats_reset(void);
+
 /**@}*/
 
 /** @name State
@@ -583,12 +1643,17 @@ Obtain current state of an `SV_Str_view` and C strings. */
 SV_API size_t SV_min_len(char const *str, size_t n)
     SV_ATTRIB_NULLTERM(1) SV_ATTRIB_PURE;
 
+/** @brief The storage of the sentinel returned by SV_null(). Use SV_null()
+rather than this. It is exported only so inline accessors agree with the
+library on the one sentinel address. */
+SV_API extern char const SV_null_str[1];
+
 /** @brief A sentinel empty string. Safely dereference to view a null
 terminator. This may be returned from various functions when bad input is given
 such as NULL pointers as the underlying SV_Str_view string pointer.
 @return a read only character pointer that points to a null terminator and can
 be safely dereferenced. */
-SV_API char const *SV_null(void) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_null(void) SV_ATTRIB_PURE;
 
 /** @brief The end of a SV_Str_view guaranteed to be greater than or equal to
 size.
@@ -598,7 +1663,7 @@ size.
 This value may be used for the idiomatic check for most string searching
 function return values when something is not found. If a size is returned from a
 searching function it is possible to check it against this value. */
-SV_API size_t SV_npos(SV_Str_view sv) SV_ATTRIB_CONST;
+SV_INLINE size_t SV_npos(SV_Str_view sv) SV_ATTRIB_CONST;
 
 /** @brief Returns true if the provided SV_Str_view is empty, false otherwise.
 @param[in] sv the string view to check.
@@ -606,7 +1671,7 @@ SV_API size_t SV_npos(SV_Str_view sv) SV_ATTRIB_CONST;
 
 This is a useful function to check for SV_Str_view searches that yield an empty
 view at the end of a SV_Str_view when an element cannot be found. */
-SV_API bool SV_is_empty(SV_Str_view sv) SV_ATTRIB_CONST;
+SV_INLINE bool SV_is_empty(SV_Str_view sv) SV_ATTRIB_CONST;
 
 /** @brief Returns the length of the SV_Str_view in O(1) time.
 @param[in] sv the string view to check.
@@ -614,7 +1679,7 @@ SV_API bool SV_is_empty(SV_Str_view sv) SV_ATTRIB_CONST;
 
 The position at SV_Str_view size is interpreted as the null terminator and not
 counted toward length of a SV_Str_view. */
-SV_API size_t SV_len(SV_Str_view sv) SV_ATTRIB_CONST;
+SV_INLINE size_t SV_len(SV_Str_view sv) SV_ATTRIB_CONST;
 
 /** Returns the bytes of SV_Str_view including null terminator.
 @param[in] sv the string view to check.
@@ -623,7 +1688,7 @@ character.
 @note String views may not actually be null terminated but the position at
 SV_Str_view[SV_Str_view.len] is interpreted as the null terminator and thus
 counts towards the byte count. */
-SV_API size_t SV_bytes(SV_Str_view sv) SV_ATTRIB_CONST;
+SV_INLINE size_t SV_bytes(SV_Str_view sv) SV_ATTRIB_CONST;
 
 /** @brief Returns the character pointer at the minimum between the indicated
 position and the end of the string view.
@@ -631,7 +1696,7 @@ position and the end of the string view.
 @param[in] i the index within range of `[0, string view length - 1)`.
 @return a pointer to the character at the designated index. If NULL is stored by
 the SV_Str_view then SV_null() is returned. */
-SV_API char const *SV_pointer(SV_Str_view sv, size_t i) SV_ATTRIB_PURE;
+SV_INLINE char const *SV_pointer(SV_Str_view sv, size_t i) SV_ATTRIB_PURE;
 
 /** @brief Obtain a character at a position in the string view.
 @param[in] sv the input string view.
@@ -639,20 +1704,197 @@ SV_API char const *SV_pointer(SV_Str_view sv, size_t i) SV_ATTRIB_PURE;
 @return the character in the string at position i with bounds checking. If i is
 greater than or equal to the size of SV_Str_view the null terminator character
 is returned. */
-SV_API char SV_at(SV_Str_view sv, size_t i) SV_ATTRIB_PURE;
+SV_INLINE char SV_at(SV_Str_view sv, size_t i) SV_ATTRIB_PURE;
 
 /** @brief Obtain the character at the first position of SV_Str_view.
 @param[in] sv the input string view.
 @return the first character in the string view. An empty SV_Str_view or NULL
 pointer is valid and will return '\0'. */
-SV_API char SV_front(SV_Str_view sv) SV_ATTRIB_PURE;
+SV_INLINE char SV_front(SV_Str_view sv) SV_ATTRIB_PURE;
 
 /** @brief Obtain the character at the last position of SV_Str_view.
 @param[in] sv the input string view.
 @return the last character in the string view. An empty SV_Str_view or NULL
 pointer is valid and will return '\0'. */
-SV_API char SV_back(SV_Str_view sv) SV_ATTRIB_PURE;
+SV_INLINE char SV_back(SV_Str_view sv) SV_ATTRIB_PURE;
 
 /**@}*/
 
+/* The trivial accessors declared with SV_INLINE. The library defines
+   SV_INLINE_DEFINITIONS to compile them out of line and a program that
+   defines SV_HEADER_ONLY compiles them inline. */
+#if defined(SV_HEADER_ONLY) || defined(SV_INLINE_DEFINITIONS)
+
+SV_INLINE SV_Str_view
+SV_substr(SV_Str_view const sv, size_t const pos, size_t const count) {
+    if (pos > sv.len) {
+        SV_Str_view const end = {
+            .str = sv.str + sv.len,
+            .len = 0,
+        };
+        return end;
+    }
+    SV_Str_view const sub = {
+        .str = sv.str + pos,
+        .len = count < sv.len - pos ? count : sv.len - pos,
+    };
+    return sub;
+}
+
+SV_INLINE SV_Str_view
+SV_remove_prefix(SV_Str_view const sv, size_t const n) {
+    size_t const remove = n < sv.len ? n : sv.len;
+    SV_Str_view const rest = {
+        .str = sv.str + remove,
+        .len = sv.len - remove,
+    };
+    return rest;
+}
+
+SV_INLINE SV_Str_view
+SV_remove_suffix(SV_Str_view const sv, size_t const n) {
+    if (!sv.str) {
+        SV_Str_view const empty = {
+            .str = SV_null_str,
+            .len = 0,
+        };
+        return empty;
+    }
+    SV_Str_view const rest = {
+        .str = sv.str,
+        .len = sv.len - (n < sv.len ? n : sv.len),
+    };
+    return rest;
+}
+
+SV_INLINE bool
+SV_token_end(SV_Str_view const src, SV_Str_view const token) {
+    return !token.len || token.str >= (src.str + src.len);
+}
+
+SV_INLINE bool
+SV_token_reverse_end(SV_Str_view const src, SV_Str_view const token) {
+    return !token.len && token.str == src.str;
+}
+
+SV_INLINE char const *
+SV_null(void) {
+    return SV_null_str;
+}
+
+SV_INLINE char const *
+SV_begin(SV_Str_view const sv) {
+    if (!sv.str) {
+        return SV_null_str;
+    }
+    return sv.str;
+}
+
+SV_INLINE char const *
+SV_end(SV_Str_view const sv) {
+    if (!sv.str || sv.str == SV_null_str) {
+        return SV_null_str;
+    }
+    return sv.str + sv.len;
+}
+
+SV_INLINE char const *
+SV_next(char const *c) {
+    if (!c) {
+        return SV_null_str;
+    }
+    return ++c;
+}
+
+SV_INLINE char const *
+SV_reverse_begin(SV_Str_view const sv) {
+    if (!sv.str) {
+        return SV_null_str;
+    }
+    if (!sv.len) {
+        return sv.str;
+    }
+    return sv.str + sv.len - 1;
+}
+
+SV_INLINE char const *
+SV_reverse_end(SV_Str_view const sv) {
+    if (!sv.str || sv.str == SV_null_str) {
+        return SV_null_str;
+    }
+    if (!sv.len) {
+        return sv.str;
+    }
+    return sv.str - 1;
+}
+
+SV_INLINE char const *
+SV_reverse_next(char const *c) {
+    if (!c) {
+        return SV_null_str;
+    }
+    return --c;
+}
+
+SV_INLINE char const *
+SV_pointer(SV_Str_view const sv, size_t const i) {
+    if (!sv.str) {
+        return SV_null_str;
+    }
+    if (i > sv.len) {
+        return SV_end(sv);
+    }
+    return sv.str + i;
+}
+
+SV_INLINE size_t
+SV_npos(SV_Str_view const sv) {
+    return sv.len;
+}
+
+SV_INLINE bool
+SV_is_empty(SV_Str_view const sv) {
+    return !sv.len;
+}
+
+SV_INLINE size_t
+SV_len(SV_Str_view const sv) {
+    return sv.len;
+}
+
+SV_INLINE size_t
+SV_bytes(SV_Str_view const sv) {
+    return sv.len + 1;
+}
+
+SV_INLINE char
+SV_at(SV_Str_view const sv, size_t const i) {
+    if (i >= sv.len) {
+        return '\0';
+    }
+    return sv.str[i];
+}
+
+SV_INLINE char
+SV_front(SV_Str_view const sv) {
+    if (!sv.str || !sv.len) {
+        return '\0';
+    }
+    return *sv.str;
+}
+
+SV_INLINE char
+SV_back(SV_Str_view const sv) {
+    if (!sv.str || !sv.len) {
+        return '\0';
+    }
+    return sv.str[sv.len - 1];
+}
+
+#endif /* SV_HEADER_ONLY || SV_INLINE_DEFINITIONS */
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* SV_STR_VIEW */
@@ -0,0 +1,174 @@
+/** @file
+@brief Compile Time Needles for C++
+
+C++ callers usually search for string literals, yet SV_needle() factorizes a
+needle at runtime and SV_find() does so before every search. A `sv::needle`
+is a type named by its literal. The Two-Way critical factorization of the
+literal is computed while compiling and stored in a constant `SV_Needle`, so
+searches do nothing but search.
+
+```
+using Get = sv::needle<"GET /api/">;
+size_t const pos = Get::find(request);
+```
+
+The factorization follows the one in str_view.c step for step and every
+search runs through SV_needle_find(), so results are always the same as
+SV_find(). Needles of four bytes or fewer need no factorization and take the
+library's short needle paths. This header requires C++20. */
+#ifndef SV_STR_VIEW_HPP
+#define SV_STR_VIEW_HPP
+
+/* MSVC reports the language version in _MSVC_LANG unless /Zc:__cplusplus is
+   given. */
+#if defined(_MSVC_LANG) && _MSVC_LANG > __cplusplus
+#    if _MSVC_LANG < 202002L
+#        error "str_view.hpp requires C++20"
+#    endif
+#elif __cplusplus < 202002L
+#    error "str_view.hpp requires C++20"
+#endif
+
+#include "str_view.h"
+
+#include <cstddef>
+
+namespace sv {
+
+/** @brief A string literal that may be a template argument.
+
+The length excludes the null terminator, as with SV_from(). */
+template <std::size_t N> struct literal {
+    /** The characters of the literal and its null terminator. */
+    char str[N]{};
+
+    /** @brief Copies a string literal. */
+    consteval literal(char const (&s)[N]) {
+        for (std::size_t i = 0; i < N; ++i) {
+            str[i] = s[i];
+        }
+    }
+
+    /** @brief The length of the literal without its null terminator. */
+    static constexpr std::size_t len = N - 1;
+};
+
+namespace detail {
+
+/* The critical position and period of one maximal suffix. */
+struct Factorization {
+    std::ptrdiff_t critical_position;
+    std::ptrdiff_t period_distance;
+};
+
+/* Computes the maximal suffix under the order of char, or under the reversed
+   order with reverse. This is maximal_suffix() and maximal_suffix_reverse() of
+   str_view.c, which compare plain char as well. */
+constexpr Factorization
+maximal_suffix(char const *const needle, std::ptrdiff_t const needle_size,
+               bool const reverse) {
+    std::ptrdiff_t suff_pos = -1;
+    std::ptrdiff_t period = 1;
+    std::ptrdiff_t last_rest = 0;
+    std::ptrdiff_t rest = 1;
+    while (last_rest + rest < needle_size) {
+        char const a = needle[last_rest + rest];
+        char const b = needle[suff_pos + rest];
+        if (a == b) {
+            if (rest != period) {
+                ++rest;
+            } else {
+                last_rest += period;
+                rest = 1;
+            }
+        } else if ((a < b) != reverse) {
+            last_rest += rest;
+            rest = 1;
+            period = last_rest - suff_pos;
+        } else {
+            suff_pos = last_rest;
+            last_rest = suff_pos + 1;
+            rest = period = 1;
+        }
+    }
+    return Factorization{suff_pos, period};
+}
+
+/* The same SV_Needle that SV_needle() returns for the needle. */
+constexpr SV_Needle
+factorize(char const *const needle, std::size_t const len) {
+    if (len <= 4) {
+        return SV_Needle{{needle, len}, 0, 0, false};
+    }
+    std::ptrdiff_t const size = static_cast<std::ptrdiff_t>(len);
+    Factorization const s = maximal_suffix(needle, size, false);
+    Factorization const r = maximal_suffix(needle, size, true);
+    Factorization const w
+        = (s.critical_position > r.critical_position) ? s : r;
+    bool memoized = true;
+    for (std::ptrdiff_t i = 0; i < w.critical_position + 1; ++i) {
+        memoized = memoized && needle[i] == needle[w.period_distance + i];
+    }
+    return SV_Needle{
+        {needle, len}, w.critical_position, w.period_distance, memoized};
+}
+
+} // namespace detail
+
+/** @brief A needle preprocessed at compile time.
+
+Every member is static and the type is never constructed. The literal lives
+in the template argument, so `value` stays valid for the whole program. */
+template <literal Lit> struct needle {
+    needle() = delete;
+
+    /** @brief The length of the needle. */
+    static constexpr std::size_t len = Lit.len;
+
+    /** @brief The needle factorized while compiling. Pass its address to any
+    function of str_view.h that takes a `SV_Needle const *`. */
+    static constexpr SV_Needle value = detail::factorize(Lit.str, Lit.len);
+
+    /** @brief The view of the needle string. */
+    static constexpr SV_Str_view
+    view() noexcept {
+        return value.str;
+    }
+
+    /** @brief Searches for the needle in haystack starting from pos.
+    @return the same as SV_find(haystack, pos, view()). */
+    static size_t
+    find(SV_Str_view const haystack, size_t const pos = 0) noexcept {
+        return SV_needle_find(haystack, pos, &value);
+    }
+
+    /** @brief Tests whether haystack holds the needle.
+    @return the same as SV_contains(haystack, view()). */
+    static bool
+    contains(SV_Str_view const haystack) noexcept {
+        if constexpr (len == 0) {
+            return !SV_is_empty(haystack);
+        } else {
+            return find(haystack) != haystack.len;
+        }
+    }
+
+    /** @brief Counts every occurrence of the needle in haystack.
+    @return the same as SV_count(haystack, view()). */
+    static size_t
+    count(SV_Str_view const haystack) noexcept {
+        return SV_needle_count(haystack, &value);
+    }
+
+    /** @brief Finds the position of every occurrence of the needle.
+    @return the same as SV_find_all(haystack, view(), cap, offsets). */
+    static size_t
+    find_all(SV_Str_view const haystack, size_t const cap,
+             size_t *const offsets) noexcept {
+        return SV_needle_find_all(haystack, &value, cap, offsets);
+    }
+};
+
+} // namespace sv
+
+#endif /* SV_STR_VIEW_HPP */
@@ -0,0 +1,406 @@
+/** @file
+@brief The Parallel `SV_Str_view` Interface
+
+Searches over very large views, such as a memory mapped file, and sorts of
+very many views may be split across threads. Each function here produces the
+result of its single threaded counterpart in `str_view.h`, so a caller may
+switch between them freely based on the size of the input.
+
+Work is handed to an `SV_Executor`. The library provides one, the `SV_Pool`, a
+fixed set of worker threads that balance work by stealing from one another. A
+program that already has a thread pool may instead wrap it in an `SV_Executor`
+so that string searches share its threads. Every parallel function accepts a
+NULL executor and then runs on the calling thread alone.
+
+The haystack is split into chunks that overlap by one byte less than the
+needle so that no occurrence spanning a chunk boundary is missed or counted
+twice. The needle is preprocessed once and shared by every thread. Results are
+recorded per chunk and merged in chunk order so they never depend on which
+thread ran which chunk, and a search for the first occurrence skips chunks
+beyond the best match found so far.
+
+This interface requires POSIX threads and is built when the `SV_PARALLEL`
+CMake option is on, which is the default. */
+#ifndef SV_STR_VIEW_PARALLEL
+#define SV_STR_VIEW_PARALLEL
+
+#include "str_view.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief A source of threads for the parallel interface.
+
+An executor is a run function, the context it receives, and the number of
+threads that run tasks, which is used to decide how finely to split work. A
+caller with its own thread pool fills one in to have searches run there. */
+typedef struct {
+    /** Runs task(arg, i) for every i in [0, tasks) and returns once all have
+        completed. Tasks may run in any order and on any thread. */
+    void (*run)(void *ctx, size_t tasks, void (*task)(void *arg, size_t i),
+                void *arg);
+    /** The context passed to run, such as the pool. */
+    void *ctx;
+    /** The threads that run tasks, including the caller if it helps. */
+    size_t threads;
+} SV_Executor;
+
+/** @brief A fixed set of worker threads with work-stealing deques.
+
+Each worker and the calling thread own a deque of index ranges. A thread
+splits its range in half, pushes the upper half for others to steal, and keeps
+going with the lower half until the range is small enough to run. An idle
+thread steals the oldest, and so largest, range from another deque. */
+typedef struct SV_Pool SV_Pool;
+
+/** @brief An insert only set of views shared by many threads.
+
+The set owns a copy of every distinct view inserted, so the views it returns
+stay valid until the set is destroyed even after the source text is freed. It
+is one open addressing table whose slots are claimed by compare and swap, so
+inserting threads never wait on a lock. The table is split into shards that
+spread unrelated inserts apart, and a probe that fills its shard continues
+into the next. A lookup is wait free: it probes at most every slot of the
+table and never retries. */
+typedef struct SV_Dedup_set SV_Dedup_set;
+
+/** @brief The memory one thread copies its new views into.
+
+Each inserting thread takes its own arena from the set so copies are made
+without synchronizing with other threads. An arena must only be used by one
+thread at a time and is freed with its set. */
+typedef struct SV_Dedup_arena SV_Dedup_arena;
+
+/** @brief A batch of views passed from one thread to another.
+
+The views point into memory the producer owns, such as a read buffer, so the
+batch carries the callback that hands that memory back. The consumer calls
+SV_view_batch_release() once it no longer needs the views and no bytes are
+ever copied between threads. */
+typedef struct {
+    /** The views of the batch. */
+    SV_Str_view const *views;
+    /** The number of views. */
+    size_t n;
+    /** Returns the memory of the batch to its owner, or NULL if none. */
+    void (*release)(void *ctx);
+    /** The argument passed to release. */
+    void *ctx;
+} SV_View_batch;
+
+/** @brief A bounded queue of view batches from one producer to one consumer.
+
+The producer and consumer each publish their position with one release store
+per call however many batches it moves, and each keeps a cached copy of the
+other's position on its own cache line so most calls read no shared line. */
+typedef struct SV_Spsc_queue SV_Spsc_queue;
+
+/** @brief A bounded queue of view batches among many producers and consumers.
+
+Every slot carries a sequence number that says whether it is ready to fill or
+to read on the current lap of the ring. A call claims a run of ready slots
+with one compare and swap on the shared position and then fills or reads
+them without further contention. */
+typedef struct SV_Mpmc_queue SV_Mpmc_queue;
+
+/** @name Thread Pool
+Create a pool and run parallel loops with it or with another executor. */
+/**@{*/
+
+/** @brief Creates a pool of threads.
+@param[in] threads the threads that run tasks, including the thread calling
+SV_pool_for(). Zero uses one thread per online processor.
+@return the pool or NULL if it could not be allocated. If fewer threads can be
+started than requested the pool runs with those that started.
+
+Workers sleep until a loop is submitted and do not spin between loops. */
+SV_API SV_Pool *SV_pool_create(size_t threads);
+
+/** @brief Stops and joins every worker and frees the pool.
+@param[in] pool the pool to destroy. NULL is ignored.
+
+No loop may be running on the pool. */
+SV_API void SV_pool_destroy(SV_Pool *pool);
+
+/** @brief Returns the threads that run tasks in the pool.
+@param[in] pool the pool.
+@return the started workers plus the calling thread, or 1 for NULL. */
+SV_API size_t SV_pool_threads(SV_Pool const *pool);
+
+/** @brief Runs task(arg, i) for every i in [0, tasks) on the pool.
+@param[in] pool the pool to run on. NULL runs every task on the caller.
+@param[in] tasks the number of tasks.
+@param[in] task the function to run for each index.
+@param[in] arg the argument passed to every task.
+
+The calling thread runs tasks too and returns once all have completed, after
+which every write made by a task is visible to it. Loops from different
+threads run one at a time. A task must not submit a loop to the same pool. */
+SV_API void SV_pool_for(SV_Pool *pool, size_t tasks,
+                        void (*task)(void *arg, size_t i), void *arg);
+
+/** @brief Returns an executor that runs loops on the pool.
+@param[in] pool the pool. NULL gives an executor for the caller alone.
+@return the executor, valid until the pool is destroyed. */
+SV_API SV_Executor SV_pool_executor(SV_Pool *pool);
+
+/** @brief Runs task(arg, i) for every i in [0, tasks) on an executor.
+@param[in] executor the executor. NULL runs every task on the caller.
+@param[in] tasks the number of tasks.
+@param[in] task the function to run for each index.
+@param[in] arg the argument passed to every task. */
+SV_API void SV_parallel_for(SV_Executor const *executor, size_t tasks,
+                            void (*task)(void *arg, size_t i), void *arg);
+
+/** @brief Returns the chunk size SV_parallel_for_range() uses.
+@param[in] executor the executor the loop will run on.
+@param[in] n the number of elements, such as bytes, to split.
+@param[in] min_chunk the fewest elements worth handing to a thread.
+@return the chunk size, at least min_chunk and at least 1.
+
+Each thread receives several chunks so one that finishes early can take more.
+A caller recording results per chunk uses this to size its storage: the chunk
+beginning at element begin has index begin / chunk. */
+SV_API size_t SV_parallel_chunk(SV_Executor const *executor, size_t n,
+                                size_t min_chunk);
+
+/** @brief Splits [0, n) into chunks and runs range(arg, begin, end) for each.
+@param[in] executor the executor. NULL runs every chunk on the caller.
+@param[in] n the number of elements, such as bytes, to split.
+@param[in] min_chunk the fewest elements worth handing to a thread.
+@param[in] range the function to run for each chunk [begin, end).
+@param[in] arg the argument passed to every chunk.
+
+Chunks are SV_parallel_chunk() elements long except perhaps the last. */
+SV_API void SV_parallel_for_range(SV_Executor const *executor, size_t n,
+                                  size_t min_chunk,
+                                  void (*range)(void *arg, size_t begin,
+                                                size_t end),
+                                  void *arg);
+
+/**@}*/
+
+/** @name Parallel Matching
+Search a `SV_Str_view` with many threads. */
+/**@{*/
+
+/** @brief Searches for the first occurrence of needle in haystack with many
+threads.
+@param[in] haystack the string view to search.
+@param[in] needle the substring to match within haystack.
+@param[in] executor the threads to use. NULL searches on the caller.
+@return the same position as `SV_find(haystack, 0, needle)`. */
+SV_API size_t SV_parallel_find(SV_Str_view haystack, SV_Str_view needle,
+                               SV_Executor const *executor);
+
+/** @brief Counts every occurrence of needle in haystack with many threads.
+@param[in] haystack the string view to search.
+@param[in] needle the substring to count.
+@param[in] executor the threads to use. NULL searches on the caller.
+@return the same count as SV_count(), including overlapping occurrences. */
+SV_API size_t SV_parallel_count(SV_Str_view haystack, SV_Str_view needle,
+                                SV_Executor const *executor);
+
+/** @brief Finds the position of every occurrence of needle in haystack with
+many threads.
+@param[in] haystack the string view to search.
+@param[in] needle the substring to find.
+@param[in] executor the threads to use. NULL searches on the caller.
+@param[in] cap the number of positions available in the offsets array.
+@param[out] offsets the array to fill with positions in ascending order.
+@return the same count as SV_find_all(), which may be greater than cap. Only
+the first cap positions are written. If memory for the results of each chunk
+cannot be allocated, SV_find_all() is used on the calling thread. */
+SV_API size_t SV_parallel_find_all(SV_Str_view haystack, SV_Str_view needle,
+                                   SV_Executor const *executor, size_t cap,
+                                   size_t *offsets);
+
+/** @brief Searches for one needle in each of many views with many threads.
+@param[in] views the array of views to search.
+@param[in] n the number of views.
+@param[in] needle the substring to match within each view.
+@param[in] executor the threads to use. NULL searches on the caller.
+@param[out] results the array of n positions to fill, the same as
+SV_find_batch().
+
+Each chunk is a consecutive run of views so each thread reads and writes
+contiguous memory. */
+SV_API void SV_parallel_find_batch(SV_Str_view const *views, size_t n,
+                                   SV_Str_view needle,
+                                   SV_Executor const *executor,
+                                   size_t *results);
+
+/**@}*/
+
+/** @name Parallel Line Indexing
+Index the lines of a `SV_Str_view` with many threads. */
+/**@{*/
+
+/** @brief Finds the offset at which every line of a view begins with many
+threads.
+@param[in] sv the view to index.
+@param[in] executor the threads to use. NULL indexes on the caller.
+@param[in] cap the number of offsets available in the offsets array.
+@param[out] offsets the array to fill with line starts in ascending order.
+@return the same count as SV_line_index(), which may be greater than cap.
+The first cap offsets are written and equal those of SV_line_index().
+
+Each chunk first counts its lines with SV_line_count(). A prefix sum of the
+counts gives the index of each chunk's first line, and each chunk then writes
+its offsets into its own part of the array. To size the array first, call
+SV_parallel_line_index() with a cap of 0. If memory for the counts cannot be
+allocated, SV_line_index() is used on the calling thread. */
+SV_API size_t SV_parallel_line_index(SV_Str_view sv,
+                                     SV_Executor const *executor, size_t cap,
+                                     size_t *offsets);
+
+/**@}*/
+
+/** @name View Queues
+Pass batches of `SV_Str_view` between threads without copying their bytes. */
+/**@{*/
+
+/** @brief Returns the memory of a batch to its owner.
+@param[in] batch the batch the caller is finished with. NULL and batches
+without a release callback are ignored. */
+SV_API void SV_view_batch_release(SV_View_batch const *batch);
+
+/** @brief Creates an empty single producer single consumer queue.
+@param[in] capacity the most batches the queue holds, rounded up to a power of
+two.
+@return the queue or NULL if it could not be allocated. */
+SV_API SV_Spsc_queue *SV_spsc_create(size_t capacity);
+
+/** @brief Releases every batch still queued and frees the queue.
+@param[in] queue the queue to destroy. NULL is ignored.
+
+Neither the producer nor the consumer may be using the queue. */
+SV_API void SV_spsc_destroy(SV_Spsc_queue *queue);
+
+/** @brief Appends batches to the queue from the producer thread.
+@param[in] queue the queue.
+@param[in] batches the batches to append in order.
+@param[in] n the number of batches.
+@return the number appended from the front of batches, less than n only if
+the queue filled. The queue owns the appended batches. */
+SV_API size_t SV_spsc_push(SV_Spsc_queue *queue, SV_View_batch const *batches,
+                           size_t n);
+
+/** @brief Removes batches from the queue on the consumer thread.
+@param[in] queue the queue.
+@param[out] batches the array to fill with the oldest batches in order.
+@param[in] cap the number of batches available in the array.
+@return the number removed, 0 if the queue is empty. The caller owns the
+removed batches and releases each with SV_view_batch_release(). */
+SV_API size_t SV_spsc_pop(SV_Spsc_queue *queue, SV_View_batch *batches,
+                          size_t cap);
+
+/** @brief Creates an empty multiple producer multiple consumer queue.
+@param[in] capacity the most batches the queue holds, rounded up to a power of
+two.
+@return the queue or NULL if it could not be allocated. */
+SV_API SV_Mpmc_queue *SV_mpmc_create(size_t capacity);
+
+/** @brief Releases every batch still queued and frees the queue.
+@param[in] queue the queue to destroy. NULL is ignored.
+
+No thread may be using the queue. */
+SV_API void SV_mpmc_destroy(SV_Mpmc_queue *queue);
+
+/** @brief Appends batches to the queue from any thread.
+@param[in] queue the queue.
+@param[in] batches the batches to append in order.
+@param[in] n the number of batches.
+@return the number appended from the front of batches, less than n only if
+the queue filled. The batches of one call are consecutive in the queue. */
+SV_API size_t SV_mpmc_push(SV_Mpmc_queue *queue, SV_View_batch const *batches,
+                           size_t n);
+
+/** @brief Removes batches from the queue on any thread.
+@param[in] queue the queue.
+@param[out] batches the array to fill with the oldest batches in order.
+@param[in] cap the number of batches available in the array.
+@return the number removed, 0 if the queue is empty. The caller owns the
+removed batches and releases each with SV_view_batch_release(). */
+SV_API size_t SV_mpmc_pop(SV_Mpmc_queue *queue, SV_View_batch *batches,
+                          size_t cap);
+
+/**@}*/
+
+/** @name Concurrent Deduplication
+Share one set of distinct views among many threads. */
+/**@{*/
+
+/** @brief Creates an empty deduplication set.
+@param[in] capacity the most distinct views the set must hold. Its tables are
+sized once for this many and do not grow.
+@return the set or NULL if it could not be allocated. */
+SV_API SV_Dedup_set *SV_dedup_create(size_t capacity);
+
+/** @brief Frees the set, its arenas, and every copy they hold.
+@param[in] set the set to destroy. NULL is ignored.
+
+No thread may be using the set or any view it returned. */
+SV_API void SV_dedup_destroy(SV_Dedup_set *set);
+
+/** @brief Creates an arena for one inserting thread.
+@param[in] set the set the arena copies views for.
+@return the arena or NULL if it could not be allocated. */
+SV_API SV_Dedup_arena *SV_dedup_arena(SV_Dedup_set *set);
+
+/** @brief Inserts a view if no equal view is in the set.
+@param[in] arena the calling thread's arena of the set.
+@param[in] sv the view to insert.
+@return the set's copy of the view, either the one already present or a new
+one copied into arena. A view with a NULL pointer is returned if sv has one,
+if memory for the copy could not be allocated, or if the set already holds
+more distinct views than the capacity it was created with and has no room
+left.
+
+The returned copy is null terminated. Two threads inserting equal views at
+once both receive the same copy. */
+SV_API SV_Str_view SV_dedup_insert(SV_Dedup_arena *arena, SV_Str_view sv);
+
+/** @brief Finds the set's copy of a view without inserting it.
+@param[in] set the set to search.
+@param[in] sv the view to find.
+@return the set's copy or a view with a NULL pointer if there is none. */
+SV_API SV_Str_view SV_dedup_find(SV_Dedup_set const *set, SV_Str_view sv);
+
+/** @brief Returns the number of distinct views in the set.
+@param[in] set the set.
+@return the count, which may already be stale if other threads insert. */
+SV_API size_t SV_dedup_size(SV_Dedup_set const *set);
+
+/**@}*/
+
+/** @name Parallel Sorting
+Sort an array of `SV_Str_view` with many threads. */
+/**@{*/
+
+/** @brief Sorts an array of views in place in the order of SV_compare() with
+many threads.
+@param[in] views the array of views to sort.
+@param[in] n the number of views.
+@param[in] executor the threads to use. NULL sorts on the caller.
+
+The views are split by MSD radix passes, one byte at a time, until every
+bucket is small enough to hand to one thread, and each bucket is then finished
+with SV_sort_from(). A radix pass computes its keys and histograms in parallel
+and permutes the views in place. The order matches SV_sort() except that equal
+views with different pointers may be arranged differently. Scratch of two
+bytes per view is allocated and if it cannot be, SV_sort() is used on the
+calling thread. */
+SV_API void SV_parallel_sort(SV_Str_view *views, size_t n,
+                             SV_Executor const *executor);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SV_STR_VIEW_PARALLEL */
@@ -0,0 +1,54 @@
+/* This file runs every test program in a directory and reports which ones
+   failed. A test program passes when it exits with status zero.
+
+   Usage: run_tests DIRECTORY */
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int
+main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s DIRECTORY\n", argv[0]);
+        return 2;
+    }
+    DIR *const dir = opendir(argv[1]);
+    if (!dir) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 2;
+    }
+    size_t passed = 0;
+    size_t failed = 0;
+    char path[4096];
+    for (struct dirent const *e = readdir(dir); e; e = readdir(dir)) {
+        struct stat st;
+        int const len
+            = snprintf(path, sizeof(path), "%s/%s", argv[1], e->d_name);
+        if (len < 0 || (size_t)len >= sizeof(path) || stat(path, &st)
+            || !S_ISREG(st.st_mode) || access(path, X_OK)) {
+            continue;
+        }
+        pid_t const pid = fork();
+        if (pid == 0) {
+            execl(path, path, (char *)NULL);
+            _exit(127);
+        }
+        int status = 1;
+        bool const pass = pid > 0 && waitpid(pid, &status, 0) == pid
+                       && WIFEXITED(status) && !WEXITSTATUS(status);
+        printf("%s %s\n", pass ? "PASS" : "FAIL", e->d_name);
+        if (pass) {
+            ++passed;
+        } else {
+            ++failed;
+        }
+    }
+    closedir(dir);
+    printf("%zu passed, %zu failed\n", passed, failed);
+    return failed != 0;
+}
@@ -0,0 +1,38 @@
+/* This file holds the checks shared by every test program. A test is a
+   function returning a Test_result. A test program runs its tests with
+   run_tests(), which prints each failure and makes the program exit with a
+   nonzero status if any test failed. */
+#ifndef SV_TEST_H
+#define SV_TEST_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+enum Test_result {
+    TEST_PASS = 0,
+    TEST_FAIL,
+};
+
+typedef enum Test_result (*Test_fn)(void);
+
+/* Fails the calling test with the location and text of the check. */
+#define CHECK(expr)                                                            \
+    do {                                                                       \
+        if (!(expr)) {                                                         \
+            fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", __FILE__,         \
+                    __LINE__, __func__, #expr);                                \
+            return TEST_FAIL;                                                  \
+        }                                                                      \
+    } while (0)
+
+/* Runs every test and returns the exit status of the test program. */
+static inline int
+run_tests(Test_fn const *const tests, size_t const n) {
+    size_t failed = 0;
+    for (size_t i = 0; i < n; ++i) {
+        failed += tests[i]() != TEST_PASS;
+    }
+    return failed != 0;
+}
+
+#endif /* SV_TEST_H */
@@ -0,0 +1,109 @@
+/* This file tests the CSV reader. The reader classifies its source 64 bytes
+   at a time, so quotes, delimiters, and newlines are also placed on both
+   sides of a block boundary. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/* The most fields of one record the tests read. */
+#define MAX_FIELDS 8
+
+/* Reads the next record and checks it has exactly the expected fields. */
+static enum Test_result
+expect_record(SV_Csv_reader *const r, size_t const n,
+              char const *const *const expected) {
+    SV_Csv_field fields[MAX_FIELDS];
+    CHECK(SV_csv_next(r, MAX_FIELDS, fields) == n);
+    for (size_t i = 0; i < n; ++i) {
+        CHECK(SV_compare(fields[i].view, SV_from_terminated(expected[i]))
+              == SV_ORDER_EQUAL);
+    }
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_csv_quoted_separators(void) {
+    SV_Csv_reader r
+        = SV_csv_reader(SV_from("a,\"b,c\",d\n\"x\ny\",z\n"), ',', '"');
+    CHECK(expect_record(&r, 3, (char const *[]){"a", "b,c", "d"})
+          == TEST_PASS);
+    CHECK(expect_record(&r, 2, (char const *[]){"x\ny", "z"}) == TEST_PASS);
+    SV_Csv_field f;
+    CHECK(SV_csv_next(&r, 1, &f) == 0);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_csv_escaped_quotes(void) {
+    SV_Csv_reader r
+        = SV_csv_reader(SV_from("\"say \"\"hi\"\"\",2,\"\"\"\""), ',', '"');
+    SV_Csv_field fields[MAX_FIELDS];
+    CHECK(SV_csv_next(&r, MAX_FIELDS, fields) == 3);
+    CHECK(fields[0].needs_unescape);
+    CHECK(!fields[1].needs_unescape);
+    CHECK(fields[2].needs_unescape);
+    char buf[32];
+    CHECK(SV_csv_unescape(fields[0], '"', sizeof(buf), buf)
+          == sizeof("say \"hi\""));
+    CHECK(!strcmp(buf, "say \"hi\""));
+    CHECK(SV_csv_unescape(fields[2], '"', sizeof(buf), buf) == 2);
+    CHECK(!strcmp(buf, "\""));
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_csv_crlf(void) {
+    SV_Csv_reader r = SV_csv_reader(SV_from("a,b\r\nc,\"d\"\r\n\r\ne"), ',',
+                                    '"');
+    CHECK(expect_record(&r, 2, (char const *[]){"a", "b"}) == TEST_PASS);
+    CHECK(expect_record(&r, 2, (char const *[]){"c", "d"}) == TEST_PASS);
+    CHECK(expect_record(&r, 1, (char const *[]){""}) == TEST_PASS);
+    CHECK(expect_record(&r, 1, (char const *[]){"e"}) == TEST_PASS);
+    SV_Csv_field f;
+    CHECK(SV_csv_next(&r, 1, &f) == 0);
+    return TEST_PASS;
+}
+
+/* Moves a quoted field holding a delimiter and a newline across the first
+   block boundary one byte at a time, and spans one over several blocks. */
+static enum Test_result
+test_csv_quote_across_blocks(void) {
+    char src[256];
+    for (size_t start = 50; start < 70; ++start) {
+        memset(src, 'p', start);
+        src[start - 1] = ',';
+        char const quoted[] = "\"q,r\ns\",t\nu";
+        memcpy(src + start, quoted, sizeof(quoted));
+        SV_Csv_reader r = SV_csv_reader(SV_from_terminated(src), ',', '"');
+        SV_Csv_field fields[MAX_FIELDS];
+        CHECK(SV_csv_next(&r, MAX_FIELDS, fields) == 3);
+        CHECK(fields[0].view.len == start - 1);
+        CHECK(SV_compare(fields[1].view, SV_from("q,r\ns")) == SV_ORDER_EQUAL);
+        CHECK(SV_compare(fields[2].view, SV_from("t")) == SV_ORDER_EQUAL);
+        CHECK(expect_record(&r, 1, (char const *[]){"u"}) == TEST_PASS);
+    }
+    src[0] = '"';
+    for (size_t i = 1; i < 200; ++i) {
+        src[i] = i % 10 ? 'v' : (i % 20 ? ',' : '\n');
+    }
+    memcpy(src + 200, "\",w", sizeof("\",w"));
+    SV_Csv_reader r = SV_csv_reader(SV_from_terminated(src), ',', '"');
+    SV_Csv_field fields[MAX_FIELDS];
+    CHECK(SV_csv_next(&r, MAX_FIELDS, fields) == 2);
+    CHECK(fields[0].view.str == src + 1 && fields[0].view.len == 199);
+    CHECK(SV_compare(fields[1].view, SV_from("w")) == SV_ORDER_EQUAL);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_csv_quoted_separators,
+        test_csv_escaped_quotes,
+        test_csv_crlf,
+        test_csv_quote_across_blocks,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
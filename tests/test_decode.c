@@ -0,0 +1,137 @@
+/* This file tests the hex and base64 decoders. The vector kernels decode 32
+   characters at a time and only run on inputs at least that long, so decoding
+   an input whole and decoding it in pieces shorter than a vector must agree
+   on every byte and error position. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_CHARS 2048
+#define ROUNDS 2000
+
+/* Whole groups of input per piece, too short for the vector kernels. */
+#define HEX_PIECE 30
+#define BASE64_PIECE 28
+
+static char const hex_digits[] = "0123456789abcdefABCDEF";
+static char const base64_chars[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static char const base64_url_chars[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static uint64_t
+next_random(uint64_t *const seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+/* Fills len characters from the alphabet and, one time in four, replaces one
+   with a character outside it. */
+static void
+fill(char *const buf, size_t const len, char const *const alphabet,
+     uint64_t *const seed) {
+    size_t const n = strlen(alphabet);
+    for (size_t i = 0; i < len; ++i) {
+        buf[i] = alphabet[next_random(seed) % n];
+    }
+    if (len && next_random(seed) % 4 == 0) {
+        buf[next_random(seed) % len] = '*';
+    }
+}
+
+static size_t
+hex_in_pieces(SV_Str_view const src, unsigned char *const dest,
+              size_t *const err_pos) {
+    size_t written = 0;
+    for (size_t i = 0;; i += HEX_PIECE) {
+        size_t const len = src.len - i < HEX_PIECE ? src.len - i : HEX_PIECE;
+        size_t err = 0;
+        written += SV_hex_decode((SV_Str_view){src.str + i, len}, MAX_CHARS,
+                                 dest + written, &err);
+        if (err < len || i + len == src.len) {
+            *err_pos = i + err;
+            return written;
+        }
+    }
+}
+
+static size_t
+base64_in_pieces(SV_Str_view const src, SV_Base64_alphabet const alphabet,
+                 unsigned char *const dest, size_t *const err_pos) {
+    size_t written = 0;
+    for (size_t i = 0;; i += BASE64_PIECE) {
+        size_t const len
+            = src.len - i < BASE64_PIECE ? src.len - i : BASE64_PIECE;
+        size_t err = 0;
+        written += SV_base64_decode((SV_Str_view){src.str + i, len}, alphabet,
+                                    MAX_CHARS, dest + written, &err);
+        if (err < len || i + len == src.len) {
+            *err_pos = i + err;
+            return written;
+        }
+    }
+}
+
+static enum Test_result
+test_hex_vector_matches_scalar(void) {
+    static char src[MAX_CHARS];
+    static unsigned char whole[MAX_CHARS];
+    static unsigned char pieces[MAX_CHARS];
+    uint64_t seed = 0x5EED;
+    for (int r = 0; r < ROUNDS; ++r) {
+        size_t const len = next_random(&seed) % MAX_CHARS;
+        fill(src, len, hex_digits, &seed);
+        SV_Str_view const view = {src, len};
+        size_t whole_err = 0;
+        size_t pieces_err = 0;
+        size_t const whole_len
+            = SV_hex_decode(view, MAX_CHARS, whole, &whole_err);
+        size_t const pieces_len = hex_in_pieces(view, pieces, &pieces_err);
+        CHECK(whole_len == pieces_len);
+        CHECK(whole_err == pieces_err);
+        CHECK(!memcmp(whole, pieces, whole_len));
+    }
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_base64_vector_matches_scalar(void) {
+    static char src[MAX_CHARS];
+    static unsigned char whole[MAX_CHARS];
+    static unsigned char pieces[MAX_CHARS];
+    uint64_t seed = 0xB64;
+    for (int r = 0; r < ROUNDS; ++r) {
+        SV_Base64_alphabet const alphabet
+            = r % 2 ? SV_BASE64_URL : SV_BASE64_STANDARD;
+        size_t const len = (next_random(&seed) % (MAX_CHARS / 4)) * 4;
+        fill(src, len, r % 2 ? base64_url_chars : base64_chars, &seed);
+        /* Padding completes a final group of two or three characters. */
+        size_t const pad = len ? next_random(&seed) % 3 : 0;
+        memset(src + len - pad, '=', pad);
+        SV_Str_view const view = {src, len};
+        size_t whole_err = 0;
+        size_t pieces_err = 0;
+        size_t const whole_len
+            = SV_base64_decode(view, alphabet, MAX_CHARS, whole, &whole_err);
+        size_t const pieces_len
+            = base64_in_pieces(view, alphabet, pieces, &pieces_err);
+        CHECK(whole_len == pieces_len);
+        CHECK(whole_err == pieces_err);
+        CHECK(!memcmp(whole, pieces, whole_len));
+    }
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_hex_vector_matches_scalar,
+        test_base64_vector_matches_scalar,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,159 @@
+/* This file tests the concurrent deduplication set. */
+#include "str_view.h"
+#include "str_view_parallel.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The longest key fill() writes. */
+#define KEY_CAP 32
+
+/* The distinct keys and inserting tasks of the concurrent test. */
+#define SHARED_KEYS 4096
+#define INSERTERS 8
+#define THREADS 4
+
+/* Inserts n distinct keys that differ by the seed from one call to the next,
+   so each capacity is tried against several spreads of the hash. */
+static enum Test_result
+fill(SV_Dedup_arena *const arena, size_t const n, unsigned const seed) {
+    char key[KEY_CAP];
+    for (size_t i = 0; i < n; ++i) {
+        int const len = snprintf(key, sizeof(key), "%u:%zu", seed, i);
+        SV_Str_view const sv = {key, (size_t)len};
+        SV_Str_view const copy = SV_dedup_insert(arena, sv);
+        CHECK(copy.str != NULL);
+        CHECK(SV_compare(copy, sv) == SV_ORDER_EQUAL);
+    }
+    return TEST_PASS;
+}
+
+/* The shards of a set are much smaller than its capacity, so a set filled to
+   capacity overflows some of them whatever the hash. Every insert must still
+   succeed and be found again. */
+static enum Test_result
+test_dedup_fills_to_capacity(void) {
+    static size_t const extra[] = {1000, 1024, 4096, 10000};
+    size_t const small = 600;
+    for (size_t c = 1; c < small + (sizeof(extra) / sizeof(extra[0])); ++c) {
+        size_t const capacity = c < small ? c : extra[c - small];
+        for (unsigned seed = 0; seed < 4; ++seed) {
+            SV_Dedup_set *const set = SV_dedup_create(capacity);
+            CHECK(set != NULL);
+            SV_Dedup_arena *const arena = SV_dedup_arena(set);
+            CHECK(arena != NULL);
+            enum Test_result const res = fill(arena, capacity, seed);
+            size_t const size = SV_dedup_size(set);
+            SV_dedup_destroy(set);
+            CHECK(res == TEST_PASS);
+            CHECK(size == capacity);
+        }
+    }
+    return TEST_PASS;
+}
+
+/* A full set still finds every key, and inserting a repeat returns the copy
+   made the first time. */
+static enum Test_result
+test_dedup_repeats_and_find(void) {
+    size_t const capacity = 300;
+    SV_Dedup_set *const set = SV_dedup_create(capacity);
+    CHECK(set != NULL);
+    SV_Dedup_arena *const arena = SV_dedup_arena(set);
+    CHECK(arena != NULL);
+    CHECK(fill(arena, capacity, 7) == TEST_PASS);
+    CHECK(fill(arena, capacity, 7) == TEST_PASS);
+    CHECK(SV_dedup_size(set) == capacity);
+    char key[KEY_CAP];
+    for (size_t i = 0; i < capacity; ++i) {
+        int const len = snprintf(key, sizeof(key), "7:%zu", i);
+        SV_Str_view const sv = {key, (size_t)len};
+        SV_Str_view const found = SV_dedup_find(set, sv);
+        CHECK(found.str != NULL && found.str != key);
+        CHECK(SV_dedup_insert(arena, sv).str == found.str);
+    }
+    CHECK(SV_dedup_find(set, SV_from("missing")).str == NULL);
+    SV_dedup_destroy(set);
+    return TEST_PASS;
+}
+
+/* Each task inserts three quarters of the keys starting at its own offset,
+   so every key is inserted by several tasks at once, and records the copy
+   it received for each. */
+struct Concurrent {
+    SV_Dedup_arena *arenas[INSERTERS];
+    SV_Str_view copies[INSERTERS][SHARED_KEYS];
+    bool failed;
+};
+
+static void
+insert_task(void *const arg, size_t const t) {
+    struct Concurrent *const c = arg;
+    char key[KEY_CAP];
+    for (size_t i = 0; i < SHARED_KEYS * 3 / 4; ++i) {
+        size_t const k = (i + (t * SHARED_KEYS / INSERTERS)) % SHARED_KEYS;
+        int const len = snprintf(key, sizeof(key), "key %zu", k);
+        c->copies[t][k] = SV_dedup_insert(c->arenas[t], (SV_Str_view){
+                                                            key, (size_t)len});
+        if (!c->copies[t][k].str) {
+            c->failed = true;
+        }
+    }
+}
+
+/* Every task that inserted a key received the same copy, so exactly one
+   insert made it, and the set holds each key once. */
+static enum Test_result
+test_dedup_concurrent_inserts(void) {
+    struct Concurrent *const c = malloc(sizeof(*c));
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(c != NULL && pool != NULL);
+    for (size_t round = 0; round < 20; ++round) {
+        SV_Dedup_set *const set = SV_dedup_create(SHARED_KEYS);
+        CHECK(set != NULL);
+        c->failed = false;
+        for (size_t t = 0; t < INSERTERS; ++t) {
+            c->arenas[t] = SV_dedup_arena(set);
+            CHECK(c->arenas[t] != NULL);
+            for (size_t k = 0; k < SHARED_KEYS; ++k) {
+                c->copies[t][k] = (SV_Str_view){0};
+            }
+        }
+        SV_pool_for(pool, INSERTERS, insert_task, c);
+        CHECK(!c->failed);
+        char key[KEY_CAP];
+        for (size_t k = 0; k < SHARED_KEYS; ++k) {
+            SV_Str_view copy = {0};
+            for (size_t t = 0; t < INSERTERS; ++t) {
+                SV_Str_view const got = c->copies[t][k];
+                if (got.str && !copy.str) {
+                    copy = got;
+                }
+                CHECK(!got.str || (got.str == copy.str && got.len == copy.len));
+            }
+            int const len = snprintf(key, sizeof(key), "key %zu", k);
+            SV_Str_view const sv = {key, (size_t)len};
+            CHECK(copy.str != NULL);
+            CHECK(SV_compare(copy, sv) == SV_ORDER_EQUAL);
+            CHECK(SV_dedup_find(set, sv).str == copy.str);
+        }
+        CHECK(SV_dedup_size(set) == SHARED_KEYS);
+        SV_dedup_destroy(set);
+    }
+    SV_pool_destroy(pool);
+    free(c);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_dedup_fills_to_capacity,
+        test_dedup_repeats_and_find,
+        test_dedup_concurrent_inserts,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
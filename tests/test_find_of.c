@@ -0,0 +1,45 @@
+/* This file tests the character set searches. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+
+/* A set of two or more characters is searched through the table path. The
+   bytes after the view hold a set character that must not be seen. */
+static enum Test_result
+test_find_first_of_stays_in_view(void) {
+    char const buf[] = "abcdefX";
+    SV_Str_view const view = {buf, 4};
+    CHECK(SV_find_first_of(view, SV_from("XY")) == view.len);
+    CHECK(SV_find_first_of(view, SV_from("dX")) == 3);
+    CHECK(SV_find_first_of(SV_from("abc"), SV_from("cb")) == 1);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_find_last_of(void) {
+    CHECK(SV_find_last_of(SV_from("xx"), SV_from("x")) == 1);
+    CHECK(SV_find_last_of(SV_from("abcabc"), SV_from("a")) == 3);
+    CHECK(SV_find_last_of(SV_from("abcabc"), SV_from("ab")) == 4);
+    CHECK(SV_find_last_of(SV_from("abc"), SV_from("xy")) == 3);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_find_last_not_of(void) {
+    CHECK(SV_find_last_not_of(SV_from("xab"), SV_from("x")) == 2);
+    CHECK(SV_find_last_not_of(SV_from("abccc"), SV_from("c")) == 1);
+    CHECK(SV_find_last_not_of(SV_from("abcab"), SV_from("ab")) == 2);
+    CHECK(SV_find_last_not_of(SV_from("aaa"), SV_from("a")) == 3);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_find_first_of_stays_in_view,
+        test_find_last_of,
+        test_find_last_not_of,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
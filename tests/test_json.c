@@ -0,0 +1,108 @@
+/* This file tests the JSON structural index and the cursor that reads it.
+   The index classifies 64 bytes at a time, so escaped quotes and runs of
+   backslashes are also placed on both sides of a block boundary. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/* The most structural positions of one text the tests index. */
+#define MAX_INDEX 64
+
+static enum Test_result
+test_json_index(void) {
+    SV_Str_view const src = SV_from("{\"a\":[1,true,null],\"b\":\"x\"}");
+    static size_t const expected[] = {
+        0, 1, 4, 5, 6, 7, 8, 12, 13, 17, 18, 19, 22, 23, 26,
+    };
+    size_t const n = sizeof(expected) / sizeof(expected[0]);
+    size_t index[MAX_INDEX];
+    CHECK(SV_json_index(src, MAX_INDEX, index) == n);
+    CHECK(!memcmp(index, expected, sizeof(expected)));
+    CHECK(SV_json_index(src, 3, index) == n);
+    SV_Json_cursor cur = SV_json_cursor(src, n, index);
+    CHECK(SV_json_type(&cur) == SV_JSON_OBJECT);
+    CHECK(SV_json_enter(&cur));
+    CHECK(SV_json_find_key(&cur, SV_from("b")));
+    CHECK(SV_compare(SV_json_value(&cur), SV_from("x")) == SV_ORDER_EQUAL);
+    return TEST_PASS;
+}
+
+/* Slides a string holding an escaped quote and an escaped backslash across
+   the first block boundary. Either misread would end the string early or
+   late and lose the key after it. */
+static enum Test_result
+test_json_escapes_across_blocks(void) {
+    char src[160];
+    for (size_t pad = 40; pad < 80; ++pad) {
+        size_t len = 0;
+        memcpy(src, "{\"k\":\"", 6);
+        len = 6;
+        memset(src + len, 'p', pad);
+        len += pad;
+        char const tail[] = "\\\"q\\\\\",\"z\":[\"]\"]}";
+        memcpy(src + len, tail, sizeof(tail));
+        SV_Str_view const text = SV_from_terminated(src);
+        size_t index[MAX_INDEX];
+        size_t const n = SV_json_index(text, MAX_INDEX, index);
+        CHECK(n == 11);
+        SV_Json_cursor cur = SV_json_cursor(text, n, index);
+        SV_Str_view key;
+        CHECK(SV_json_enter(&cur));
+        CHECK(SV_json_next_key(&cur, &key));
+        CHECK(SV_compare(key, SV_from("k")) == SV_ORDER_EQUAL);
+        SV_Str_view const value = SV_json_value(&cur);
+        CHECK(value.str == src + 6 && value.len == pad + 5);
+        CHECK(SV_json_next_key(&cur, &key));
+        CHECK(SV_compare(key, SV_from("z")) == SV_ORDER_EQUAL);
+        CHECK(SV_json_enter(&cur));
+        CHECK(SV_json_next_element(&cur));
+        CHECK(SV_compare(SV_json_value(&cur), SV_from("]")) == SV_ORDER_EQUAL);
+        CHECK(!SV_json_next_element(&cur));
+        CHECK(!SV_json_next_key(&cur, &key));
+        CHECK(SV_json_type(&cur) == SV_JSON_END);
+    }
+    return TEST_PASS;
+}
+
+/* Counts the elements the cursor reports in an array. */
+static size_t
+count_elements(SV_Str_view const src, bool *const ended) {
+    size_t index[MAX_INDEX];
+    size_t const n = SV_json_index(src, MAX_INDEX, index);
+    SV_Json_cursor cur = SV_json_cursor(src, n, index);
+    size_t elements = 0;
+    if (SV_json_enter(&cur)) {
+        while (SV_json_next_element(&cur)) {
+            SV_json_skip(&cur);
+            ++elements;
+        }
+    }
+    *ended = SV_json_type(&cur) == SV_JSON_END;
+    return elements;
+}
+
+static enum Test_result
+test_json_trailing_comma(void) {
+    bool ended = false;
+    CHECK(count_elements(SV_from("[1,2]"), &ended) == 2);
+    CHECK(ended);
+    CHECK(count_elements(SV_from("[]"), &ended) == 0);
+    CHECK(count_elements(SV_from("[1,]"), &ended) == 1);
+    CHECK(ended);
+    CHECK(count_elements(SV_from("[[1],{\"a\":2},]"), &ended) == 2);
+    CHECK(count_elements(SV_from("[1,,2]"), &ended) == 1);
+    CHECK(ended);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_json_index,
+        test_json_escapes_across_blocks,
+        test_json_trailing_comma,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,80 @@
+/* This file tests the key value parser. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+
+/* The most pairs of one source the tests read. */
+#define MAX_PAIRS 8
+
+/* Parses src and checks it holds exactly the expected keys and values. */
+static enum Test_result
+expect_pairs(SV_Str_view const src, char const kv_delim,
+             char const pair_delim, SV_Charset const *const trim,
+             size_t const n, char const *const *const expected) {
+    SV_Str_view keys[MAX_PAIRS];
+    SV_Str_view values[MAX_PAIRS];
+    CHECK(SV_kv_parse(src, kv_delim, pair_delim, trim, MAX_PAIRS, keys, values)
+          == n);
+    for (size_t i = 0; i < n; ++i) {
+        CHECK(SV_compare(keys[i], SV_from_terminated(expected[2 * i]))
+              == SV_ORDER_EQUAL);
+        CHECK(SV_compare(values[i], SV_from_terminated(expected[(2 * i) + 1]))
+              == SV_ORDER_EQUAL);
+    }
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_kv_empty_pairs_skipped(void) {
+    SV_Charset const space = SV_charset(SV_from(" "));
+    CHECK(expect_pairs(SV_from("a=1&=&b=2"), '=', '&', NULL, 2,
+                       (char const *[]){"a", "1", "b", "2"})
+          == TEST_PASS);
+    CHECK(expect_pairs(SV_from(" = "), '=', '&', &space, 0, NULL)
+          == TEST_PASS);
+    CHECK(expect_pairs(SV_from("=&&="), '=', '&', NULL, 0, NULL) == TEST_PASS);
+    CHECK(expect_pairs(SV_from("a=&=b"), '=', '&', NULL, 2,
+                       (char const *[]){"a", "", "", "b"})
+          == TEST_PASS);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_kv_repeated_separators(void) {
+    CHECK(expect_pairs(SV_from("&&a=1&&&b&&"), '=', '&', NULL, 2,
+                       (char const *[]){"a", "1", "b", ""})
+          == TEST_PASS);
+    CHECK(expect_pairs(SV_from("k==v=w"), '=', '&', NULL, 1,
+                       (char const *[]){"k", "=v=w"})
+          == TEST_PASS);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_kv_trim(void) {
+    SV_Charset const space = SV_charset(SV_from(" \t\r"));
+    CHECK(expect_pairs(
+              SV_from("Host: example.com\r\n  Accept :\t*/* \r\nX-Empty:\r\n"),
+              ':', '\n', &space, 3,
+              (char const *[]){"Host", "example.com", "Accept", "*/*",
+                               "X-Empty", ""})
+          == TEST_PASS);
+    SV_Str_view keys[MAX_PAIRS];
+    SV_Str_view values[MAX_PAIRS];
+    SV_Str_view const src = SV_from("  novalue  ");
+    CHECK(SV_kv_parse(src, ':', '\n', &space, MAX_PAIRS, keys, values) == 1);
+    CHECK(SV_compare(keys[0], SV_from("novalue")) == SV_ORDER_EQUAL);
+    CHECK(values[0].len == 0 && values[0].str == src.str + 9);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_kv_empty_pairs_skipped,
+        test_kv_repeated_separators,
+        test_kv_trim,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,160 @@
+/* This file tests the parallel line index against SV_line_index(),
+   SV_line_count(), and a walk over the bytes. A line begins in the chunk that
+   holds the byte after its newline, so newlines are placed on both sides of
+   every chunk boundary, alone and as the second byte of a CRLF pair. */
+#include "str_view.h"
+#include "str_view_parallel.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The line index hands threads chunks of at least this many bytes, which is
+   the exact chunk size for the views here with the threads of the pool. */
+#define LINE_CHUNK ((size_t)1 << 20)
+#define BOUNDARIES 2
+#define TEXT_BYTES ((BOUNDARIES + 1) * LINE_CHUNK + 100)
+#define THREADS 4
+/* More offsets than any one view here holds lines, with one to spare. */
+#define MAX_OFFSETS ((size_t)1 << 18)
+
+static uint64_t
+next_random(uint64_t *const seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+/* The line starts of sv found one byte at a time: the first byte and the
+   byte after every newline but a final one. */
+static size_t
+walk_lines(SV_Str_view const sv, size_t const cap, size_t *const offsets) {
+    if (!sv.len) {
+        return 0;
+    }
+    size_t lines = 0;
+    for (size_t i = 0; i < sv.len; ++i) {
+        if (!i || sv.str[i - 1] == '\n') {
+            if (lines < cap) {
+                offsets[lines] = i;
+            }
+            ++lines;
+        }
+    }
+    return lines;
+}
+
+/* Compares the parallel index with every serial count and index of sv, with
+   room for every offset, for only some of them, and for none. */
+static enum Test_result
+expect_serial(SV_Str_view const sv, SV_Executor const *const executor) {
+    static size_t expected[MAX_OFFSETS];
+    static size_t serial[MAX_OFFSETS];
+    static size_t offsets[MAX_OFFSETS];
+    size_t const n = walk_lines(sv, MAX_OFFSETS, expected);
+    CHECK(n < MAX_OFFSETS);
+    CHECK(SV_line_count(sv) == n);
+    CHECK(SV_line_index(sv, MAX_OFFSETS, serial) == n);
+    CHECK(!memcmp(serial, expected, n * sizeof(*serial)));
+    memset(offsets, 0xff, (n + 1) * sizeof(*offsets));
+    CHECK(SV_parallel_line_index(sv, executor, n + 1, offsets) == n);
+    CHECK(!memcmp(offsets, expected, n * sizeof(*offsets)));
+    CHECK(offsets[n] == SIZE_MAX);
+    size_t const cap = n / 2;
+    memset(offsets, 0xff, (cap + 1) * sizeof(*offsets));
+    CHECK(SV_parallel_line_index(sv, executor, cap, offsets) == n);
+    CHECK(!memcmp(offsets, expected, cap * sizeof(*offsets)));
+    CHECK(offsets[cap] == SIZE_MAX);
+    CHECK(SV_parallel_line_index(sv, executor, 0, offsets) == n);
+    CHECK(SV_parallel_line_index(sv, executor, MAX_OFFSETS, NULL) == n);
+    return TEST_PASS;
+}
+
+/* Places a newline, or a CRLF pair, so it ends shift bytes before each chunk
+   boundary or just after it, and checks the view with and without a newline
+   as its last byte. */
+static enum Test_result
+test_parallel_lines_straddle_chunks(void) {
+    static char const *const breaks[] = {"\n", "\r\n", "\n\n"};
+    char *const buf = malloc(TEXT_BYTES);
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(buf != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    SV_Str_view const text = {buf, TEXT_BYTES};
+    CHECK(SV_parallel_chunk(&ex, TEXT_BYTES, LINE_CHUNK) == LINE_CHUNK);
+    for (size_t k = 0; k < sizeof(breaks) / sizeof(breaks[0]); ++k) {
+        SV_Str_view const brk = SV_from_terminated(breaks[k]);
+        for (size_t shift = 0; shift <= brk.len + 1; ++shift) {
+            memset(buf, 'x', TEXT_BYTES);
+            for (size_t b = 1; b <= BOUNDARIES; ++b) {
+                memcpy(buf + (b * LINE_CHUNK) - shift, brk.str, brk.len);
+            }
+            CHECK(expect_serial(text, &ex) == TEST_PASS);
+            memcpy(buf + TEXT_BYTES - brk.len, brk.str, brk.len);
+            CHECK(expect_serial(text, &ex) == TEST_PASS);
+        }
+    }
+    SV_pool_destroy(pool);
+    free(buf);
+    return TEST_PASS;
+}
+
+/* Lines of random length, some empty, ended by LF or CRLF, with and without
+   a final newline. */
+static enum Test_result
+test_parallel_lines_random(void) {
+    char *const buf = malloc(TEXT_BYTES);
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(buf != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (size_t i = 0; i < TEXT_BYTES; ++i) {
+        uint64_t const r = next_random(&seed) % 64;
+        buf[i] = r < 2 ? '\n' : r == 2 ? '\r' : (char)('a' + (r % 26));
+    }
+    buf[TEXT_BYTES - 1] = 'z';
+    CHECK(expect_serial((SV_Str_view){buf, TEXT_BYTES}, &ex) == TEST_PASS);
+    buf[TEXT_BYTES - 2] = '\r';
+    buf[TEXT_BYTES - 1] = '\n';
+    CHECK(expect_serial((SV_Str_view){buf, TEXT_BYTES}, &ex) == TEST_PASS);
+    SV_pool_destroy(pool);
+    free(buf);
+    return TEST_PASS;
+}
+
+/* Empty views have no lines and views shorter than a chunk are indexed on
+   the caller with the same result. */
+static enum Test_result
+test_parallel_lines_short(void) {
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    size_t offsets[4] = {7, 7, 7, 7};
+    CHECK(SV_parallel_line_index(SV_from(""), &ex, 4, offsets) == 0);
+    CHECK(SV_parallel_line_index((SV_Str_view){0}, &ex, 4, offsets) == 0);
+    CHECK(SV_parallel_line_index(SV_from(""), NULL, 4, offsets) == 0);
+    CHECK(offsets[0] == 7);
+    static char const *const texts[] = {
+        "\n", "a", "a\n", "a\r\nb", "a\r\nb\r\n", "\n\n", "\r\n\r\nx",
+    };
+    for (size_t k = 0; k < sizeof(texts) / sizeof(texts[0]); ++k) {
+        SV_Str_view const sv = SV_from_terminated(texts[k]);
+        CHECK(expect_serial(sv, &ex) == TEST_PASS);
+        CHECK(expect_serial(sv, NULL) == TEST_PASS);
+    }
+    SV_pool_destroy(pool);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_parallel_lines_straddle_chunks,
+        test_parallel_lines_random,
+        test_parallel_lines_short,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,120 @@
+/* This file tests the parallel searches against the serial ones. Each chunk
+   of the haystack is searched by one thread and extends into the next by the
+   needle length less one, so needles are placed at every offset across the
+   chunk boundaries and in dense runs of overlapping occurrences there. */
+#include "str_view.h"
+#include "str_view_parallel.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Searches hand threads chunks of at least this many bytes, which is the
+   exact chunk size for the haystacks here with the threads of the pool. */
+#define SEARCH_CHUNK ((size_t)1 << 20)
+#define BOUNDARIES 2
+#define HAYSTACK_BYTES ((BOUNDARIES + 1) * SEARCH_CHUNK + 100)
+#define THREADS 4
+/* More offsets than any one haystack here holds occurrences. */
+#define MAX_OFFSETS 4096
+
+/* Compares find, count, and find all of every kind on one haystack. */
+static enum Test_result
+expect_serial(SV_Str_view const haystack, SV_Str_view const needle,
+              SV_Executor const *const executor) {
+    static size_t expected[MAX_OFFSETS];
+    static size_t offsets[MAX_OFFSETS];
+    size_t const n = SV_find_all(haystack, needle, MAX_OFFSETS, expected);
+    CHECK(n <= MAX_OFFSETS);
+    CHECK(SV_parallel_find(haystack, needle, executor)
+          == SV_find(haystack, 0, needle));
+    CHECK(SV_parallel_count(haystack, needle, executor) == n);
+    CHECK(SV_parallel_find_all(haystack, needle, executor, MAX_OFFSETS,
+                               offsets)
+          == n);
+    CHECK(!memcmp(offsets, expected, n * sizeof(*offsets)));
+    /* A cap that keeps the occurrences of only some chunks. */
+    size_t const cap = n / 2;
+    CHECK(SV_parallel_find_all(haystack, needle, executor, cap, offsets) == n);
+    CHECK(!memcmp(offsets, expected, cap * sizeof(*offsets)));
+    return TEST_PASS;
+}
+
+/* Places one copy of needle so it begins shift bytes before each chunk
+   boundary, which moves it from wholly before the boundary to wholly after
+   it. */
+static enum Test_result
+test_parallel_search_straddles_chunks(void) {
+    static char const *const needles[] = {"N", "NX", "NXY", "NXYZ",
+                                          "NXYZnxyz!"};
+    char *const buf = malloc(HAYSTACK_BYTES);
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(buf != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    SV_Str_view const haystack = {buf, HAYSTACK_BYTES};
+    CHECK(SV_parallel_chunk(&ex, HAYSTACK_BYTES, SEARCH_CHUNK)
+          == SEARCH_CHUNK);
+    for (size_t k = 0; k < sizeof(needles) / sizeof(needles[0]); ++k) {
+        SV_Str_view const needle = SV_from_terminated(needles[k]);
+        for (size_t shift = 0; shift <= needle.len; ++shift) {
+            memset(buf, '.', HAYSTACK_BYTES);
+            for (size_t b = 1; b <= BOUNDARIES; ++b) {
+                memcpy(buf + (b * SEARCH_CHUNK) - shift, needle.str,
+                       needle.len);
+            }
+            CHECK(SV_count(haystack, needle) == BOUNDARIES);
+            CHECK(expect_serial(haystack, needle, &ex) == TEST_PASS);
+        }
+        /* An occurrence that ends the haystack. */
+        memcpy(buf + HAYSTACK_BYTES - needle.len, needle.str, needle.len);
+        CHECK(expect_serial(haystack, needle, &ex) == TEST_PASS);
+    }
+    SV_pool_destroy(pool);
+    free(buf);
+    return TEST_PASS;
+}
+
+/* Runs of one byte and of a period two pattern around each boundary hold
+   occurrences that overlap one another and the boundary. */
+static enum Test_result
+test_parallel_search_overlapping(void) {
+    static char const *const needles[] = {
+        "aa", "aaa", "aaaaaaa", "aaaaaaaaaaaaaaaaaaaaa", "aba", "ababa",
+        "abababababa",
+    };
+    char *const buf = malloc(HAYSTACK_BYTES);
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(buf != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    SV_Str_view const haystack = {buf, HAYSTACK_BYTES};
+    for (size_t run = 0; run < 2; ++run) {
+        memset(buf, '.', HAYSTACK_BYTES);
+        for (size_t b = 1; b <= BOUNDARIES; ++b) {
+            /* The runs begin on either parity around each boundary. */
+            size_t const start = (b * SEARCH_CHUNK) - 200 + b;
+            for (size_t i = 0; i < 400; ++i) {
+                buf[start + i] = run ? "ab"[i % 2] : 'a';
+            }
+        }
+        for (size_t k = 0; k < sizeof(needles) / sizeof(needles[0]); ++k) {
+            SV_Str_view const needle = SV_from_terminated(needles[k]);
+            CHECK(expect_serial(haystack, needle, &ex) == TEST_PASS);
+        }
+        CHECK(SV_parallel_count(haystack,
+                                SV_from_terminated(run ? "aba" : "aaa"), &ex)
+              == BOUNDARIES * (run ? 199 : 398));
+    }
+    SV_pool_destroy(pool);
+    free(buf);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_parallel_search_straddles_chunks,
+        test_parallel_search_overlapping,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
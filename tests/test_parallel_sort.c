@@ -0,0 +1,184 @@
+/* This file tests the parallel radix sort against qsort with SV_compare().
+   Only arrays longer than the views one thread sorts whole are split by
+   radix passes, so every array here is several times that long. */
+#include "str_view.h"
+#include "str_view_parallel.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VIEWS 150000
+#define THREADS 4
+/* The bytes every view of the shared prefix test begins with. */
+#define PREFIX_BYTES 100
+/* The longest suffix a random view has. */
+#define MAX_SUFFIX 12
+
+static uint64_t
+next_random(uint64_t *const seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static int
+compare_views(void const *const a, void const *const b) {
+    return (int)SV_compare(*(SV_Str_view const *)a, *(SV_Str_view const *)b);
+}
+
+/* Sorts a copy of the views with qsort and another with the parallel sort
+   and checks that they hold the same bytes in the same order. */
+static enum Test_result
+expect_sorted(SV_Str_view const *const views, size_t const n,
+              SV_Executor const *const executor) {
+    SV_Str_view *const expected = malloc(n * sizeof(*expected));
+    SV_Str_view *const sorted = malloc(n * sizeof(*sorted));
+    CHECK(expected != NULL && sorted != NULL);
+    memcpy(expected, views, n * sizeof(*views));
+    memcpy(sorted, views, n * sizeof(*views));
+    qsort(expected, n, sizeof(*expected), compare_views);
+    SV_parallel_sort(sorted, n, executor);
+    size_t mismatch = n;
+    for (size_t i = 0; i < n && mismatch == n; ++i) {
+        if (SV_compare(sorted[i], expected[i]) != SV_ORDER_EQUAL) {
+            mismatch = i;
+        }
+    }
+    free(expected);
+    free(sorted);
+    CHECK(mismatch == n);
+    return TEST_PASS;
+}
+
+/* Views of random length over every byte value, including zero and bytes
+   with the high bit set, and over two letters so many share prefixes. */
+static enum Test_result
+test_parallel_sort_random(void) {
+    unsigned char *const bytes = malloc((size_t)VIEWS * MAX_SUFFIX);
+    SV_Str_view *const views = malloc(VIEWS * sizeof(*views));
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(bytes != NULL && views != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    static size_t const alphabets[] = {256, 2};
+    for (size_t a = 0; a < sizeof(alphabets) / sizeof(alphabets[0]); ++a) {
+        size_t const letters = alphabets[a];
+        for (size_t i = 0; i < VIEWS; ++i) {
+            unsigned char *const s = bytes + (i * MAX_SUFFIX);
+            size_t const len = next_random(&seed) % (MAX_SUFFIX + 1);
+            for (size_t j = 0; j < len; ++j) {
+                s[j] = (unsigned char)(letters == 256
+                                           ? next_random(&seed)
+                                           : 'a' + (next_random(&seed) % 2));
+            }
+            views[i] = (SV_Str_view){(char const *)s, len};
+        }
+        CHECK(expect_sorted(views, VIEWS, &ex) == TEST_PASS);
+        CHECK(expect_sorted(views, VIEWS, NULL) == TEST_PASS);
+    }
+    SV_pool_destroy(pool);
+    free(views);
+    free(bytes);
+    return TEST_PASS;
+}
+
+/* Equal views never separate in a radix pass, so the passes must stop once
+   the views end rather than split the same bucket forever. */
+static enum Test_result
+test_parallel_sort_all_equal(void) {
+    SV_Str_view *const views = malloc(VIEWS * sizeof(*views));
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(views != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    static char const text[] = "the same view";
+    for (size_t i = 0; i < VIEWS; ++i) {
+        views[i] = (SV_Str_view){text, sizeof(text) - 1};
+    }
+    CHECK(expect_sorted(views, VIEWS, &ex) == TEST_PASS);
+    /* Equal bytes at different addresses. */
+    char *const copies = malloc(VIEWS * sizeof(text));
+    CHECK(copies != NULL);
+    for (size_t i = 0; i < VIEWS; ++i) {
+        memcpy(copies + (i * sizeof(text)), text, sizeof(text));
+        views[i]
+            = (SV_Str_view){copies + (i * sizeof(text)), sizeof(text) - 1};
+    }
+    CHECK(expect_sorted(views, VIEWS, &ex) == TEST_PASS);
+    SV_pool_destroy(pool);
+    free(copies);
+    free(views);
+    return TEST_PASS;
+}
+
+/* Every view shares a long prefix, so the radix passes must go deep before
+   any bucket splits, and some views end inside the prefix. */
+static enum Test_result
+test_parallel_sort_shared_prefix(void) {
+    size_t const stride = PREFIX_BYTES + MAX_SUFFIX;
+    char *const bytes = malloc((size_t)VIEWS * stride);
+    SV_Str_view *const views = malloc(VIEWS * sizeof(*views));
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(bytes != NULL && views != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < VIEWS; ++i) {
+        char *const s = bytes + (i * stride);
+        memset(s, 'p', PREFIX_BYTES);
+        size_t len = PREFIX_BYTES + (next_random(&seed) % (MAX_SUFFIX + 1));
+        for (size_t j = PREFIX_BYTES; j < len; ++j) {
+            s[j] = (char)('a' + (next_random(&seed) % 4));
+        }
+        if (next_random(&seed) % 64 == 0) {
+            len = next_random(&seed) % PREFIX_BYTES;
+        }
+        views[i] = (SV_Str_view){s, len};
+    }
+    CHECK(expect_sorted(views, VIEWS, &ex) == TEST_PASS);
+    SV_pool_destroy(pool);
+    free(views);
+    free(bytes);
+    return TEST_PASS;
+}
+
+/* Empty views sort first, whether they are every view or some of them. */
+static enum Test_result
+test_parallel_sort_empty_views(void) {
+    SV_Str_view *const views = malloc(VIEWS * sizeof(*views));
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(views != NULL && pool != NULL);
+    SV_Executor const ex = SV_pool_executor(pool);
+    for (size_t i = 0; i < VIEWS; ++i) {
+        views[i] = SV_from("");
+    }
+    CHECK(expect_sorted(views, VIEWS, &ex) == TEST_PASS);
+    static char const *const words[] = {"", "b", "", "a", "ab", "", "ba"};
+    size_t const n_words = sizeof(words) / sizeof(words[0]);
+    size_t empty = 0;
+    for (size_t i = 0; i < VIEWS; ++i) {
+        views[i] = SV_from_terminated(words[(i * 7919) % n_words]);
+        empty += !views[i].len;
+    }
+    CHECK(expect_sorted(views, VIEWS, &ex) == TEST_PASS);
+    SV_parallel_sort(views, VIEWS, &ex);
+    CHECK(views[0].len == 0 && views[empty - 1].len == 0);
+    CHECK(views[empty].len != 0);
+    SV_parallel_sort(views, 0, &ex);
+    SV_pool_destroy(pool);
+    free(views);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_parallel_sort_random,
+        test_parallel_sort_all_equal,
+        test_parallel_sort_shared_prefix,
+        test_parallel_sort_empty_views,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,124 @@
+/* This file tests URL splitting and path decomposition and normalization. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+static bool
+eq(SV_Str_view const sv, char const *const expected) {
+    return SV_compare(sv, SV_from_terminated(expected)) == SV_ORDER_EQUAL;
+}
+
+/* Joins the normalized segments of path with '/' and compares the result. */
+static bool
+normalizes_to(char const *const path, char const *const expected) {
+    char joined[128] = {0};
+    size_t len = 0;
+    SV_Path_iter it;
+    for (SV_Str_view seg = SV_path_normal_begin(&it, SV_from_terminated(path));
+         !SV_path_normal_end(&it); seg = SV_path_normal_next(&it)) {
+        if (len) {
+            joined[len++] = '/';
+        }
+        memcpy(joined + len, seg.str, seg.len);
+        len += seg.len;
+    }
+    return !strcmp(joined, expected);
+}
+
+static enum Test_result
+test_path_normal(void) {
+    CHECK(normalizes_to("/a/./b/../c//d", "a/c/d"));
+    CHECK(normalizes_to("a//b///c/", "a/b/c"));
+    CHECK(normalizes_to("", ""));
+    CHECK(normalizes_to("//", ""));
+    CHECK(normalizes_to("./.", ""));
+    CHECK(normalizes_to("a/b/c/../../..", ""));
+    return TEST_PASS;
+}
+
+/* A `..` above the root of an absolute path is dropped while one above the
+   start of a relative path is kept. */
+static enum Test_result
+test_path_normal_above_root(void) {
+    CHECK(normalizes_to("/..", ""));
+    CHECK(normalizes_to("/../../a", "a"));
+    CHECK(normalizes_to("/a/../../b", "b"));
+    CHECK(normalizes_to("..", ".."));
+    CHECK(normalizes_to("../a", "../a"));
+    CHECK(normalizes_to("a/../../b/..//../c", "../../c"));
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_path_parts(void) {
+    SV_Str_view const lib = SV_from("/usr/lib/libx.so.1");
+    CHECK(eq(SV_path_dirname(lib), "/usr/lib"));
+    CHECK(eq(SV_path_basename(lib), "libx.so.1"));
+    CHECK(eq(SV_path_extension(lib), ".1"));
+    CHECK(eq(SV_path_stem(lib), "libx.so"));
+    CHECK(eq(SV_path_dirname(SV_from("/")), "/"));
+    CHECK(eq(SV_path_basename(SV_from("/")), ""));
+    CHECK(eq(SV_path_dirname(SV_from("/etc")), "/"));
+    CHECK(eq(SV_path_basename(SV_from("a/b//")), "b"));
+    CHECK(eq(SV_path_dirname(SV_from("file")), ""));
+    CHECK(eq(SV_path_extension(SV_from("~/.bashrc")), ""));
+    CHECK(eq(SV_path_stem(SV_from("~/.bashrc")), ".bashrc"));
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_url_parse(void) {
+    SV_Url u = SV_url_parse(
+        SV_from("https://user:pw@example.com:8443/p/a?q=1&r=2#frag"));
+    CHECK(eq(u.scheme, "https"));
+    CHECK(eq(u.authority, "user:pw@example.com:8443"));
+    CHECK(eq(u.userinfo, "user:pw"));
+    CHECK(eq(u.host, "example.com"));
+    CHECK(eq(u.port, "8443"));
+    CHECK(eq(u.path, "/p/a"));
+    CHECK(eq(u.query, "q=1&r=2"));
+    CHECK(eq(u.fragment, "frag"));
+    u = SV_url_parse(SV_from("http://[::1]:80/x"));
+    CHECK(eq(u.host, "[::1]"));
+    CHECK(eq(u.port, "80"));
+    CHECK(eq(u.path, "/x"));
+    u = SV_url_parse(SV_from("https://host?q#f"));
+    CHECK(eq(u.host, "host"));
+    CHECK(eq(u.path, ""));
+    CHECK(eq(u.query, "q"));
+    CHECK(eq(u.fragment, "f"));
+    return TEST_PASS;
+}
+
+/* References without a scheme or authority split only what is present. */
+static enum Test_result
+test_url_parse_relative(void) {
+    SV_Url u = SV_url_parse(SV_from("/search?q=1"));
+    CHECK(eq(u.scheme, ""));
+    CHECK(eq(u.authority, ""));
+    CHECK(eq(u.path, "/search"));
+    CHECK(eq(u.query, "q=1"));
+    u = SV_url_parse(SV_from("mailto:a@b.c"));
+    CHECK(eq(u.scheme, "mailto"));
+    CHECK(eq(u.authority, ""));
+    CHECK(eq(u.path, "a@b.c"));
+    u = SV_url_parse(SV_from("#top"));
+    CHECK(eq(u.path, ""));
+    CHECK(eq(u.fragment, "top"));
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_path_normal,
+        test_path_normal_above_root,
+        test_path_parts,
+        test_url_parse,
+        test_url_parse_relative,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,229 @@
+/* This file tests the thread pool and the executor it provides. */
+#include "str_view.h"
+#include "str_view_parallel.h"
+#include "test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define THREADS 4
+#define MAX_TASKS 100000
+/* The threads that submit loops to one pool at the same time. */
+#define SUBMITTERS 4
+/* How long a task waits for another thread to steal work before giving up. */
+#define STEAL_WAIT_SECONDS 10
+
+/* The state of one loop: how often each task ran and what it wrote. */
+struct Loop {
+    atomic_uint *runs;
+    size_t *values;
+    size_t tasks;
+};
+
+static void
+count_task(void *const arg, size_t const i) {
+    struct Loop *const l = arg;
+    (void)atomic_fetch_add_explicit(&l->runs[i], 1, memory_order_relaxed);
+    l->values[i] = i * 3;
+}
+
+/* Checks that every task of the loop ran once and its write is visible. */
+static enum Test_result
+expect_ran_once(struct Loop const *const l) {
+    for (size_t i = 0; i < l->tasks; ++i) {
+        CHECK(atomic_load_explicit(&l->runs[i], memory_order_relaxed) == 1);
+        CHECK(l->values[i] == i * 3);
+    }
+    return TEST_PASS;
+}
+
+static void
+loop_reset(struct Loop *const l, size_t const tasks) {
+    l->tasks = tasks;
+    for (size_t i = 0; i < tasks; ++i) {
+        atomic_store_explicit(&l->runs[i], 0, memory_order_relaxed);
+        l->values[i] = 0;
+    }
+}
+
+/* Loops of every size run each task exactly once, back to back on the same
+   pool, through the executor, and on the caller alone. */
+static enum Test_result
+test_pool_for_runs_every_task(void) {
+    static size_t const sizes[] = {0, 1, 2, 3, 7, 16, 17, 1000, MAX_TASKS};
+    struct Loop l = {
+        .runs = malloc(MAX_TASKS * sizeof(*l.runs)),
+        .values = malloc(MAX_TASKS * sizeof(*l.values)),
+    };
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(l.runs != NULL && l.values != NULL && pool != NULL);
+    CHECK(SV_pool_threads(pool) >= 1 && SV_pool_threads(pool) <= THREADS);
+    SV_Executor const ex = SV_pool_executor(pool);
+    CHECK(ex.threads == SV_pool_threads(pool));
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+        for (size_t round = 0; round < 20; ++round) {
+            loop_reset(&l, sizes[k]);
+            SV_pool_for(pool, sizes[k], count_task, &l);
+            CHECK(expect_ran_once(&l) == TEST_PASS);
+        }
+        loop_reset(&l, sizes[k]);
+        SV_parallel_for(&ex, sizes[k], count_task, &l);
+        CHECK(expect_ran_once(&l) == TEST_PASS);
+        loop_reset(&l, sizes[k]);
+        SV_pool_for(NULL, sizes[k], count_task, &l);
+        CHECK(expect_ran_once(&l) == TEST_PASS);
+        loop_reset(&l, sizes[k]);
+        SV_parallel_for(NULL, sizes[k], count_task, &l);
+        CHECK(expect_ran_once(&l) == TEST_PASS);
+    }
+    CHECK(SV_pool_threads(NULL) == 1);
+    SV_pool_destroy(pool);
+    free(l.runs);
+    free(l.values);
+    return TEST_PASS;
+}
+
+/* The submitting thread keeps the lower half of every range it splits and
+   so runs task 0 first. Task 0 waits until a task has run on another
+   thread, which can only happen if a worker stole a range from it. */
+struct Steal {
+    struct Loop loop;
+    pthread_t submitter;
+    atomic_bool stolen;
+    atomic_bool timed_out;
+    atomic_size_t other_thread_tasks;
+};
+
+static void
+steal_task(void *const arg, size_t const i) {
+    struct Steal *const s = arg;
+    if (!pthread_equal(pthread_self(), s->submitter)) {
+        (void)atomic_fetch_add(&s->other_thread_tasks, 1);
+        atomic_store(&s->stolen, true);
+    }
+    if (i == 0) {
+        time_t const start = time(NULL);
+        while (!atomic_load(&s->stolen)) {
+            if (time(NULL) - start > STEAL_WAIT_SECONDS) {
+                atomic_store(&s->timed_out, true);
+                break;
+            }
+            (void)sched_yield();
+        }
+    }
+    count_task(&s->loop, i);
+}
+
+static enum Test_result
+test_pool_steals_work(void) {
+    size_t const tasks = 64 * THREADS;
+    struct Steal s = {
+        .loop =
+            {
+                .runs = malloc(tasks * sizeof(*s.loop.runs)),
+                .values = malloc(tasks * sizeof(*s.loop.values)),
+            },
+        .submitter = pthread_self(),
+    };
+    atomic_init(&s.stolen, false);
+    atomic_init(&s.timed_out, false);
+    atomic_init(&s.other_thread_tasks, 0);
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(s.loop.runs != NULL && s.loop.values != NULL && pool != NULL);
+    if (SV_pool_threads(pool) > 1) {
+        loop_reset(&s.loop, tasks);
+        SV_pool_for(pool, tasks, steal_task, &s);
+        CHECK(!atomic_load(&s.timed_out));
+        CHECK(atomic_load(&s.other_thread_tasks) > 0);
+        CHECK(expect_ran_once(&s.loop) == TEST_PASS);
+    }
+    SV_pool_destroy(pool);
+    free(s.loop.runs);
+    free(s.loop.values);
+    return TEST_PASS;
+}
+
+/* Loops submitted from several threads at once wait their turn. */
+struct Submitter {
+    SV_Pool *pool;
+    struct Loop loop;
+    size_t rounds;
+    bool ok;
+};
+
+static void *
+submit_loops(void *const arg) {
+    struct Submitter *const s = arg;
+    s->ok = true;
+    for (size_t r = 0; r < s->rounds; ++r) {
+        loop_reset(&s->loop, s->loop.tasks);
+        SV_pool_for(s->pool, s->loop.tasks, count_task, &s->loop);
+        s->ok = s->ok && expect_ran_once(&s->loop) == TEST_PASS;
+    }
+    return NULL;
+}
+
+/* A pool is destroyed right after creation, right after a loop returns while
+   workers may still be leaving it, and after loops queued from several
+   threads behind one another have all run. */
+static enum Test_result
+test_pool_shutdown(void) {
+    for (size_t i = 0; i < 50; ++i) {
+        SV_pool_destroy(SV_pool_create(THREADS));
+    }
+    SV_pool_destroy(NULL);
+    size_t const tasks = 1000;
+    struct Submitter subs[SUBMITTERS];
+    for (size_t i = 0; i < SUBMITTERS; ++i) {
+        subs[i] = (struct Submitter){
+            .loop =
+                {
+                    .runs = malloc(tasks * sizeof(*subs[i].loop.runs)),
+                    .values = malloc(tasks * sizeof(*subs[i].loop.values)),
+                    .tasks = tasks,
+                },
+        };
+        CHECK(subs[i].loop.runs != NULL && subs[i].loop.values != NULL);
+    }
+    for (size_t i = 0; i < 50; ++i) {
+        SV_Pool *const pool = SV_pool_create(THREADS);
+        CHECK(pool != NULL);
+        loop_reset(&subs[0].loop, tasks);
+        SV_pool_for(pool, tasks, count_task, &subs[0].loop);
+        SV_pool_destroy(pool);
+        CHECK(expect_ran_once(&subs[0].loop) == TEST_PASS);
+    }
+    SV_Pool *const pool = SV_pool_create(THREADS);
+    CHECK(pool != NULL);
+    pthread_t ids[SUBMITTERS];
+    for (size_t i = 0; i < SUBMITTERS; ++i) {
+        subs[i].pool = pool;
+        subs[i].rounds = 25;
+        CHECK(!pthread_create(&ids[i], NULL, submit_loops, &subs[i]));
+    }
+    for (size_t i = 0; i < SUBMITTERS; ++i) {
+        CHECK(!pthread_join(ids[i], NULL));
+    }
+    SV_pool_destroy(pool);
+    for (size_t i = 0; i < SUBMITTERS; ++i) {
+        CHECK(subs[i].ok);
+        free(subs[i].loop.runs);
+        free(subs[i].loop.values);
+    }
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_pool_for_runs_every_task,
+        test_pool_steals_work,
+        test_pool_shutdown,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
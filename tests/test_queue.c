@@ -0,0 +1,325 @@
+/* This file tests the view batch queues. Pushes and pops move runs of
+   batches at once, so runs are checked against a full ring, an empty one,
+   and a ring whose free or filled slots wrap past its end. */
+#include "str_view.h"
+#include "str_view_parallel.h"
+#include "test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* The capacity asked for, which the queues round up to RING_SLOTS. */
+#define CAPACITY 13
+#define RING_SLOTS 16
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define ITEMS_PER_PRODUCER 20000
+#define ITEMS (PRODUCERS * ITEMS_PER_PRODUCER)
+/* The most batches one push or pop moves in the threaded tests. */
+#define MAX_RUN 7
+
+/* Every batch holds one view of items, so its position in items names it,
+   and counts its release in released. */
+static SV_Str_view items[ITEMS];
+static atomic_size_t released;
+
+static void
+release_batch(void *const ctx) {
+    (void)ctx;
+    (void)atomic_fetch_add_explicit(&released, 1, memory_order_relaxed);
+}
+
+static SV_View_batch
+item_batch(size_t const id) {
+    return (SV_View_batch){
+        .views = &items[id],
+        .n = 1,
+        .release = release_batch,
+    };
+}
+
+static size_t
+batch_id(SV_View_batch const *const batch) {
+    return (size_t)(batch->views - items);
+}
+
+static uint64_t
+next_random(uint64_t *const seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+/* The push and pop of either queue, so both are run through the same
+   single threaded checks. */
+struct Queue_ops {
+    void *(*create)(size_t capacity);
+    void (*destroy)(void *queue);
+    size_t (*push)(void *queue, SV_View_batch const *batches, size_t n);
+    size_t (*pop)(void *queue, SV_View_batch *batches, size_t cap);
+};
+
+static void *
+spsc_create(size_t const capacity) {
+    return SV_spsc_create(capacity);
+}
+
+static void
+spsc_destroy(void *const queue) {
+    SV_spsc_destroy(queue);
+}
+
+static size_t
+spsc_push(void *const queue, SV_View_batch const *const batches,
+          size_t const n) {
+    return SV_spsc_push(queue, batches, n);
+}
+
+static size_t
+spsc_pop(void *const queue, SV_View_batch *const batches, size_t const cap) {
+    return SV_spsc_pop(queue, batches, cap);
+}
+
+static void *
+mpmc_create(size_t const capacity) {
+    return SV_mpmc_create(capacity);
+}
+
+static void
+mpmc_destroy(void *const queue) {
+    SV_mpmc_destroy(queue);
+}
+
+static size_t
+mpmc_push(void *const queue, SV_View_batch const *const batches,
+          size_t const n) {
+    return SV_mpmc_push(queue, batches, n);
+}
+
+static size_t
+mpmc_pop(void *const queue, SV_View_batch *const batches, size_t const cap) {
+    return SV_mpmc_pop(queue, batches, cap);
+}
+
+static struct Queue_ops const spsc_ops = {
+    spsc_create,
+    spsc_destroy,
+    spsc_push,
+    spsc_pop,
+};
+
+static struct Queue_ops const mpmc_ops = {
+    mpmc_create,
+    mpmc_destroy,
+    mpmc_push,
+    mpmc_pop,
+};
+
+/* A push into a full ring moves nothing and one larger than the free slots
+   moves only as many as fit, from the front. A pop from an empty ring moves
+   nothing and one larger than the filled slots moves only those. */
+static enum Test_result
+expect_boundaries(struct Queue_ops const *const ops) {
+    SV_View_batch in[2 * RING_SLOTS];
+    SV_View_batch out[2 * RING_SLOTS];
+    for (size_t i = 0; i < 2 * RING_SLOTS; ++i) {
+        in[i] = item_batch(i);
+    }
+    void *const q = ops->create(CAPACITY);
+    CHECK(q != NULL);
+    CHECK(ops->pop(q, out, RING_SLOTS) == 0);
+    CHECK(ops->push(q, in, 0) == 0);
+    CHECK(ops->push(q, in, 2 * RING_SLOTS) == RING_SLOTS);
+    CHECK(ops->push(q, in + RING_SLOTS, 1) == 0);
+    CHECK(ops->pop(q, out, 0) == 0);
+    CHECK(ops->pop(q, out, 3) == 3);
+    CHECK(batch_id(&out[0]) == 0 && batch_id(&out[2]) == 2);
+    /* The free slots now wrap past the end of the ring. */
+    CHECK(ops->push(q, in + RING_SLOTS, 5) == 3);
+    CHECK(ops->push(q, in, 1) == 0);
+    CHECK(ops->pop(q, out, 2 * RING_SLOTS) == RING_SLOTS);
+    for (size_t i = 0; i < RING_SLOTS; ++i) {
+        CHECK(batch_id(&out[i]) == 3 + i);
+    }
+    CHECK(ops->pop(q, out, 1) == 0);
+    /* Runs of every length lap the ring many times in order. */
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    size_t next_in = 0;
+    size_t next_out = 0;
+    for (size_t round = 0; round < 2000; ++round) {
+        size_t const n = next_random(&seed) % (RING_SLOTS + 2);
+        size_t const filled = next_in - next_out;
+        for (size_t i = 0; i < n; ++i) {
+            in[i] = item_batch((next_in + i) % ITEMS);
+        }
+        size_t const pushed = ops->push(q, in, n);
+        CHECK(pushed == (n < RING_SLOTS - filled ? n : RING_SLOTS - filled));
+        next_in += pushed;
+        size_t const cap = next_random(&seed) % (RING_SLOTS + 2);
+        size_t const ready = next_in - next_out;
+        size_t const popped = ops->pop(q, out, cap);
+        CHECK(popped == (cap < ready ? cap : ready));
+        for (size_t i = 0; i < popped; ++i) {
+            CHECK(batch_id(&out[i]) == (next_out + i) % ITEMS);
+        }
+        next_out += popped;
+    }
+    /* Destroying the queue releases the batches still in it. */
+    size_t const before = atomic_load(&released);
+    ops->destroy(q);
+    CHECK(atomic_load(&released) - before == next_in - next_out);
+    ops->destroy(NULL);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_spsc_boundaries(void) {
+    return expect_boundaries(&spsc_ops);
+}
+
+static enum Test_result
+test_mpmc_boundaries(void) {
+    return expect_boundaries(&mpmc_ops);
+}
+
+/* Each producer pushes its own items in order in runs of random length and
+   each consumer pops runs of random length, counting every item it sees. A
+   consumer sees the items of any one producer in the order they were
+   pushed. */
+struct Threaded {
+    struct Queue_ops const *ops;
+    void *queue;
+    atomic_uint seen[ITEMS];
+    atomic_size_t consumed;
+    atomic_bool out_of_order;
+};
+
+struct Worker {
+    struct Threaded *t;
+    size_t index;
+};
+
+static void *
+produce(void *const arg) {
+    struct Worker const *const w = arg;
+    struct Threaded *const t = w->t;
+    uint64_t seed = 0x2545F4914F6CDD1DULL + w->index;
+    SV_View_batch run[MAX_RUN];
+    size_t const first = w->index * ITEMS_PER_PRODUCER;
+    size_t const end = first + ITEMS_PER_PRODUCER;
+    for (size_t next = first; next < end;) {
+        size_t n = 1 + (next_random(&seed) % MAX_RUN);
+        n = n < end - next ? n : end - next;
+        for (size_t i = 0; i < n; ++i) {
+            run[i] = item_batch(next + i);
+        }
+        size_t const pushed = t->ops->push(t->queue, run, n);
+        if (!pushed) {
+            (void)sched_yield();
+        }
+        next += pushed;
+    }
+    return NULL;
+}
+
+static void *
+consume(void *const arg) {
+    struct Worker const *const w = arg;
+    struct Threaded *const t = w->t;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL + w->index;
+    size_t last[PRODUCERS];
+    bool any[PRODUCERS] = {false};
+    SV_View_batch run[MAX_RUN];
+    while (atomic_load(&t->consumed) < ITEMS) {
+        size_t const cap = 1 + (next_random(&seed) % MAX_RUN);
+        size_t const popped = t->ops->pop(t->queue, run, cap);
+        if (!popped) {
+            (void)sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < popped; ++i) {
+            size_t const id = batch_id(&run[i]);
+            size_t const p = id / ITEMS_PER_PRODUCER;
+            if (any[p] && id <= last[p]) {
+                atomic_store(&t->out_of_order, true);
+            }
+            any[p] = true;
+            last[p] = id;
+            (void)atomic_fetch_add(&t->seen[id], 1);
+            SV_view_batch_release(&run[i]);
+        }
+        (void)atomic_fetch_add(&t->consumed, popped);
+    }
+    return NULL;
+}
+
+/* Runs the given producers and consumers over one queue and checks that
+   every item was delivered and released exactly once. */
+static enum Test_result
+expect_delivered(struct Queue_ops const *const ops, size_t const producers,
+                 size_t const consumers) {
+    struct Threaded *const t = malloc(sizeof(*t));
+    CHECK(t != NULL);
+    t->ops = ops;
+    t->queue = ops->create(CAPACITY);
+    CHECK(t->queue != NULL);
+    for (size_t i = 0; i < ITEMS; ++i) {
+        atomic_init(&t->seen[i], 0);
+    }
+    atomic_init(&t->consumed, ITEMS - (producers * ITEMS_PER_PRODUCER));
+    atomic_init(&t->out_of_order, false);
+    size_t const before = atomic_load(&released);
+    pthread_t ids[PRODUCERS + CONSUMERS];
+    struct Worker workers[PRODUCERS + CONSUMERS];
+    for (size_t i = 0; i < producers + consumers; ++i) {
+        workers[i] = (struct Worker){
+            .t = t,
+            .index = i < producers ? i : i - producers,
+        };
+        CHECK(!pthread_create(&ids[i], NULL, i < producers ? produce : consume,
+                              &workers[i]));
+    }
+    for (size_t i = 0; i < producers + consumers; ++i) {
+        CHECK(!pthread_join(ids[i], NULL));
+    }
+    CHECK(!atomic_load(&t->out_of_order));
+    CHECK(atomic_load(&t->consumed) == ITEMS);
+    for (size_t i = 0; i < producers * ITEMS_PER_PRODUCER; ++i) {
+        CHECK(atomic_load(&t->seen[i]) == 1);
+    }
+    CHECK(atomic_load(&released) - before == producers * ITEMS_PER_PRODUCER);
+    ops->destroy(t->queue);
+    CHECK(atomic_load(&released) - before == producers * ITEMS_PER_PRODUCER);
+    free(t);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_spsc_threads(void) {
+    return expect_delivered(&spsc_ops, 1, 1);
+}
+
+static enum Test_result
+test_mpmc_threads(void) {
+    CHECK(expect_delivered(&mpmc_ops, 1, 1) == TEST_PASS);
+    CHECK(expect_delivered(&mpmc_ops, PRODUCERS, 1) == TEST_PASS);
+    CHECK(expect_delivered(&mpmc_ops, 1, CONSUMERS) == TEST_PASS);
+    return expect_delivered(&mpmc_ops, PRODUCERS, CONSUMERS);
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_spsc_boundaries,
+        test_mpmc_boundaries,
+        test_spsc_threads,
+        test_mpmc_threads,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,236 @@
+/* This file tests finding and counting every occurrence of a needle. Needles
+   longer than four bytes are found in one two-way scan that continues past
+   each match, so periodic needles, which the scan shifts by their period and
+   remembers, are compared with a byte by byte search over small alphabets
+   where occurrences overlap. Streaming searches feed the same haystacks in
+   chunks and must report the same offsets. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The longest haystack the tests search. */
+#define MAX_BYTES 600
+#define ROUNDS 300
+
+static uint64_t
+next_random(uint64_t *const seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+/* Writes every position at which needle occurs in haystack and returns how
+   many there are. */
+static size_t
+brute_find_all(SV_Str_view const haystack, SV_Str_view const needle,
+               size_t *const offsets) {
+    size_t found = 0;
+    for (size_t i = 0; needle.len <= haystack.len
+                       && i <= haystack.len - needle.len;
+         ++i) {
+        if (!memcmp(haystack.str + i, needle.str, needle.len)) {
+            offsets[found++] = i;
+        }
+    }
+    return found;
+}
+
+/* Compares every way of finding all occurrences with the brute force. */
+static enum Test_result
+expect_all(SV_Str_view const haystack, SV_Str_view const needle) {
+    size_t expected[MAX_BYTES];
+    size_t offsets[MAX_BYTES];
+    size_t const n = brute_find_all(haystack, needle, expected);
+    CHECK(SV_find_all(haystack, needle, MAX_BYTES, offsets) == n);
+    CHECK(!memcmp(offsets, expected, n * sizeof(*offsets)));
+    CHECK(SV_count(haystack, needle) == n);
+    SV_Needle const nd = SV_needle(needle);
+    CHECK(SV_needle_count(haystack, &nd) == n);
+    size_t const cap = n / 2;
+    memset(offsets, 0xFF, sizeof(offsets));
+    CHECK(SV_needle_find_all(haystack, &nd, cap, offsets) == n);
+    CHECK(!memcmp(offsets, expected, cap * sizeof(*offsets)));
+    CHECK(offsets[cap] == SIZE_MAX);
+    CHECK(SV_find(haystack, 0, needle) == (n ? expected[0] : haystack.len));
+    return TEST_PASS;
+}
+
+/* Periodic needles in a haystack of one repeated byte or pattern match at
+   every period. */
+static enum Test_result
+test_find_all_periodic(void) {
+    char haystack[MAX_BYTES];
+    char needle[64];
+    memset(haystack, 'a', sizeof(haystack));
+    memset(needle, 'a', sizeof(needle));
+    for (size_t len = 1; len <= sizeof(needle); ++len) {
+        CHECK(expect_all((SV_Str_view){haystack, sizeof(haystack)},
+                         (SV_Str_view){needle, len})
+              == TEST_PASS);
+    }
+    for (size_t i = 0; i < sizeof(haystack); ++i) {
+        haystack[i] = "abaab"[i % 5];
+    }
+    for (size_t len = 5; len <= 40; ++len) {
+        CHECK(expect_all((SV_Str_view){haystack, sizeof(haystack)},
+                         (SV_Str_view){haystack + 3, len})
+              == TEST_PASS);
+    }
+    return TEST_PASS;
+}
+
+/* Random needles over two and three letters are periodic or not by chance
+   and overlap often. */
+static enum Test_result
+test_find_all_random(void) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    char haystack[MAX_BYTES];
+    char needle[24];
+    for (size_t r = 0; r < ROUNDS; ++r) {
+        size_t const letters = 2 + (r % 2);
+        size_t const len = next_random(&seed) % sizeof(haystack);
+        for (size_t i = 0; i < len; ++i) {
+            haystack[i] = (char)('a' + (next_random(&seed) % letters));
+        }
+        size_t const needle_len = 1 + (next_random(&seed) % sizeof(needle));
+        for (size_t i = 0; i < needle_len; ++i) {
+            needle[i] = (char)('a' + (next_random(&seed) % letters));
+        }
+        CHECK(expect_all((SV_Str_view){haystack, len},
+                         (SV_Str_view){needle, needle_len})
+              == TEST_PASS);
+        if (len > needle_len) {
+            size_t const at = next_random(&seed) % (len - needle_len);
+            CHECK(expect_all((SV_Str_view){haystack, len},
+                             (SV_Str_view){haystack + at, needle_len})
+                  == TEST_PASS);
+        }
+    }
+    return TEST_PASS;
+}
+
+/* Feeds haystack to a streaming search in chunks of the given sizes, taken in
+   turn, and writes every offset reported. Returns the number of offsets or
+   SIZE_MAX if a feed reported more occurrences than it wrote. */
+static size_t
+stream_find_all(SV_Str_view const haystack, SV_Str_view const needle,
+                size_t const *const sizes, size_t const n_sizes,
+                size_t *const offsets) {
+    SV_Needle const nd = SV_needle(needle);
+    char window[2 * MAX_BYTES];
+    if (SV_search_window_bytes(&nd) > sizeof(window)) {
+        return SIZE_MAX;
+    }
+    SV_Search_state state = SV_search_state(&nd, window);
+    size_t found = 0;
+    for (size_t at = 0, k = 0; at < haystack.len; ++k) {
+        size_t const len = sizes[k % n_sizes] < haystack.len - at
+                               ? sizes[k % n_sizes]
+                               : haystack.len - at;
+        size_t const n
+            = SV_search_feed(&state, (SV_Str_view){haystack.str + at, len},
+                             MAX_BYTES - found, offsets + found);
+        if (n > MAX_BYTES - found) {
+            return SIZE_MAX;
+        }
+        found += n;
+        at += len;
+    }
+    return found;
+}
+
+/* Compares a streaming search in chunks of the given sizes with the brute
+   force. */
+static enum Test_result
+expect_stream(SV_Str_view const haystack, SV_Str_view const needle,
+              size_t const *const sizes, size_t const n_sizes) {
+    size_t expected[MAX_BYTES];
+    size_t offsets[MAX_BYTES];
+    size_t const n = brute_find_all(haystack, needle, expected);
+    CHECK(stream_find_all(haystack, needle, sizes, n_sizes, offsets) == n);
+    CHECK(!memcmp(offsets, expected, n * sizeof(*offsets)));
+    return TEST_PASS;
+}
+
+/* One occurrence split between two buffers at every byte of the needle,
+   including where it begins or ends exactly at the split. */
+static enum Test_result
+test_stream_match_split(void) {
+    static char const *const needles[] = {"ab", "abc", "abcde", "aaaa",
+                                          "needle in a haystack"};
+    char haystack[64];
+    for (size_t k = 0; k < sizeof(needles) / sizeof(needles[0]); ++k) {
+        SV_Str_view const needle = SV_from_terminated(needles[k]);
+        memset(haystack, '.', sizeof(haystack));
+        memcpy(haystack + 20, needle.str, needle.len);
+        for (size_t split = 20; split <= 20 + needle.len; ++split) {
+            size_t const sizes[] = {split, sizeof(haystack)};
+            CHECK(expect_stream((SV_Str_view){haystack, sizeof(haystack)},
+                                needle, sizes, 2)
+                  == TEST_PASS);
+        }
+    }
+    return TEST_PASS;
+}
+
+/* A needle longer than every buffer spans several of them, so the carried
+   bytes grow over many feeds before an occurrence ends. Overlapping
+   occurrences of periodic needles end in the same buffer and in
+   consecutive ones. */
+static enum Test_result
+test_stream_needle_longer_than_buffer(void) {
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    char haystack[MAX_BYTES];
+    for (size_t i = 0; i < sizeof(haystack); ++i) {
+        haystack[i] = "abaab"[i % 5];
+    }
+    SV_Str_view const periodic = {haystack, sizeof(haystack)};
+    for (size_t len = 2; len <= 40; len += 3) {
+        SV_Str_view const needle = {haystack + 3, len};
+        for (size_t size = 1; size < len; ++size) {
+            CHECK(expect_stream(periodic, needle, &size, 1) == TEST_PASS);
+        }
+    }
+    for (size_t r = 0; r < ROUNDS; ++r) {
+        size_t const letters = 2 + (r % 2);
+        for (size_t i = 0; i < sizeof(haystack); ++i) {
+            haystack[i] = (char)('a' + (next_random(&seed) % letters));
+        }
+        size_t const len = 2 + (next_random(&seed) % 30);
+        size_t const at = next_random(&seed) % (sizeof(haystack) - len);
+        size_t sizes[8];
+        for (size_t i = 0; i < 8; ++i) {
+            sizes[i] = 1 + (next_random(&seed) % (len + (len / 2)));
+        }
+        CHECK(expect_stream((SV_Str_view){haystack, sizeof(haystack)},
+                            (SV_Str_view){haystack + at, len}, sizes, 8)
+              == TEST_PASS);
+    }
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_find_all_edges(void) {
+    CHECK(SV_count(SV_from("abc"), SV_from("")) == 0);
+    CHECK(SV_count(SV_from("abcde"), SV_from("abcdef")) == 0);
+    CHECK(SV_count(SV_from("abcdef"), SV_from("abcdef")) == 1);
+    CHECK(expect_all(SV_from("xxabcdexxabcdexabcde"), SV_from("abcde"))
+          == TEST_PASS);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_find_all_periodic,
+        test_find_all_random,
+        test_find_all_edges,
+        test_stream_match_split,
+        test_stream_needle_longer_than_buffer,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,98 @@
+/* This file tests compiled line templates. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+static bool
+eq(SV_Str_view const sv, char const *const expected) {
+    return SV_compare(sv, SV_from_terminated(expected)) == SV_ORDER_EQUAL;
+}
+
+static enum Test_result
+test_template_match(void) {
+    SV_Template t;
+    CHECK(SV_template_compile(&t, SV_from("<ts> <level> [<module>] <msg>")));
+    CHECK(SV_template_fields(&t) == 4);
+    SV_Str_view f[SV_TEMPLATE_MAX_FIELDS];
+    CHECK(SV_template_match(
+        &t, SV_from("12:00:01 WARN [net] retry [2] in 5s"), f));
+    CHECK(eq(f[0], "12:00:01"));
+    CHECK(eq(f[1], "WARN"));
+    CHECK(eq(f[2], "net"));
+    CHECK(eq(f[3], "retry [2] in 5s"));
+    CHECK(SV_template_match(&t, SV_from("  [] "), f));
+    CHECK(eq(f[0], "") && eq(f[1], "") && eq(f[2], "") && eq(f[3], ""));
+    return TEST_PASS;
+}
+
+/* A mismatch fills the fields found before it and no others. */
+static enum Test_result
+test_template_mismatch(void) {
+    SV_Template t;
+    CHECK(SV_template_compile(&t, SV_from("<a>,<b>;<c>.")));
+    SV_Str_view f[3] = {SV_from("unset"), SV_from("unset"), SV_from("unset")};
+    CHECK(!SV_template_match(&t, SV_from("x,y:z."), f));
+    CHECK(eq(f[0], "x"));
+    CHECK(eq(f[1], "unset"));
+    CHECK(!SV_template_match(&t, SV_from("x,y;z"), f));
+    CHECK(!SV_template_match(&t, SV_from("."), f));
+    CHECK(SV_template_match(&t, SV_from("x,y;z;."), f));
+    CHECK(eq(f[1], "y") && eq(f[2], "z;"));
+    CHECK(SV_template_compile(&t, SV_from("GET <path> HTTP/<ver>")));
+    CHECK(!SV_template_match(&t, SV_from("POST /x HTTP/1.1"), f));
+    return TEST_PASS;
+}
+
+/* Names that are not fields of the template report the field count. */
+static enum Test_result
+test_template_unknown_field(void) {
+    SV_Template t;
+    CHECK(SV_template_compile(&t, SV_from("<a>=<b>")));
+    CHECK(SV_template_field(&t, SV_from("b")) == 1);
+    CHECK(SV_template_field(&t, SV_from("c")) == SV_template_fields(&t));
+    CHECK(SV_template_field(&t, SV_from("")) == SV_template_fields(&t));
+    CHECK(SV_template_field(&t, SV_from("<a>")) == SV_template_fields(&t));
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_template_unterminated_field(void) {
+    SV_Template t;
+    CHECK(!SV_template_compile(&t, SV_from("<ts> <level")));
+    CHECK(!SV_template_compile(&t, SV_from("<")));
+    CHECK(!SV_template_compile(&t, SV_from("<a><b>")));
+    return TEST_PASS;
+}
+
+/* A template holds exactly SV_TEMPLATE_MAX_FIELDS fields and no more. */
+static enum Test_result
+test_template_field_cap(void) {
+    char pattern[(SV_TEMPLATE_MAX_FIELDS + 1) * 4];
+    size_t len = 0;
+    for (size_t i = 0; i < SV_TEMPLATE_MAX_FIELDS; ++i) {
+        memcpy(pattern + len, "<f>,", 4);
+        len += 4;
+    }
+    SV_Template t;
+    CHECK(SV_template_compile(&t, (SV_Str_view){pattern, len}));
+    CHECK(SV_template_fields(&t) == SV_TEMPLATE_MAX_FIELDS);
+    memcpy(pattern + len, "<f>,", 4);
+    len += 4;
+    CHECK(!SV_template_compile(&t, (SV_Str_view){pattern, len}));
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_template_match,
+        test_template_mismatch,
+        test_template_unknown_field,
+        test_template_unterminated_field,
+        test_template_field_cap,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,102 @@
+/* This file tests trimming and whitespace collapsing. Sets are compared 64
+   bytes at a time, so runs to remove are also made longer than a block. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/* The longest text the tests trim. */
+#define MAX_BYTES 200
+
+static enum Test_result
+test_trim_all_whitespace(void) {
+    char buf[MAX_BYTES];
+    for (size_t len = 1; len < MAX_BYTES; len += 7) {
+        for (size_t i = 0; i < len; ++i) {
+            buf[i] = " \t\n\v\f\r"[i % 6];
+        }
+        SV_Str_view const sv = {buf, len};
+        SV_Str_view const none = SV_from("");
+        SV_Str_view t = SV_trim(sv, none);
+        CHECK(t.len == 0 && t.str == buf + len);
+        t = SV_trim_left(sv, none);
+        CHECK(t.len == 0 && t.str == buf + len);
+        t = SV_trim_right(sv, none);
+        CHECK(t.len == 0 && t.str == buf);
+        char out[MAX_BYTES];
+        CHECK(SV_collapse_whitespace(sv, sizeof(out), out) == 1);
+        CHECK(out[0] == '\0');
+    }
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_trim_empty(void) {
+    SV_Str_view const empty = SV_from("");
+    CHECK(SV_trim(empty, empty).len == 0);
+    CHECK(SV_trim_left(empty, SV_from("ab")).len == 0);
+    CHECK(SV_trim_right(empty, SV_from("ab")).len == 0);
+    SV_Str_view const sv = SV_from("  x  ");
+    CHECK(SV_trim(sv, SV_from("x")).len == sv.len);
+    char out[8] = "unset";
+    CHECK(SV_collapse_whitespace(empty, sizeof(out), out) == 1);
+    CHECK(out[0] == '\0');
+    CHECK(SV_collapse_whitespace(sv, 0, out) == 0);
+    return TEST_PASS;
+}
+
+/* Set characters at both ends, in runs longer than a block, are removed
+   while the same characters inside the view are kept. */
+static enum Test_result
+test_trim_set_at_both_ends(void) {
+    char buf[MAX_BYTES];
+    SV_Str_view const set = SV_from("-=");
+    for (size_t run = 0; run < 80; run += 3) {
+        memset(buf, '-', run);
+        memcpy(buf + run, "a-=b", 4);
+        memset(buf + run + 4, '=', run);
+        SV_Str_view const sv = {buf, (run * 2) + 4};
+        SV_Str_view t = SV_trim(sv, set);
+        CHECK(t.str == buf + run && t.len == 4);
+        t = SV_trim_left(sv, set);
+        CHECK(t.str == buf + run && t.len == run + 4);
+        t = SV_trim_right(sv, set);
+        CHECK(t.str == buf && t.len == run + 4);
+    }
+    CHECK(SV_compare(SV_trim(SV_from("xyx"), SV_from("x")), SV_from("y"))
+          == SV_ORDER_EQUAL);
+    CHECK(SV_trim(SV_from("xxxx"), SV_from("x")).len == 0);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_collapse_whitespace(void) {
+    char out[MAX_BYTES];
+    CHECK(SV_collapse_whitespace(SV_from("\t a \n\r b\v\fc  "), sizeof(out),
+                                 out)
+          == 6);
+    CHECK(!strcmp(out, "a b c"));
+    char src[MAX_BYTES];
+    memset(src, ' ', sizeof(src));
+    src[0] = 'a';
+    src[sizeof(src) - 70] = 'b';
+    CHECK(SV_collapse_whitespace((SV_Str_view){src, sizeof(src)}, sizeof(out),
+                                 out)
+          == 4);
+    CHECK(!strcmp(out, "a b"));
+    CHECK(SV_collapse_whitespace(SV_from("ab  cd"), 4, out) == 4);
+    CHECK(!strcmp(out, "ab "));
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_trim_all_whitespace,
+        test_trim_empty,
+        test_trim_set_at_both_ends,
+        test_collapse_whitespace,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
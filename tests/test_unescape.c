@@ -0,0 +1,88 @@
+/* This file tests unescaping of quoted string contents. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Unescapes src with a backslash escape and compares the bytes written. */
+static bool
+unescapes_to(SV_Str_view const src, SV_Str_view const expected) {
+    char buf[64];
+    SV_Str_view const out = SV_unescape_into(src, '\\', sizeof(buf), buf);
+    return out.str == buf && out.len == expected.len
+           && !memcmp(buf, expected.str, expected.len) && !buf[out.len];
+}
+
+static enum Test_result
+test_unescape_simple(void) {
+    CHECK(unescapes_to(SV_from("a\\tb\\n\\\"\\\\"), SV_from("a\tb\n\"\\")));
+    CHECK(unescapes_to(SV_from("\\x41\\x7e\\0"), (SV_Str_view){"A~", 3}));
+    CHECK(unescapes_to(SV_from("\\u00e9\\u20AC"),
+                       SV_from("\xC3\xA9\xE2\x82\xAC")));
+    SV_Str_view const plain = SV_from("no escapes");
+    char buf[16];
+    CHECK(SV_unescape_into(plain, '\\', sizeof(buf), buf).str == plain.str);
+    return TEST_PASS;
+}
+
+/* A high surrogate escape followed by a low one is one code point. */
+static enum Test_result
+test_unescape_surrogate_pair(void) {
+    CHECK(unescapes_to(SV_from("\\uD83D\\uDE00"), SV_from("\xF0\x9F\x98\x80")));
+    CHECK(unescapes_to(SV_from("a\\udbff\\udfffb"),
+                       SV_from("a\xF4\x8F\xBF\xBF" "b")));
+    CHECK(unescapes_to(SV_from("\\uD800\\uDC00\\uD800\\uDC00"),
+                       SV_from("\xF0\x90\x80\x80\xF0\x90\x80\x80")));
+    return TEST_PASS;
+}
+
+/* A surrogate that is not half of a pair becomes U+FFFD and what follows it
+   is unescaped on its own. */
+static enum Test_result
+test_unescape_lone_surrogate(void) {
+    CHECK(unescapes_to(SV_from("\\uD83D"), SV_from("\xEF\xBF\xBD")));
+    CHECK(unescapes_to(SV_from("\\uDE00x"), SV_from("\xEF\xBF\xBDx")));
+    CHECK(unescapes_to(SV_from("\\uD83Dx\\uDE00"),
+                       SV_from("\xEF\xBF\xBDx\xEF\xBF\xBD")));
+    CHECK(unescapes_to(SV_from("\\uD83D\\u0041"), SV_from("\xEF\xBF\xBD" "A")));
+    CHECK(unescapes_to(SV_from("\\uD83D\\uD83D\\uDE00"),
+                       SV_from("\xEF\xBF\xBD\xF0\x9F\x98\x80")));
+    return TEST_PASS;
+}
+
+/* An escape cut off by the end of the input keeps its characters. */
+static enum Test_result
+test_unescape_truncated(void) {
+    CHECK(unescapes_to(SV_from("ab\\"), SV_from("ab\\")));
+    CHECK(unescapes_to(SV_from("\\u12"), SV_from("u12")));
+    CHECK(unescapes_to(SV_from("\\x4"), SV_from("x4")));
+    CHECK(unescapes_to(SV_from("\\uD83D\\uDE0"), SV_from("\xEF\xBF\xBDuDE0")));
+    CHECK(unescapes_to(SV_from("\\uD83D\\"), SV_from("\xEF\xBF\xBD\\")));
+    return TEST_PASS;
+}
+
+/* A code point that does not fit in the destination is left out whole. */
+static enum Test_result
+test_unescape_cut_off(void) {
+    char buf[4];
+    SV_Str_view out
+        = SV_unescape_into(SV_from("a\\uD83D\\uDE00"), '\\', sizeof(buf), buf);
+    CHECK(out.str == buf && out.len == 1 && !strcmp(buf, "a"));
+    out = SV_unescape_into(SV_from("\\tabc"), '\\', sizeof(buf), buf);
+    CHECK(out.len == 3 && !strcmp(buf, "\tab"));
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_unescape_simple,
+        test_unescape_surrogate_pair,
+        test_unescape_lone_surrogate,
+        test_unescape_truncated,
+        test_unescape_cut_off,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}
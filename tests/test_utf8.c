@@ -0,0 +1,203 @@
+/* This file tests the UTF-8 validator and code point decoding. The vector
+   validator checks 16 or 32 bytes at a time, so every invalid sequence is
+   placed at each offset around the first 64 byte block boundary and must be
+   reported at the same position as the portable code would. */
+#include "str_view.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The longest buffer a sequence is placed in. */
+#define MAX_BYTES 160
+
+/* Bytes placed into a run of ASCII. */
+struct Sequence {
+    char const *bytes;
+    size_t len;
+};
+
+#define SEQUENCE(s) {(s), sizeof(s) - 1}
+
+static struct Sequence const valid[] = {
+    SEQUENCE("\xC2\x80"),         SEQUENCE("\xDF\xBF"),
+    SEQUENCE("\xE0\xA0\x80"),     SEQUENCE("\xED\x9F\xBF"),
+    SEQUENCE("\xEE\x80\x80"),     SEQUENCE("\xEF\xBF\xBF"),
+    SEQUENCE("\xF0\x90\x80\x80"), SEQUENCE("\xF4\x8F\xBF\xBF"),
+};
+
+/* Each of these is rejected at its first byte. */
+static struct Sequence const invalid[] = {
+    /* Overlong encodings. */
+    SEQUENCE("\xC0\x80"),
+    SEQUENCE("\xC1\xBF"),
+    SEQUENCE("\xE0\x80\x80"),
+    SEQUENCE("\xE0\x9F\xBF"),
+    SEQUENCE("\xF0\x80\x80\x80"),
+    SEQUENCE("\xF0\x8F\xBF\xBF"),
+    /* Surrogates. */
+    SEQUENCE("\xED\xA0\x80"),
+    SEQUENCE("\xED\xBF\xBF"),
+    /* Code points above U+10FFFF. */
+    SEQUENCE("\xF4\x90\x80\x80"),
+    SEQUENCE("\xF5\x80\x80\x80"),
+    SEQUENCE("\xFF"),
+    /* Continuations without a lead and leads without continuations. */
+    SEQUENCE("\x80"),
+    SEQUENCE("\xBF\xBF"),
+    SEQUENCE("\xC2" "a"),
+    SEQUENCE("\xE2\x82" "a"),
+    SEQUENCE("\xF0\x9F\x98" "a"),
+};
+
+/* Places seq at pos in a run of ASCII len bytes long and reports the error
+   position of the result, or len if it is valid. */
+static size_t
+error_at(struct Sequence const seq, size_t const pos, size_t const len) {
+    char buf[MAX_BYTES];
+    memset(buf, 'a', len);
+    memcpy(buf + pos, seq.bytes, seq.len);
+    size_t err = 0;
+    bool const ok = SV_utf8_valid_prefix((SV_Str_view){buf, len}, &err);
+    if (ok != (err == len) || ok != SV_utf8_valid((SV_Str_view){buf, len})) {
+        return (size_t)-1;
+    }
+    return err;
+}
+
+static enum Test_result
+test_utf8_valid_sequences(void) {
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i) {
+        for (size_t pos = 0; pos < 100; ++pos) {
+            CHECK(error_at(valid[i], pos, MAX_BYTES) == MAX_BYTES);
+            CHECK(error_at(valid[i], pos, pos + valid[i].len)
+                  == pos + valid[i].len);
+        }
+    }
+    CHECK(SV_utf8_valid(SV_from("")));
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_utf8_invalid_sequences(void) {
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        for (size_t pos = 0; pos < 100; ++pos) {
+            CHECK(error_at(invalid[i], pos, MAX_BYTES) == pos);
+        }
+    }
+    return TEST_PASS;
+}
+
+/* A valid sequence before the error keeps the validator out of its ASCII
+   shortcut in the vector that holds the error. */
+static enum Test_result
+test_utf8_invalid_after_valid(void) {
+    char buf[MAX_BYTES];
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        for (size_t pos = 4; pos < 100; ++pos) {
+            memset(buf, 'a', sizeof(buf));
+            memcpy(buf + pos - 4, "\xF0\x9F\x98\x80", 4);
+            memcpy(buf + pos, invalid[i].bytes, invalid[i].len);
+            size_t err = 0;
+            CHECK(!SV_utf8_valid_prefix((SV_Str_view){buf, sizeof(buf)}, &err));
+            CHECK(err == pos);
+        }
+    }
+    return TEST_PASS;
+}
+
+/* Cuts every multi-byte sequence short so the input ends exactly at the end
+   of a 16, 32, or 64 byte block, where the validator must carry the
+   incomplete sequence rather than accept the block. */
+static enum Test_result
+test_utf8_truncated_at_block_end(void) {
+    static size_t const ends[] = {16, 32, 48, 64, 96, 128};
+    for (size_t e = 0; e < sizeof(ends) / sizeof(ends[0]); ++e) {
+        for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i) {
+            for (size_t cut = 1; cut < valid[i].len; ++cut) {
+                struct Sequence const head = {valid[i].bytes, cut};
+                size_t const pos = ends[e] - cut;
+                CHECK(error_at(head, pos, ends[e]) == pos);
+                CHECK(error_at(valid[i], ends[e] - valid[i].len, ends[e])
+                      == ends[e]);
+            }
+        }
+    }
+    return TEST_PASS;
+}
+
+/* Decodes every code point of src and checks the values, and that the
+   iteration visits SV_utf8_count() code points at SV_utf8_offset(). */
+static enum Test_result
+expect_code_points(SV_Str_view const src, size_t const n,
+                   uint32_t const *const expected) {
+    size_t k = 0;
+    for (SV_Str_view c = SV_utf8_begin(src); !SV_utf8_end(src, c);
+         c = SV_utf8_next(src, c)) {
+        CHECK(k < n);
+        CHECK(SV_utf8_decode(c) == expected[k]);
+        CHECK((size_t)(c.str - src.str) == SV_utf8_offset(src, k));
+        ++k;
+    }
+    CHECK(k == n);
+    CHECK(SV_utf8_count(src) == n);
+    CHECK(SV_utf8_offset(src, n) == src.len);
+    return TEST_PASS;
+}
+
+static enum Test_result
+test_utf8_decode(void) {
+    CHECK(expect_code_points(SV_from("A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"),
+                             4, (uint32_t[]){0x41, 0xE9, 0x20AC, 0x1F600})
+          == TEST_PASS);
+    /* The least and greatest value of each length. */
+    CHECK(expect_code_points(
+              SV_from("\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF"
+                      "\xF0\x90\x80\x80\xF4\x8F\xBF\xBF"),
+              7,
+              (uint32_t[]){0x7F, 0x80, 0x7FF, 0x800, 0xFFFF, 0x10000, 0x10FFFF})
+          == TEST_PASS);
+    CHECK(expect_code_points(SV_from(""), 0, NULL) == TEST_PASS);
+    return TEST_PASS;
+}
+
+/* An invalid sequence decodes to one U+FFFD and iteration resumes at the
+   next byte that is not a continuation, so stray continuations belong to the
+   code point before them. */
+static enum Test_result
+test_utf8_decode_replacement(void) {
+    CHECK(expect_code_points(SV_from("a\x80\xBF" "b"), 2,
+                             (uint32_t[]){0xFFFD, 'b'})
+          == TEST_PASS);
+    CHECK(expect_code_points(SV_from("\xC3" "a\xE2\x82" "b\xF0\x9F\x98"), 5,
+                             (uint32_t[]){0xFFFD, 'a', 0xFFFD, 'b', 0xFFFD})
+          == TEST_PASS);
+    CHECK(expect_code_points(SV_from("\xC0\x80\xE0\x80\x80\xF0\x8F\xBF\xBF"),
+                             3, (uint32_t[]){0xFFFD, 0xFFFD, 0xFFFD})
+          == TEST_PASS);
+    CHECK(expect_code_points(SV_from("\xED\xA0\x80\xED\x9F\xBF"), 2,
+                             (uint32_t[]){0xFFFD, 0xD7FF})
+          == TEST_PASS);
+    CHECK(expect_code_points(SV_from("\xF4\x90\x80\x80\xFF\xC3\xA9\x80"), 3,
+                             (uint32_t[]){0xFFFD, 0xFFFD, 0xFFFD})
+          == TEST_PASS);
+    CHECK(SV_utf8_decode(SV_from("")) == 0xFFFD);
+    CHECK(SV_utf8_decode(SV_from("\x80")) == 0xFFFD);
+    CHECK(SV_utf8_decode(SV_from("\xC3\xA9" "a")) == 0xFFFD);
+    return TEST_PASS;
+}
+
+int
+main(void) {
+    static Test_fn const tests[] = {
+        test_utf8_valid_sequences,
+        test_utf8_invalid_sequences,
+        test_utf8_invalid_after_valid,
+        test_utf8_truncated_at_block_end,
+        test_utf8_decode,
+        test_utf8_decode_replacement,
+    };
+    return run_tests(tests, sizeof(tests) / sizeof(tests[0]));
+}